@@ -0,0 +1,47 @@
+//
+//  ACJSONParser.h
+//  ACNetworkingDemo
+//
+//  Created by Allen on 2019/3/13.
+//  Copyright © 2019 Allen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ UTF-8 JSON解析器,结果与NSJSONSerialization相同.
+ 先以SIMD(NEON/AVX2/SSE2,不支持时逐字节)每次处理64字节,找出字符串外的结构字符、字符串起点及标量起点,
+ 再按索引直接构建Foundation对象,容器在元素解析完后一次性创建.
+ 遇到无法处理的输入(非法JSON、非UTF-8编码、超出int64的整数等)时交由NSJSONSerialization解析,错误信息与之一致
+ */
+@interface ACJSONParser : NSObject
+
+/** 当前使用的指令集:NEON、AVX2、SSE2或Scalar */
+@property (class, nonatomic, copy, readonly) NSString *instructionSet;
+
+/**
+ 解析JSON
+
+ @param data UTF-8 JSON数据
+ @param options 同NSJSONSerialization
+ @param error 错误
+ @return JSON对象
+ */
++ (nullable id)JSONObjectWithData:(NSData *)data options:(NSJSONReadingOptions)options error:(NSError **)error;
+
+/**
+ 只使用本解析器解析JSON,不回退到NSJSONSerialization
+
+ @param data UTF-8 JSON数据
+ @param options 同NSJSONSerialization
+ @param removesKeysWithNullValues 是否在解析时去除值为null的key(数组中的null保留),结果与AFJSONResponseSerializer的同名选项相同
+ @param vectorized 是否使用SIMD,NO时逐字节建立索引,用于对照
+ @return JSON对象,输入无法处理时返回nil,由调用方回退
+ */
++ (nullable id)JSONObjectWithData:(NSData *)data options:(NSJSONReadingOptions)options removesKeysWithNullValues:(BOOL)removesKeysWithNullValues vectorized:(BOOL)vectorized;
+
+@end
+
+NS_ASSUME_NONNULL_END
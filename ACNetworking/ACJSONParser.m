@@ -0,0 +1,684 @@
+//
+//  ACJSONParser.m
+//  ACNetworkingDemo
+//
+//  Created by Allen on 2019/3/13.
+//  Copyright © 2019 Allen. All rights reserved.
+//
+
+#import "ACJSONParser.h"
+#include <xlocale.h>
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define AC_JSON_NEON 1
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define AC_JSON_AVX2 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define AC_JSON_SSE2 1
+#endif
+
+/** 嵌套层数上限,超出时交由NSJSONSerialization */
+static NSUInteger const ACJSONMaximumDepth = 512;
+
+/** 缓存的key最大长度 */
+static NSUInteger const ACJSONKeyCacheMaximumLength = 32;
+
+/** key缓存容量,须为2的幂 */
+static NSUInteger const ACJSONKeyCacheSize = 256;
+
+#pragma mark - Stage 1
+
+/** 一个64字节块的分类结果,第i位对应块内第i个字节 */
+typedef struct {
+    uint64_t quote;
+    uint64_t backslash;
+    /** {}[]:, */
+    uint64_t structural;
+    uint64_t whitespace;
+    /** 小于0x20的字节,出现在字符串内即为非法 */
+    uint64_t control;
+} ACJSONBlockMasks;
+
+typedef void (*ACJSONClassifier)(const uint8_t *block, ACJSONBlockMasks *masks);
+
+static void ACJSONClassifyScalar(const uint8_t *block, ACJSONBlockMasks *masks) {
+    uint64_t quote = 0, backslash = 0, structural = 0, whitespace = 0, control = 0;
+    for (NSUInteger i = 0; i < 64; i++) {
+        uint64_t bit = 1ULL << i;
+        uint8_t c = block[i];
+        switch (c) {
+            case '"': quote |= bit; break;
+            case '\\': backslash |= bit; break;
+            case '{': case '}': case '[': case ']': case ':': case ',': structural |= bit; break;
+            case ' ': whitespace |= bit; break;
+            case '\t': case '\n': case '\r': whitespace |= bit; control |= bit; break;
+            default: if (c < 0x20) control |= bit; break;
+        }
+    }
+    masks->quote = quote;
+    masks->backslash = backslash;
+    masks->structural = structural;
+    masks->whitespace = whitespace;
+    masks->control = control;
+}
+
+#if AC_JSON_NEON
+
+static inline uint64_t ACJSONMovemaskNEON(uint8x16_t m0, uint8x16_t m1, uint8x16_t m2, uint8x16_t m3) {
+    const uint8x16_t bits = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80};
+    uint8x16_t sum0 = vpaddq_u8(vandq_u8(m0, bits), vandq_u8(m1, bits));
+    uint8x16_t sum1 = vpaddq_u8(vandq_u8(m2, bits), vandq_u8(m3, bits));
+    sum0 = vpaddq_u8(sum0, sum1);
+    sum0 = vpaddq_u8(sum0, sum0);
+    return vgetq_lane_u64(vreinterpretq_u64_u8(sum0), 0);
+}
+
+static void ACJSONClassifyNEON(const uint8_t *block, ACJSONBlockMasks *masks) {
+    uint8x16_t v[4] = {vld1q_u8(block), vld1q_u8(block + 16), vld1q_u8(block + 32), vld1q_u8(block + 48)};
+    uint8x16_t quote[4], backslash[4], structural[4], whitespace[4], control[4];
+    for (NSUInteger i = 0; i < 4; i++) {
+        /** '['|0x20 == '{', ']'|0x20 == '}' */
+        uint8x16_t folded = vorrq_u8(v[i], vdupq_n_u8(0x20));
+        quote[i] = vceqq_u8(v[i], vdupq_n_u8('"'));
+        backslash[i] = vceqq_u8(v[i], vdupq_n_u8('\\'));
+        structural[i] = vorrq_u8(vorrq_u8(vceqq_u8(folded, vdupq_n_u8('{')), vceqq_u8(folded, vdupq_n_u8('}'))),
+                                 vorrq_u8(vceqq_u8(v[i], vdupq_n_u8(':')), vceqq_u8(v[i], vdupq_n_u8(','))));
+        whitespace[i] = vorrq_u8(vorrq_u8(vceqq_u8(v[i], vdupq_n_u8(' ')), vceqq_u8(v[i], vdupq_n_u8('\t'))),
+                                 vorrq_u8(vceqq_u8(v[i], vdupq_n_u8('\n')), vceqq_u8(v[i], vdupq_n_u8('\r'))));
+        control[i] = vcltq_u8(v[i], vdupq_n_u8(0x20));
+    }
+    masks->quote = ACJSONMovemaskNEON(quote[0], quote[1], quote[2], quote[3]);
+    masks->backslash = ACJSONMovemaskNEON(backslash[0], backslash[1], backslash[2], backslash[3]);
+    masks->structural = ACJSONMovemaskNEON(structural[0], structural[1], structural[2], structural[3]);
+    masks->whitespace = ACJSONMovemaskNEON(whitespace[0], whitespace[1], whitespace[2], whitespace[3]);
+    masks->control = ACJSONMovemaskNEON(control[0], control[1], control[2], control[3]);
+}
+
+static ACJSONClassifier const ACJSONVectorClassifier = ACJSONClassifyNEON;
+static NSString * const ACJSONVectorInstructionSet = @"NEON";
+
+#elif AC_JSON_AVX2
+
+static inline uint64_t ACJSONMovemaskAVX2(__m256i lo, __m256i hi) {
+    return (uint32_t)_mm256_movemask_epi8(lo) | ((uint64_t)(uint32_t)_mm256_movemask_epi8(hi) << 32);
+}
+
+static void ACJSONClassifyAVX2(const uint8_t *block, ACJSONBlockMasks *masks) {
+    __m256i v[2] = {_mm256_loadu_si256((const __m256i *)block), _mm256_loadu_si256((const __m256i *)(block + 32))};
+    __m256i quote[2], backslash[2], structural[2], whitespace[2], control[2];
+    for (NSUInteger i = 0; i < 2; i++) {
+        __m256i folded = _mm256_or_si256(v[i], _mm256_set1_epi8(0x20));
+        quote[i] = _mm256_cmpeq_epi8(v[i], _mm256_set1_epi8('"'));
+        backslash[i] = _mm256_cmpeq_epi8(v[i], _mm256_set1_epi8('\\'));
+        structural[i] = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(folded, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(folded, _mm256_set1_epi8('}'))),
+                                        _mm256_or_si256(_mm256_cmpeq_epi8(v[i], _mm256_set1_epi8(':')), _mm256_cmpeq_epi8(v[i], _mm256_set1_epi8(','))));
+        whitespace[i] = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v[i], _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v[i], _mm256_set1_epi8('\t'))),
+                                        _mm256_or_si256(_mm256_cmpeq_epi8(v[i], _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(v[i], _mm256_set1_epi8('\r'))));
+        /** 无符号比较:max(v, 0x1F) == 0x1F即v <= 0x1F */
+        control[i] = _mm256_cmpeq_epi8(_mm256_max_epu8(v[i], _mm256_set1_epi8(0x1F)), _mm256_set1_epi8(0x1F));
+    }
+    masks->quote = ACJSONMovemaskAVX2(quote[0], quote[1]);
+    masks->backslash = ACJSONMovemaskAVX2(backslash[0], backslash[1]);
+    masks->structural = ACJSONMovemaskAVX2(structural[0], structural[1]);
+    masks->whitespace = ACJSONMovemaskAVX2(whitespace[0], whitespace[1]);
+    masks->control = ACJSONMovemaskAVX2(control[0], control[1]);
+}
+
+static ACJSONClassifier const ACJSONVectorClassifier = ACJSONClassifyAVX2;
+static NSString * const ACJSONVectorInstructionSet = @"AVX2";
+
+#elif AC_JSON_SSE2
+
+static inline uint64_t ACJSONMovemaskSSE2(__m128i m0, __m128i m1, __m128i m2, __m128i m3) {
+    return (uint64_t)(uint16_t)_mm_movemask_epi8(m0) | ((uint64_t)(uint16_t)_mm_movemask_epi8(m1) << 16) |
+           ((uint64_t)(uint16_t)_mm_movemask_epi8(m2) << 32) | ((uint64_t)(uint16_t)_mm_movemask_epi8(m3) << 48);
+}
+
+static void ACJSONClassifySSE2(const uint8_t *block, ACJSONBlockMasks *masks) {
+    __m128i v[4];
+    __m128i quote[4], backslash[4], structural[4], whitespace[4], control[4];
+    for (NSUInteger i = 0; i < 4; i++) {
+        v[i] = _mm_loadu_si128((const __m128i *)(block + i * 16));
+        __m128i folded = _mm_or_si128(v[i], _mm_set1_epi8(0x20));
+        quote[i] = _mm_cmpeq_epi8(v[i], _mm_set1_epi8('"'));
+        backslash[i] = _mm_cmpeq_epi8(v[i], _mm_set1_epi8('\\'));
+        structural[i] = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('{')), _mm_cmpeq_epi8(folded, _mm_set1_epi8('}'))),
+                                     _mm_or_si128(_mm_cmpeq_epi8(v[i], _mm_set1_epi8(':')), _mm_cmpeq_epi8(v[i], _mm_set1_epi8(','))));
+        whitespace[i] = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v[i], _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v[i], _mm_set1_epi8('\t'))),
+                                     _mm_or_si128(_mm_cmpeq_epi8(v[i], _mm_set1_epi8('\n')), _mm_cmpeq_epi8(v[i], _mm_set1_epi8('\r'))));
+        control[i] = _mm_cmpeq_epi8(_mm_max_epu8(v[i], _mm_set1_epi8(0x1F)), _mm_set1_epi8(0x1F));
+    }
+    masks->quote = ACJSONMovemaskSSE2(quote[0], quote[1], quote[2], quote[3]);
+    masks->backslash = ACJSONMovemaskSSE2(backslash[0], backslash[1], backslash[2], backslash[3]);
+    masks->structural = ACJSONMovemaskSSE2(structural[0], structural[1], structural[2], structural[3]);
+    masks->whitespace = ACJSONMovemaskSSE2(whitespace[0], whitespace[1], whitespace[2], whitespace[3]);
+    masks->control = ACJSONMovemaskSSE2(control[0], control[1], control[2], control[3]);
+}
+
+static ACJSONClassifier const ACJSONVectorClassifier = ACJSONClassifySSE2;
+static NSString * const ACJSONVectorInstructionSet = @"SSE2";
+
+#else
+
+static ACJSONClassifier const ACJSONVectorClassifier = ACJSONClassifyScalar;
+static NSString * const ACJSONVectorInstructionSet = @"Scalar";
+
+#endif
+
+/**
+ 计算被转义的字符
+
+ @param backslash 反斜杠
+ @param carry 输入为上一块末尾是否转义了本块第一个字符,输出为本块末尾是否转义了下一块第一个字符
+ @return 被转义字符的mask
+ */
+static inline uint64_t ACJSONEscapedMask(uint64_t backslash, uint64_t *carry) {
+    uint64_t escaped = *carry;
+    /** 被转义的反斜杠不再转义下一个字符 */
+    backslash &= ~escaped;
+    *carry = 0;
+    while (backslash) {
+        uint64_t bit = backslash & (0 - backslash);
+        backslash ^= bit;
+        if (bit == (1ULL << 63)) {
+            *carry = 1;
+            break;
+        }
+        escaped |= bit << 1;
+        backslash &= ~(bit << 1);
+    }
+    return escaped;
+}
+
+/** 前缀异或:第i位为0..i位的异或,即该位置是否处在引号之间 */
+static inline uint64_t ACJSONPrefixXor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+/**
+ 建立结构索引:字符串外的{}[]:,、字符串的起始引号,以及true/false/null/数字的首字符
+
+ @param bytes 数据
+ @param length 长度
+ @param indexes 索引输出,容量至少为length
+ @param classifier 分类函数
+ @return 索引个数,字符串未闭合或含未转义的控制字符时返回NSNotFound
+ */
+static NSUInteger ACJSONBuildStructuralIndex(const uint8_t *bytes, NSUInteger length, uint32_t *indexes, ACJSONClassifier classifier) {
+    uint64_t inStringCarry = 0;
+    uint64_t escapedCarry = 0;
+    uint64_t scalarCarry = 0;
+    uint64_t invalid = 0;
+    NSUInteger count = 0;
+    uint8_t tail[64];
+    for (NSUInteger offset = 0; offset < length; offset += 64) {
+        const uint8_t *block = bytes + offset;
+        if (length - offset < 64) {
+            /** 末尾不足64字节,以空格补齐 */
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, block, length - offset);
+            block = tail;
+        }
+        ACJSONBlockMasks masks;
+        classifier(block, &masks);
+        uint64_t escaped = ACJSONEscapedMask(masks.backslash, &escapedCarry);
+        uint64_t quotes = masks.quote & ~escaped;
+        uint64_t inString = ACJSONPrefixXor(quotes) ^ inStringCarry;
+        inStringCarry = (uint64_t)((int64_t)inString >> 63);
+        /** inString含起始引号、不含结束引号 */
+        invalid |= masks.control & inString;
+        uint64_t structural = masks.structural & ~inString;
+        uint64_t scalar = ~(masks.structural | masks.whitespace | masks.quote | inString);
+        uint64_t scalarStarts = scalar & ~((scalar << 1) | scalarCarry);
+        scalarCarry = scalar >> 63;
+        uint64_t starts = structural | (quotes & inString) | scalarStarts;
+        while (starts) {
+            indexes[count++] = (uint32_t)(offset + __builtin_ctzll(starts));
+            starts &= starts - 1;
+        }
+    }
+    if (inStringCarry || invalid) return NSNotFound;
+    return count;
+}
+
+#pragma mark - Stage 2
+
+/** 缓存未转义的key,同名key只创建一次 */
+typedef struct {
+    const uint8_t *bytes;
+    NSUInteger length;
+    CFTypeRef string;
+} ACJSONKeyCacheEntry;
+
+typedef struct {
+    const uint8_t *bytes;
+    NSUInteger length;
+    const uint32_t *indexes;
+    NSUInteger indexCount;
+    NSUInteger next;
+    NSUInteger depth;
+    BOOL mutableContainers;
+    BOOL mutableLeaves;
+    BOOL removesNulls;
+    /** 已解析、尚未放入容器的值和key */
+    CFTypeRef *values;
+    NSUInteger valueCount;
+    NSUInteger valueCapacity;
+    CFTypeRef *keys;
+    NSUInteger keyCount;
+    NSUInteger keyCapacity;
+    ACJSONKeyCacheEntry keyCache[ACJSONKeyCacheSize];
+} ACJSONParserState;
+
+static inline void ACJSONPush(CFTypeRef **stack, NSUInteger *count, NSUInteger *capacity, id object) {
+    if (*count == *capacity) {
+        *capacity = MAX(*capacity * 2, 64);
+        *stack = realloc(*stack, *capacity * sizeof(CFTypeRef));
+    }
+    (*stack)[(*count)++] = CFBridgingRetain(object);
+}
+
+static inline void ACJSONPop(CFTypeRef *stack, NSUInteger *count, NSUInteger base) {
+    while (*count > base) {
+        CFRelease(stack[--(*count)]);
+    }
+}
+
+static inline BOOL ACJSONIsDelimiter(uint8_t c) {
+    switch (c) {
+        case '{': case '}': case '[': case ']': case ':': case ',': case '"':
+        case ' ': case '\t': case '\n': case '\r':
+            return YES;
+        default:
+            return NO;
+    }
+}
+
+static inline int ACJSONHexValue(uint8_t c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static BOOL ACJSONReadHex4(const uint8_t *p, const uint8_t *end, uint32_t *value) {
+    if (end - p < 4) return NO;
+    uint32_t result = 0;
+    for (NSUInteger i = 0; i < 4; i++) {
+        int digit = ACJSONHexValue(p[i]);
+        if (digit < 0) return NO;
+        result = (result << 4) | (uint32_t)digit;
+    }
+    *value = result;
+    return YES;
+}
+
+static NSUInteger ACJSONEncodeUTF8(uint32_t codePoint, uint8_t *out) {
+    if (codePoint < 0x80) {
+        out[0] = (uint8_t)codePoint;
+        return 1;
+    } else if (codePoint < 0x800) {
+        out[0] = (uint8_t)(0xC0 | (codePoint >> 6));
+        out[1] = (uint8_t)(0x80 | (codePoint & 0x3F));
+        return 2;
+    } else if (codePoint < 0x10000) {
+        out[0] = (uint8_t)(0xE0 | (codePoint >> 12));
+        out[1] = (uint8_t)(0x80 | ((codePoint >> 6) & 0x3F));
+        out[2] = (uint8_t)(0x80 | (codePoint & 0x3F));
+        return 3;
+    }
+    out[0] = (uint8_t)(0xF0 | (codePoint >> 18));
+    out[1] = (uint8_t)(0x80 | ((codePoint >> 12) & 0x3F));
+    out[2] = (uint8_t)(0x80 | ((codePoint >> 6) & 0x3F));
+    out[3] = (uint8_t)(0x80 | (codePoint & 0x3F));
+    return 4;
+}
+
+/**
+ 还原转义字符,转义后的长度不会超过原长度
+
+ @return 字符串,转义无效(含单独的代理项)时返回nil
+ */
+static NSString *ACJSONUnescapedString(const uint8_t *p, const uint8_t *end, BOOL mutable) {
+    NSUInteger capacity = end - p;
+    uint8_t stackBuffer[256];
+    uint8_t *buffer = capacity <= sizeof(stackBuffer) ? stackBuffer : malloc(capacity);
+    uint8_t *out = buffer;
+    BOOL valid = YES;
+    while (valid && p < end) {
+        uint8_t c = *p++;
+        if (c != '\\') {
+            *out++ = c;
+            continue;
+        }
+        if (p >= end) {
+            valid = NO;
+            break;
+        }
+        switch (*p++) {
+            case '"': *out++ = '"'; break;
+            case '\\': *out++ = '\\'; break;
+            case '/': *out++ = '/'; break;
+            case 'b': *out++ = '\b'; break;
+            case 'f': *out++ = '\f'; break;
+            case 'n': *out++ = '\n'; break;
+            case 'r': *out++ = '\r'; break;
+            case 't': *out++ = '\t'; break;
+            case 'u': {
+                uint32_t codePoint, low;
+                if (!ACJSONReadHex4(p, end, &codePoint)) {
+                    valid = NO;
+                    break;
+                }
+                p += 4;
+                if (codePoint >= 0xD800 && codePoint <= 0xDBFF) {
+                    if (end - p < 6 || p[0] != '\\' || p[1] != 'u' || !ACJSONReadHex4(p + 2, end, &low) || low < 0xDC00 || low > 0xDFFF) {
+                        valid = NO;
+                        break;
+                    }
+                    p += 6;
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                } else if (codePoint >= 0xDC00 && codePoint <= 0xDFFF) {
+                    valid = NO;
+                    break;
+                }
+                out += ACJSONEncodeUTF8(codePoint, out);
+                break;
+            }
+            default:
+                valid = NO;
+                break;
+        }
+    }
+    NSString *string = valid ? [[(mutable ? [NSMutableString class] : [NSString class]) alloc] initWithBytes:buffer length:out - buffer encoding:NSUTF8StringEncoding] : nil;
+    if (buffer != stackBuffer) free(buffer);
+    return string;
+}
+
+/**
+ 解析pos处起始引号开始的字符串
+
+ @return 字符串,无效时返回nil
+ */
+static NSString *ACJSONParseString(ACJSONParserState *state, NSUInteger pos, BOOL mutable, BOOL isKey) {
+    const uint8_t *start = state->bytes + pos + 1;
+    const uint8_t *end = state->bytes + state->length;
+    const uint8_t *quote = start;
+    /** 找到前面有偶数个反斜杠的引号 */
+    while (YES) {
+        quote = memchr(quote, '"', end - quote);
+        if (!quote) return nil;
+        const uint8_t *p = quote;
+        while (p > start && p[-1] == '\\') p--;
+        if ((quote - p) % 2 == 0) break;
+        quote++;
+    }
+    NSUInteger length = quote - start;
+    if (memchr(start, '\\', length)) {
+        return ACJSONUnescapedString(start, quote, mutable);
+    }
+    if (!isKey || length > ACJSONKeyCacheMaximumLength) {
+        return [[(mutable ? [NSMutableString class] : [NSString class]) alloc] initWithBytes:start length:length encoding:NSUTF8StringEncoding];
+    }
+    uint32_t hash = 2166136261u;
+    for (NSUInteger i = 0; i < length; i++) {
+        hash = (hash ^ start[i]) * 16777619u;
+    }
+    ACJSONKeyCacheEntry *entry = &state->keyCache[hash & (ACJSONKeyCacheSize - 1)];
+    if (entry->string && entry->length == length && memcmp(entry->bytes, start, length) == 0) {
+        return (__bridge NSString *)entry->string;
+    }
+    NSString *key = [[NSString alloc] initWithBytes:start length:length encoding:NSUTF8StringEncoding];
+    if (key) {
+        if (entry->string) CFRelease(entry->string);
+        entry->bytes = start;
+        entry->length = length;
+        entry->string = CFBridgingRetain(key);
+    }
+    return key;
+}
+
+/**
+ 解析数字,语法同RFC 8259
+
+ @return NSNumber,超出int64的整数或过长的数字返回nil
+ */
+static NSNumber *ACJSONParseNumber(const uint8_t *p, NSUInteger length) {
+    NSUInteger i = 0;
+    BOOL negative = p[0] == '-';
+    if (negative) i++;
+    if (i >= length) return nil;
+    if (p[i] == '0') {
+        i++;
+    } else if (p[i] >= '1' && p[i] <= '9') {
+        while (i < length && p[i] >= '0' && p[i] <= '9') i++;
+    } else {
+        return nil;
+    }
+    NSUInteger integerEnd = i;
+    BOOL isInteger = YES;
+    if (i < length && p[i] == '.') {
+        NSUInteger digits = ++i;
+        while (i < length && p[i] >= '0' && p[i] <= '9') i++;
+        if (i == digits) return nil;
+        isInteger = NO;
+    }
+    if (i < length && (p[i] == 'e' || p[i] == 'E')) {
+        i++;
+        if (i < length && (p[i] == '+' || p[i] == '-')) i++;
+        NSUInteger digits = i;
+        while (i < length && p[i] >= '0' && p[i] <= '9') i++;
+        if (i == digits) return nil;
+        isInteger = NO;
+    }
+    if (i != length) return nil;
+    if (isInteger) {
+        NSUInteger start = negative ? 1 : 0;
+        /** 18位以内不会溢出int64 */
+        if (integerEnd - start > 18) return nil;
+        long long value = 0;
+        for (NSUInteger j = start; j < integerEnd; j++) {
+            value = value * 10 + (p[j] - '0');
+        }
+        return @(negative ? -value : value);
+    }
+    char buffer[64];
+    if (length >= sizeof(buffer)) return nil;
+    memcpy(buffer, p, length);
+    buffer[length] = '\0';
+    /** NULL为C locale,不受系统小数点设置影响 */
+    return @(strtod_l(buffer, NULL, NULL));
+}
+
+static id ACJSONParseValue(ACJSONParserState *state);
+
+static id ACJSONParseScalar(ACJSONParserState *state, NSUInteger pos) {
+    const uint8_t *p = state->bytes + pos;
+    NSUInteger length = 0;
+    while (pos + length < state->length && !ACJSONIsDelimiter(p[length])) length++;
+    switch (p[0]) {
+        case 't':
+            return (length == 4 && memcmp(p, "true", 4) == 0) ? @YES : nil;
+        case 'f':
+            return (length == 5 && memcmp(p, "false", 5) == 0) ? @NO : nil;
+        case 'n':
+            return (length == 4 && memcmp(p, "null", 4) == 0) ? [NSNull null] : nil;
+        default:
+            return ACJSONParseNumber(p, length);
+    }
+}
+
+static inline uint8_t ACJSONPeek(ACJSONParserState *state) {
+    return state->next < state->indexCount ? state->bytes[state->indexes[state->next]] : 0;
+}
+
+static id ACJSONParseObject(ACJSONParserState *state) {
+    NSUInteger valueBase = state->valueCount;
+    NSUInteger keyBase = state->keyCount;
+    BOOL valid = YES;
+    if (ACJSONPeek(state) == '}') {
+        state->next++;
+    } else {
+        while (YES) {
+            if (ACJSONPeek(state) != '"') {
+                valid = NO;
+                break;
+            }
+            NSString *key = ACJSONParseString(state, state->indexes[state->next++], NO, YES);
+            if (!key || ACJSONPeek(state) != ':') {
+                valid = NO;
+                break;
+            }
+            state->next++;
+            id value = ACJSONParseValue(state);
+            if (!value) {
+                valid = NO;
+                break;
+            }
+            if (!(state->removesNulls && value == [NSNull null])) {
+                ACJSONPush(&state->keys, &state->keyCount, &state->keyCapacity, key);
+                ACJSONPush(&state->values, &state->valueCount, &state->valueCapacity, value);
+            }
+            uint8_t c = ACJSONPeek(state);
+            state->next++;
+            if (c == '}') break;
+            if (c != ',') {
+                valid = NO;
+                break;
+            }
+        }
+    }
+    id object = nil;
+    if (valid) {
+        NSUInteger count = state->valueCount - valueBase;
+        __unsafe_unretained id const *objects = (__unsafe_unretained id const *)(const void *)(state->values + valueBase);
+        __unsafe_unretained id<NSCopying> const *keys = (__unsafe_unretained id<NSCopying> const *)(const void *)(state->keys + keyBase);
+        object = state->mutableContainers ? [NSMutableDictionary dictionaryWithObjects:objects forKeys:keys count:count] : [NSDictionary dictionaryWithObjects:objects forKeys:keys count:count];
+    }
+    ACJSONPop(state->values, &state->valueCount, valueBase);
+    ACJSONPop(state->keys, &state->keyCount, keyBase);
+    return object;
+}
+
+static id ACJSONParseArray(ACJSONParserState *state) {
+    NSUInteger valueBase = state->valueCount;
+    BOOL valid = YES;
+    if (ACJSONPeek(state) == ']') {
+        state->next++;
+    } else {
+        while (YES) {
+            id value = ACJSONParseValue(state);
+            if (!value) {
+                valid = NO;
+                break;
+            }
+            ACJSONPush(&state->values, &state->valueCount, &state->valueCapacity, value);
+            uint8_t c = ACJSONPeek(state);
+            state->next++;
+            if (c == ']') break;
+            if (c != ',') {
+                valid = NO;
+                break;
+            }
+        }
+    }
+    id array = nil;
+    if (valid) {
+        NSUInteger count = state->valueCount - valueBase;
+        __unsafe_unretained id const *objects = (__unsafe_unretained id const *)(const void *)(state->values + valueBase);
+        array = state->mutableContainers ? [NSMutableArray arrayWithObjects:objects count:count] : [NSArray arrayWithObjects:objects count:count];
+    }
+    ACJSONPop(state->values, &state->valueCount, valueBase);
+    return array;
+}
+
+static id ACJSONParseValue(ACJSONParserState *state) {
+    if (state->next >= state->indexCount) return nil;
+    NSUInteger pos = state->indexes[state->next++];
+    switch (state->bytes[pos]) {
+        case '{':
+        case '[': {
+            if (++state->depth > ACJSONMaximumDepth) return nil;
+            id container = state->bytes[pos] == '{' ? ACJSONParseObject(state) : ACJSONParseArray(state);
+            state->depth--;
+            return container;
+        }
+        case '"':
+            return ACJSONParseString(state, pos, state->mutableLeaves, NO);
+        case '}': case ']': case ':': case ',':
+            return nil;
+        default:
+            return ACJSONParseScalar(state, pos);
+    }
+}
+
+static id ACJSONParse(NSData *data, NSJSONReadingOptions options, BOOL removesNulls, ACJSONClassifier classifier) {
+    NSUInteger length = data.length;
+    if (length == 0 || length >= UINT32_MAX) return nil;
+    const uint8_t *bytes = data.bytes;
+    uint32_t *indexes = malloc(length * sizeof(uint32_t));
+    if (!indexes) return nil;
+    NSUInteger indexCount = ACJSONBuildStructuralIndex(bytes, length, indexes, classifier);
+    if (indexCount == NSNotFound || indexCount == 0) {
+        free(indexes);
+        return nil;
+    }
+    ACJSONParserState *state = calloc(1, sizeof(ACJSONParserState));
+    state->bytes = bytes;
+    state->length = length;
+    state->indexes = indexes;
+    state->indexCount = indexCount;
+    state->mutableContainers = (options & NSJSONReadingMutableContainers) != 0;
+    state->mutableLeaves = (options & NSJSONReadingMutableLeaves) != 0;
+    state->removesNulls = removesNulls;
+    id object = nil;
+    uint8_t first = bytes[indexes[0]];
+    if (first == '{' || first == '[' || (options & NSJSONReadingAllowFragments)) {
+        object = ACJSONParseValue(state);
+        /** 根对象之后不能再有内容 */
+        if (state->next != state->indexCount) object = nil;
+    }
+    ACJSONPop(state->values, &state->valueCount, 0);
+    ACJSONPop(state->keys, &state->keyCount, 0);
+    for (NSUInteger i = 0; i < ACJSONKeyCacheSize; i++) {
+        if (state->keyCache[i].string) CFRelease(state->keyCache[i].string);
+    }
+    free(state->values);
+    free(state->keys);
+    free(state);
+    free(indexes);
+    return object;
+}
+
+#pragma mark - ACJSONParser
+
+@implementation ACJSONParser
+
++ (NSString *)instructionSet {
+    return ACJSONVectorInstructionSet;
+}
+
++ (id)JSONObjectWithData:(NSData *)data options:(NSJSONReadingOptions)options error:(NSError *__autoreleasing *)error {
+    id object = [self JSONObjectWithData:data options:options removesKeysWithNullValues:NO vectorized:YES];
+    if (object) return object;
+    return [NSJSONSerialization JSONObjectWithData:data options:options error:error];
+}
+
++ (id)JSONObjectWithData:(NSData *)data options:(NSJSONReadingOptions)options removesKeysWithNullValues:(BOOL)removesKeysWithNullValues vectorized:(BOOL)vectorized {
+    id object = nil;
+    @autoreleasepool {
+        object = ACJSONParse(data, options, removesKeysWithNullValues, vectorized ? ACJSONVectorClassifier : ACJSONClassifyScalar);
+    }
+    return object;
+}
+
+@end
@@ -0,0 +1,23 @@
+//
+//  ACJSONResponseSerializer.h
+//  ACNetworkingDemo
+//
+//  Created by Allen on 2019/3/13.
+//  Copyright © 2019 Allen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <AFNetworking.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ 以ACJSONParser解析的JSON序列化器,可直接替换sessionManager.responseSerializer,结果与AFJSONResponseSerializer相同.
+ UTF-8响应直接解析原始数据,省去父类转为NSString再编码回UTF-8的两次复制;removesKeysWithNullValues在解析时完成,不再遍历结果.
+ 其余情况(校验失败、非UTF-8编码、解析器无法处理的输入)交由父类处理
+ */
+@interface ACJSONResponseSerializer : AFJSONResponseSerializer
+
+@end
+
+NS_ASSUME_NONNULL_END
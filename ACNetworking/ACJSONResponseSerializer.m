@@ -0,0 +1,45 @@
+//
+//  ACJSONResponseSerializer.m
+//  ACNetworkingDemo
+//
+//  Created by Allen on 2019/3/13.
+//  Copyright © 2019 Allen. All rights reserved.
+//
+
+#import "ACJSONResponseSerializer.h"
+#import "ACJSONParser.h"
+
+@implementation ACJSONResponseSerializer
+
+#pragma mark - AFURLResponseSerialization
+
+- (id)responseObjectForResponse:(NSURLResponse *)response data:(NSData *)data error:(NSError *__autoreleasing *)error {
+    if (data.length == 0 || ![self isUTF8Response:response] || ![self validateResponse:(NSHTTPURLResponse *)response data:data error:NULL]) {
+        return [super responseObjectForResponse:response data:data error:error];
+    }
+    id responseObject = [ACJSONParser JSONObjectWithData:data options:self.readingOptions removesKeysWithNullValues:self.removesKeysWithNullValues vectorized:YES];
+    if (!responseObject) return [super responseObjectForResponse:response data:data error:error];
+    if (error) *error = nil;
+    return responseObject;
+}
+
+#pragma mark - Private
+
+/**
+ 响应是否以UTF-8编码,判断方式同父类
+
+ @param response 响应
+ @return 是否为UTF-8
+ */
+- (BOOL)isUTF8Response:(NSURLResponse *)response {
+    NSStringEncoding stringEncoding = self.stringEncoding;
+    if (response.textEncodingName) {
+        CFStringEncoding encoding = CFStringConvertIANACharSetNameToEncoding((__bridge CFStringRef)response.textEncodingName);
+        if (encoding != kCFStringEncodingInvalidId) {
+            stringEncoding = CFStringConvertEncodingToNSStringEncoding(encoding);
+        }
+    }
+    return stringEncoding == NSUTF8StringEncoding;
+}
+
+@end
@@ -0,0 +1,54 @@
+//
+//  ACJSONTape.h
+//  ACNetworkingDemo
+//
+//  Created by Allen on 2019/3/12.
+//  Copyright © 2019 Allen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ 紧凑的只读JSON编码(tape格式):所有值按先序排列为定长的tape,字符串集中存放并去重,容器记录其结束位置,可跳过整棵子树.
+ 解码时不构建对象图,返回直接在数据上查找的NSDictionary/NSArray子类,只有被访问到的值才会转换为Foundation对象.
+ 解码结果持有传入的data,配合NSDataReadingMappedIfSafe读取的文件,打开缓存只需校验文件头
+ */
+@interface ACJSONTape : NSObject
+
+/**
+ 将JSON对象编码为tape格式
+
+ @param object JSON对象,仅支持NSDictionary(key为NSString)、NSArray、NSString、NSNumber、NSNull
+ @return tape数据,包含不支持的对象时返回nil
+ */
++ (nullable NSData *)dataWithJSONObject:(id)object;
+
+/**
+ 判断数据是否为tape格式
+
+ @param data 数据
+ @return 是否为tape格式
+ */
++ (BOOL)isTapeData:(NSData *)data;
+
+/**
+ 解码tape数据,容器按需访问,其余值直接转换
+
+ @param data tape数据
+ @return JSON对象,数据无效时返回nil
+ */
++ (nullable id)JSONObjectWithData:(NSData *)data;
+
+/**
+ 解码结果所持有的tape数据大小
+
+ @param object JSON对象
+ @return object为解码出的容器时返回其tape数据的大小,否则返回0
+ */
++ (NSUInteger)dataLengthOfJSONObject:(id)object;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,590 @@
+//
+//  ACJSONTape.m
+//  ACNetworkingDemo
+//
+//  Created by Allen on 2019/3/12.
+//  Copyright © 2019 Allen. All rights reserved.
+//
+
+#import "ACJSONTape.h"
+
+/** 文件头,其后依次为tape(每个8字节)和字符串区 */
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t tapeCount;
+    uint32_t stringLength;
+} ACJSONTapeHeader;
+
+static const char ACJSONTapeMagic[4] = {'A', 'C', 'J', 'T'};
+
+static const uint32_t ACJSONTapeVersion = 1;
+
+/** tape高8位为类型,低56位为payload */
+static const uint64_t ACJSONTapePayloadMask = (1ULL << 56) - 1;
+
+typedef NS_ENUM(uint8_t, ACJSONTapeType) {
+    ACJSONTapeTypeNull = 'n',
+    ACJSONTapeTypeTrue = 't',
+    ACJSONTapeTypeFalse = 'f',
+    /** 下一个tape为int64 */
+    ACJSONTapeTypeInteger = 'l',
+    /** 下一个tape为uint64 */
+    ACJSONTapeTypeUnsigned = 'u',
+    /** 下一个tape为double */
+    ACJSONTapeTypeDouble = 'd',
+    /** payload为字符串区偏移,字符串以uint32长度开头,其后为UTF-8 */
+    ACJSONTapeTypeString = 's',
+    /** payload为对应结束tape的位置 */
+    ACJSONTapeTypeObjectStart = '{',
+    /** payload为键值对数 */
+    ACJSONTapeTypeObjectEnd = '}',
+    /** payload为对应结束tape的位置 */
+    ACJSONTapeTypeArrayStart = '[',
+    /** payload为元素数 */
+    ACJSONTapeTypeArrayEnd = ']'
+};
+
+/** 解码时访问的tape及字符串区 */
+typedef struct {
+    const uint8_t *tape;
+    NSUInteger tapeCount;
+    const uint8_t *strings;
+    NSUInteger stringLength;
+} ACJSONTapeBuffer;
+
+static inline uint64_t ACJSONTapeMakeWord(ACJSONTapeType type, uint64_t payload) {
+    return ((uint64_t)type << 56) | (payload & ACJSONTapePayloadMask);
+}
+
+static inline ACJSONTapeType ACJSONTapeWordType(uint64_t word) {
+    return (ACJSONTapeType)(word >> 56);
+}
+
+static inline uint64_t ACJSONTapeWordPayload(uint64_t word) {
+    return word & ACJSONTapePayloadMask;
+}
+
+/**
+ 读取tape,越界时返回0(无效类型)
+ */
+static inline uint64_t ACJSONTapeWordAtIndex(const ACJSONTapeBuffer *buffer, NSUInteger index) {
+    if (index >= buffer->tapeCount) return 0;
+    uint64_t word;
+    memcpy(&word, buffer->tape + index * sizeof(uint64_t), sizeof(uint64_t));
+    return word;
+}
+
+/**
+ 跳过index处的值(含整棵子树)
+
+ @return 下一个值的位置,数据无效时返回NSNotFound
+ */
+static NSUInteger ACJSONTapeNextIndex(const ACJSONTapeBuffer *buffer, NSUInteger index) {
+    uint64_t word = ACJSONTapeWordAtIndex(buffer, index);
+    switch (ACJSONTapeWordType(word)) {
+        case ACJSONTapeTypeNull:
+        case ACJSONTapeTypeTrue:
+        case ACJSONTapeTypeFalse:
+        case ACJSONTapeTypeString:
+            return index + 1;
+        case ACJSONTapeTypeInteger:
+        case ACJSONTapeTypeUnsigned:
+        case ACJSONTapeTypeDouble:
+            return index + 1 < buffer->tapeCount ? index + 2 : NSNotFound;
+        case ACJSONTapeTypeObjectStart:
+        case ACJSONTapeTypeArrayStart: {
+            uint64_t end = ACJSONTapeWordPayload(word);
+            return end > index && end < buffer->tapeCount ? (NSUInteger)end + 1 : NSNotFound;
+        }
+        default:
+            return NSNotFound;
+    }
+}
+
+/**
+ 获取index处字符串的UTF-8数据,不复制
+ */
+static BOOL ACJSONTapeStringAtIndex(const ACJSONTapeBuffer *buffer, NSUInteger index, const uint8_t **bytes, uint32_t *length) {
+    uint64_t word = ACJSONTapeWordAtIndex(buffer, index);
+    if (ACJSONTapeWordType(word) != ACJSONTapeTypeString) return NO;
+    uint64_t offset = ACJSONTapeWordPayload(word);
+    if (offset + sizeof(uint32_t) > buffer->stringLength) return NO;
+    memcpy(length, buffer->strings + offset, sizeof(uint32_t));
+    if (offset + sizeof(uint32_t) + *length > buffer->stringLength) return NO;
+    *bytes = buffer->strings + offset + sizeof(uint32_t);
+    return YES;
+}
+
+/**
+ 键的UTF-8数据的FNV-1a hash,用于字典的键索引
+ */
+static inline uint32_t ACJSONTapeHashBytes(const uint8_t *bytes, NSUInteger length) {
+    uint32_t hash = 2166136261u;
+    for (NSUInteger i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/** 键值对数超过该值的字典建立键索引,较小的字典直接逐个比较 */
+static const NSUInteger ACJSONTapeDictionaryIndexThreshold = 8;
+
+#pragma mark - Encoder
+
+/** 编码器,字符串去重后存放 */
+@interface ACJSONTapeEncoder : NSObject
+
+@property (nonatomic, strong) NSMutableData *tape;
+
+@property (nonatomic, strong) NSMutableData *strings;
+
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSNumber *> *stringOffsets;
+
+@end
+
+@implementation ACJSONTapeEncoder
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _tape = [NSMutableData data];
+        _strings = [NSMutableData data];
+        _stringOffsets = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+- (NSUInteger)tapeCount {
+    return self.tape.length / sizeof(uint64_t);
+}
+
+- (void)appendWord:(uint64_t)word {
+    [self.tape appendBytes:&word length:sizeof(uint64_t)];
+}
+
+- (void)setWord:(uint64_t)word atIndex:(NSUInteger)index {
+    [self.tape replaceBytesInRange:NSMakeRange(index * sizeof(uint64_t), sizeof(uint64_t)) withBytes:&word];
+}
+
+- (BOOL)appendString:(NSString *)string {
+    NSNumber *offset = self.stringOffsets[string];
+    if (!offset) {
+        NSData *data = [string dataUsingEncoding:NSUTF8StringEncoding];
+        if (!data || data.length > UINT32_MAX) return NO;
+        offset = @(self.strings.length);
+        uint32_t length = (uint32_t)data.length;
+        [self.strings appendBytes:&length length:sizeof(uint32_t)];
+        [self.strings appendData:data];
+        self.stringOffsets[string] = offset;
+    }
+    [self appendWord:ACJSONTapeMakeWord(ACJSONTapeTypeString, offset.unsignedLongLongValue)];
+    return YES;
+}
+
+- (BOOL)appendNumber:(NSNumber *)number {
+    if (CFGetTypeID((__bridge CFTypeRef)number) == CFBooleanGetTypeID()) {
+        [self appendWord:ACJSONTapeMakeWord(number.boolValue ? ACJSONTapeTypeTrue : ACJSONTapeTypeFalse, 0)];
+        return YES;
+    }
+    const char *type = number.objCType;
+    if (strcmp(type, @encode(double)) == 0 || strcmp(type, @encode(float)) == 0) {
+        double value = number.doubleValue;
+        uint64_t word;
+        memcpy(&word, &value, sizeof(uint64_t));
+        [self appendWord:ACJSONTapeMakeWord(ACJSONTapeTypeDouble, 0)];
+        [self appendWord:word];
+    } else if (strcmp(type, @encode(unsigned long long)) == 0 || strcmp(type, @encode(unsigned long)) == 0) {
+        [self appendWord:ACJSONTapeMakeWord(ACJSONTapeTypeUnsigned, 0)];
+        [self appendWord:number.unsignedLongLongValue];
+    } else {
+        [self appendWord:ACJSONTapeMakeWord(ACJSONTapeTypeInteger, 0)];
+        [self appendWord:(uint64_t)number.longLongValue];
+    }
+    return YES;
+}
+
+- (BOOL)appendObject:(id)object {
+    if ([object isKindOfClass:NSDictionary.class]) {
+        NSUInteger start = self.tapeCount;
+        [self appendWord:0];
+        __block BOOL valid = YES;
+        [(NSDictionary *)object enumerateKeysAndObjectsUsingBlock:^(id key, id value, BOOL *stop) {
+            if (![key isKindOfClass:NSString.class] || ![self appendString:key] || ![self appendObject:value]) {
+                valid = NO;
+                *stop = YES;
+            }
+        }];
+        if (!valid) return NO;
+        [self setWord:ACJSONTapeMakeWord(ACJSONTapeTypeObjectStart, self.tapeCount) atIndex:start];
+        [self appendWord:ACJSONTapeMakeWord(ACJSONTapeTypeObjectEnd, [object count])];
+    } else if ([object isKindOfClass:NSArray.class]) {
+        NSUInteger start = self.tapeCount;
+        [self appendWord:0];
+        for (id value in (NSArray *)object) {
+            if (![self appendObject:value]) return NO;
+        }
+        [self setWord:ACJSONTapeMakeWord(ACJSONTapeTypeArrayStart, self.tapeCount) atIndex:start];
+        [self appendWord:ACJSONTapeMakeWord(ACJSONTapeTypeArrayEnd, [object count])];
+    } else if ([object isKindOfClass:NSString.class]) {
+        return [self appendString:object];
+    } else if ([object isKindOfClass:NSNumber.class]) {
+        return [self appendNumber:object];
+    } else if ([object isKindOfClass:NSNull.class]) {
+        [self appendWord:ACJSONTapeMakeWord(ACJSONTapeTypeNull, 0)];
+    } else {
+        return NO;
+    }
+    return YES;
+}
+
+@end
+
+#pragma mark - Document
+
+/** 解码后的tape数据,持有原始data,供各容器共享 */
+@interface ACJSONTapeDocument : NSObject {
+    @public
+    ACJSONTapeBuffer _buffer;
+}
+
+@property (nonatomic, strong, readonly) NSData *data;
+
+- (instancetype)initWithData:(NSData *)data;
+
+/**
+ 获取index处的值,容器返回按需访问的NSDictionary/NSArray
+
+ @param index tape位置
+ @return 值,数据无效时返回nil
+ */
+- (id)objectAtTapeIndex:(NSUInteger)index;
+
+/**
+ 获取容器中index处的值,子容器缓存在父容器的children中,重复访问同一子容器不再重新生成元素位置或键索引.可在任意线程调用
+
+ @param index tape位置
+ @param children 父容器的子容器缓存,首次缓存时创建
+ @return 值,数据无效时返回nil
+ */
+- (id)objectAtTapeIndex:(NSUInteger)index children:(NSMutableDictionary<NSNumber *, id> * __strong *)children;
+
+@end
+
+@interface ACJSONTapeDictionary : NSDictionary
+
+@property (nonatomic, strong, readonly) ACJSONTapeDocument *document;
+
+- (instancetype)initWithDocument:(ACJSONTapeDocument *)document index:(NSUInteger)index;
+
+@end
+
+@interface ACJSONTapeArray : NSArray
+
+@property (nonatomic, strong, readonly) ACJSONTapeDocument *document;
+
+- (instancetype)initWithDocument:(ACJSONTapeDocument *)document index:(NSUInteger)index;
+
+@end
+
+@implementation ACJSONTapeDocument {
+    /** 保护各容器的children */
+    dispatch_semaphore_t _lock;
+}
+
+- (instancetype)initWithData:(NSData *)data {
+    if (self = [super init]) {
+        _lock = dispatch_semaphore_create(1);
+        ACJSONTapeHeader header;
+        [data getBytes:&header length:sizeof(ACJSONTapeHeader)];
+        const uint8_t *bytes = data.bytes;
+        _data = data;
+        _buffer.tape = bytes + sizeof(ACJSONTapeHeader);
+        _buffer.tapeCount = header.tapeCount;
+        _buffer.strings = _buffer.tape + (NSUInteger)header.tapeCount * sizeof(uint64_t);
+        _buffer.stringLength = header.stringLength;
+    }
+    return self;
+}
+
+- (id)objectAtTapeIndex:(NSUInteger)index {
+    const ACJSONTapeBuffer *buffer = &_buffer;
+    uint64_t word = ACJSONTapeWordAtIndex(buffer, index);
+    switch (ACJSONTapeWordType(word)) {
+        case ACJSONTapeTypeNull:
+            return [NSNull null];
+        case ACJSONTapeTypeTrue:
+            return @YES;
+        case ACJSONTapeTypeFalse:
+            return @NO;
+        case ACJSONTapeTypeInteger:
+            if (index + 1 >= buffer->tapeCount) return nil;
+            return @((int64_t)ACJSONTapeWordAtIndex(buffer, index + 1));
+        case ACJSONTapeTypeUnsigned:
+            if (index + 1 >= buffer->tapeCount) return nil;
+            return @(ACJSONTapeWordAtIndex(buffer, index + 1));
+        case ACJSONTapeTypeDouble: {
+            if (index + 1 >= buffer->tapeCount) return nil;
+            uint64_t bits = ACJSONTapeWordAtIndex(buffer, index + 1);
+            double value;
+            memcpy(&value, &bits, sizeof(double));
+            return @(value);
+        }
+        case ACJSONTapeTypeString: {
+            const uint8_t *bytes = NULL;
+            uint32_t length = 0;
+            if (!ACJSONTapeStringAtIndex(buffer, index, &bytes, &length)) return nil;
+            return [[NSString alloc] initWithBytes:bytes length:length encoding:NSUTF8StringEncoding];
+        }
+        case ACJSONTapeTypeObjectStart:
+            if (ACJSONTapeNextIndex(buffer, index) == NSNotFound) return nil;
+            return [[ACJSONTapeDictionary alloc] initWithDocument:self index:index];
+        case ACJSONTapeTypeArrayStart:
+            if (ACJSONTapeNextIndex(buffer, index) == NSNotFound) return nil;
+            return [[ACJSONTapeArray alloc] initWithDocument:self index:index];
+        default:
+            return nil;
+    }
+}
+
+- (id)objectAtTapeIndex:(NSUInteger)index children:(NSMutableDictionary<NSNumber *, id> * __strong *)children {
+    ACJSONTapeType type = ACJSONTapeWordType(ACJSONTapeWordAtIndex(&_buffer, index));
+    if (type != ACJSONTapeTypeObjectStart && type != ACJSONTapeTypeArrayStart) return [self objectAtTapeIndex:index];
+    NSNumber *key = @(index);
+    dispatch_semaphore_wait(_lock, DISPATCH_TIME_FOREVER);
+    id child = (*children)[key];
+    dispatch_semaphore_signal(_lock);
+    if (child) return child;
+    /** 在锁外创建,并发访问同一子容器时保留先缓存的 */
+    child = [self objectAtTapeIndex:index];
+    if (!child) return nil;
+    dispatch_semaphore_wait(_lock, DISPATCH_TIME_FOREVER);
+    if (!*children) *children = [NSMutableDictionary dictionary];
+    id cached = (*children)[key];
+    if (cached) {
+        child = cached;
+    } else {
+        (*children)[key] = child;
+    }
+    dispatch_semaphore_signal(_lock);
+    return child;
+}
+
+@end
+
+#pragma mark - Dictionary
+
+@implementation ACJSONTapeDictionary {
+    NSUInteger _start;
+    NSUInteger _end;
+    NSUInteger _count;
+    /** 键索引,开放寻址:高32位为键的hash,低32位为键的tape位置+1,0为空槽.小字典为NULL */
+    uint64_t *_slots;
+    NSUInteger _slotMask;
+    /** 已访问过的子容器,key为其tape位置 */
+    NSMutableDictionary<NSNumber *, id> *_children;
+}
+
+- (instancetype)initWithDocument:(ACJSONTapeDocument *)document index:(NSUInteger)index {
+    if (self = [super init]) {
+        _document = document;
+        _start = index;
+        _end = (NSUInteger)ACJSONTapeWordPayload(ACJSONTapeWordAtIndex(&document->_buffer, index));
+        uint64_t endWord = ACJSONTapeWordAtIndex(&document->_buffer, _end);
+        _count = ACJSONTapeWordType(endWord) == ACJSONTapeTypeObjectEnd ? (NSUInteger)ACJSONTapeWordPayload(endWord) : 0;
+        /** 每个键值对至少占2个tape,防止损坏的数据给出过大的count */
+        _count = MIN(_count, (_end - _start - 1) / 2);
+        if (_count > ACJSONTapeDictionaryIndexThreshold) [self buildKeyIndex];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_slots);
+}
+
+/**
+ 建立键索引,槽位数为键值对数的2倍以上,数据损坏时只索引损坏处之前的键
+ */
+- (void)buildKeyIndex {
+    NSUInteger capacity = 16;
+    while (capacity < _count * 2) capacity <<= 1;
+    _slots = calloc(capacity, sizeof(uint64_t));
+    if (!_slots) return;
+    _slotMask = capacity - 1;
+    const ACJSONTapeBuffer *buffer = &_document->_buffer;
+    NSUInteger index = _start + 1;
+    while (index < _end) {
+        const uint8_t *bytes = NULL;
+        uint32_t length = 0;
+        if (!ACJSONTapeStringAtIndex(buffer, index, &bytes, &length)) break;
+        uint32_t hash = ACJSONTapeHashBytes(bytes, length);
+        NSUInteger slot = hash & _slotMask;
+        while (_slots[slot]) slot = (slot + 1) & _slotMask;
+        _slots[slot] = ((uint64_t)hash << 32) | (uint64_t)(index + 1);
+        index = ACJSONTapeNextIndex(buffer, index + 1);
+        if (index == NSNotFound) break;
+    }
+}
+
+- (NSUInteger)count {
+    return _count;
+}
+
+/**
+ 比较key的UTF-8数据找到键,只转换命中的值:有键索引时按hash查找,否则在tape上逐个比较
+ */
+- (id)objectForKey:(id)aKey {
+    if (![aKey isKindOfClass:NSString.class]) return nil;
+    NSString *key = aKey;
+    char stackBuffer[256];
+    const void *keyBytes = stackBuffer;
+    NSUInteger keyLength = 0;
+    NSRange remaining;
+    NSData *keyData = nil;
+    [key getBytes:stackBuffer maxLength:sizeof(stackBuffer) usedLength:&keyLength encoding:NSUTF8StringEncoding options:0 range:NSMakeRange(0, key.length) remainingRange:&remaining];
+    if (remaining.length > 0) {
+        keyData = [key dataUsingEncoding:NSUTF8StringEncoding];
+        keyBytes = keyData.bytes;
+        keyLength = keyData.length;
+    }
+    const ACJSONTapeBuffer *buffer = &_document->_buffer;
+    if (_slots) {
+        uint32_t hash = ACJSONTapeHashBytes(keyBytes, keyLength);
+        for (NSUInteger slot = hash & _slotMask; _slots[slot]; slot = (slot + 1) & _slotMask) {
+            if ((uint32_t)(_slots[slot] >> 32) != hash) continue;
+            NSUInteger index = (NSUInteger)(_slots[slot] & UINT32_MAX) - 1;
+            const uint8_t *bytes = NULL;
+            uint32_t length = 0;
+            if (ACJSONTapeStringAtIndex(buffer, index, &bytes, &length) && length == keyLength && memcmp(bytes, keyBytes, length) == 0) return [_document objectAtTapeIndex:index + 1 children:&_children];
+        }
+        return nil;
+    }
+    NSUInteger index = _start + 1;
+    while (index < _end) {
+        const uint8_t *bytes = NULL;
+        uint32_t length = 0;
+        if (!ACJSONTapeStringAtIndex(buffer, index, &bytes, &length)) return nil;
+        if (length == keyLength && memcmp(bytes, keyBytes, length) == 0) return [_document objectAtTapeIndex:index + 1 children:&_children];
+        index = ACJSONTapeNextIndex(buffer, index + 1);
+        if (index == NSNotFound) return nil;
+    }
+    return nil;
+}
+
+- (NSEnumerator *)keyEnumerator {
+    NSMutableArray<NSString *> *keys = [NSMutableArray arrayWithCapacity:_count];
+    const ACJSONTapeBuffer *buffer = &_document->_buffer;
+    NSUInteger index = _start + 1;
+    while (index < _end) {
+        NSString *key = [_document objectAtTapeIndex:index];
+        if (![key isKindOfClass:NSString.class]) break;
+        [keys addObject:key];
+        index = ACJSONTapeNextIndex(buffer, index + 1);
+        if (index == NSNotFound) break;
+    }
+    return [keys objectEnumerator];
+}
+
+/** 归档时按普通NSDictionary处理 */
+- (Class)classForCoder {
+    return NSDictionary.class;
+}
+
+@end
+
+#pragma mark - Array
+
+@implementation ACJSONTapeArray {
+    NSUInteger _start;
+    NSUInteger _count;
+    /** 各元素的tape位置,初始化时生成,之后只读 */
+    NSUInteger *_offsets;
+    /** 已访问过的子容器,key为其tape位置 */
+    NSMutableDictionary<NSNumber *, id> *_children;
+}
+
+- (instancetype)initWithDocument:(ACJSONTapeDocument *)document index:(NSUInteger)index {
+    if (self = [super init]) {
+        _document = document;
+        _start = index;
+        NSUInteger end = (NSUInteger)ACJSONTapeWordPayload(ACJSONTapeWordAtIndex(&document->_buffer, index));
+        uint64_t endWord = ACJSONTapeWordAtIndex(&document->_buffer, end);
+        _count = ACJSONTapeWordType(endWord) == ACJSONTapeTypeArrayEnd ? (NSUInteger)ACJSONTapeWordPayload(endWord) : 0;
+        /** 每个元素至少占1个tape,防止损坏的数据给出过大的count */
+        _count = MIN(_count, end - _start - 1);
+        _offsets = _count > 0 ? malloc(sizeof(NSUInteger) * _count) : NULL;
+        if (!_offsets) _count = 0;
+        NSUInteger tapeIndex = _start + 1;
+        for (NSUInteger i = 0; i < _count; i++) {
+            _offsets[i] = tapeIndex;
+            if (tapeIndex != NSNotFound) tapeIndex = ACJSONTapeNextIndex(&document->_buffer, tapeIndex);
+        }
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_offsets);
+}
+
+- (NSUInteger)count {
+    return _count;
+}
+
+- (id)objectAtIndex:(NSUInteger)index {
+    if (index >= _count) [NSException raise:NSRangeException format:@"index %lu beyond bounds [0 .. %ld]", (unsigned long)index, (long)_count - 1];
+    NSUInteger tapeIndex = _offsets[index];
+    id object = tapeIndex == NSNotFound ? nil : [_document objectAtTapeIndex:tapeIndex children:&_children];
+    /** 数据损坏时以NSNull占位,保持与count一致 */
+    return object ?: [NSNull null];
+}
+
+/** 归档时按普通NSArray处理 */
+- (Class)classForCoder {
+    return NSArray.class;
+}
+
+@end
+
+#pragma mark - ACJSONTape
+
+@implementation ACJSONTape
+
++ (NSData *)dataWithJSONObject:(id)object {
+    if (!object) return nil;
+    ACJSONTapeEncoder *encoder = [ACJSONTapeEncoder new];
+    if (![encoder appendObject:object]) return nil;
+    if (encoder.tapeCount > UINT32_MAX || encoder.strings.length > UINT32_MAX) return nil;
+    ACJSONTapeHeader header;
+    memcpy(header.magic, ACJSONTapeMagic, sizeof(header.magic));
+    header.version = ACJSONTapeVersion;
+    header.tapeCount = (uint32_t)encoder.tapeCount;
+    header.stringLength = (uint32_t)encoder.strings.length;
+    NSMutableData *data = [NSMutableData dataWithCapacity:sizeof(ACJSONTapeHeader) + encoder.tape.length + encoder.strings.length];
+    [data appendBytes:&header length:sizeof(ACJSONTapeHeader)];
+    [data appendData:encoder.tape];
+    [data appendData:encoder.strings];
+    return data;
+}
+
++ (BOOL)isTapeData:(NSData *)data {
+    if (data.length < sizeof(ACJSONTapeHeader)) return NO;
+    ACJSONTapeHeader header;
+    [data getBytes:&header length:sizeof(ACJSONTapeHeader)];
+    if (memcmp(header.magic, ACJSONTapeMagic, sizeof(header.magic)) != 0 || header.version != ACJSONTapeVersion) return NO;
+    return data.length >= sizeof(ACJSONTapeHeader) + (NSUInteger)header.tapeCount * sizeof(uint64_t) + header.stringLength;
+}
+
++ (id)JSONObjectWithData:(NSData *)data {
+    if (![self isTapeData:data]) return nil;
+    return [[[ACJSONTapeDocument alloc] initWithData:data] objectAtTapeIndex:0];
+}
+
++ (NSUInteger)dataLengthOfJSONObject:(id)object {
+    if ([object isKindOfClass:ACJSONTapeDictionary.class]) return [(ACJSONTapeDictionary *)object document].data.length;
+    if ([object isKindOfClass:ACJSONTapeArray.class]) return [(ACJSONTapeArray *)object document].data.length;
+    return 0;
+}
+
+@end
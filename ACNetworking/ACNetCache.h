@@ -8,6 +8,7 @@
 
 #import <Foundation/Foundation.h>
 #import "ACNetCacheKeyGenerator.h"
+#import "ACNetCacheAdmissionPolicy.h"
 
 typedef NS_ENUM(NSUInteger, ACNetCacheType) {
     /** 无缓存 */
@@ -17,11 +18,28 @@ typedef NS_ENUM(NSUInteger, ACNetCacheType) {
     /** 磁盘缓存 */
     ACNetCacheTypeDisk,
     /** 网络数据 */
-    ACNetCacheTypeNet
+    ACNetCacheTypeNet,
+    /** 缓存的失败结果(如404或空结果) */
+    ACNetCacheTypeNegative
 };
 
 typedef void(^ACNetCacheFetchCompletion)(ACNetCacheType type, id response, NSDate *cacheDate);
 
+@class ACNetCacheResult;
+
+typedef void(^ACNetCacheBatchFetchCompletion)(NSArray<ACNetCacheResult *> *results);
+
+typedef id _Nullable (^ACNetCacheDataDecoder)(NSData * _Nonnull data);
+
+/**
+ 结果缓存标签产生器
+
+ @param url url
+ @param param 传参
+ @return 标签
+ */
+typedef NSArray<NSString *> * _Nullable (^ACNetCacheTagGenerator)(NSString * _Nonnull url, NSDictionary * _Nullable param);
+
 typedef NSTimeInterval Expire_Time;
 
 /** 永不过期 */
@@ -32,6 +50,26 @@ static Expire_Time Expire_Time_Always = 0;
 
 NS_ASSUME_NONNULL_BEGIN
 
+/** 批量获取缓存时的单条结果 */
+@interface ACNetCacheResult : NSObject
+
+/** 缓存Key */
+@property (nonatomic, copy, readonly) NSString *key;
+
+/** 缓存类型,未命中为ACNetCacheTypeNone */
+@property (nonatomic, assign, readonly) ACNetCacheType type;
+
+/** 缓存的response */
+@property (nonatomic, strong, readonly, nullable) id response;
+
+/** 缓存时间 */
+@property (nonatomic, strong, readonly, nullable) NSDate *cacheDate;
+
+@end
+
+/** 缓存的失败结果error中,userInfo里对应HTTP状态码的key */
+FOUNDATION_EXTERN NSString * const ACNetCacheFailureStatusCodeKey;
+
 @interface ACNetCache : NSObject
 
 /** 单例 */
@@ -40,6 +78,61 @@ NS_ASSUME_NONNULL_BEGIN
 /** 缓存Key生成器,默认为DefaultKeyGenerator */
 @property (nonatomic, copy) ACNetCacheKeyGenerator keyGenerator;
 
+/** 异步读取磁盘缓存后的回调队列,默认为主队列 */
+@property (nonatomic, strong, null_resettable) dispatch_queue_t completionQueue;
+
+/** 是否以内容寻址方式存储磁盘缓存,默认NO.开启后相同内容只存一份,缓存文件仅记录内容的SHA256,重复缓存未变化的结果只更新索引.
+ 内容的引用计数只在本进程中维护,共享模式下始终为NO */
+@property (nonatomic, assign) BOOL contentAddressed;
+
+/** 磁盘缓存是否以tape格式存储JSON结果,默认NO.开启后磁盘命中不再构建完整的对象图,返回的NSDictionary/NSArray直接在映射的文件上按需查找,只转换访问到的值;非JSON结果仍以归档存储 */
+@property (nonatomic, assign) BOOL tapeEncodingEnabled;
+
+/** 流式缓存的原始数据从磁盘读取时的解析方法,默认按JSON解析.在缓存的IO队列中调用 */
+@property (nonatomic, copy, null_resettable) ACNetCacheDataDecoder streamedResponseDecoder;
+
+/** 存储时未指定标签的结果所用的标签产生器,默认nil即不打标签 */
+@property (nonatomic, copy, nullable) ACNetCacheTagGenerator tagGenerator;
+
+/** 内存缓存的字节预算,默认32MB,为0时不限制.每个结果按序列化数据的大小(tape结果按tape数据大小)计入,尚未序列化的结果先按元素数粗略估算,在后台序列化后更新;超出预算时从最久未访问的结果开始淘汰 */
+@property (nonatomic, assign) NSUInteger memoryCacheByteBudget;
+
+/** 结果在内存中自写入起的最长保留时间,默认Expire_Time_Never.到期的结果由后台时间轮主动回收(磁盘缓存不受影响),使内存只保留仍在使用的结果 */
+@property (nonatomic, assign) Expire_Time memoryCacheMaximumAge;
+
+/** 单个结果写入内存的最大估算大小,默认4MB,超出的结果只写磁盘,避免一个大结果挤掉大量热点小结果.为0时不限制 */
+@property (nonatomic, assign) NSUInteger maximumMemoryEntryCost;
+
+/** 跨进程共享内存层的大小(字节),默认0即不启用.启用后写入内存的结果序列化存入映射文件中的共享区域,同一主机上使用相同命名空间和目录的进程共用一份;
+    共享区域分为两段轮流写入,写满时只回收较旧一段中的结果.结果在后台序列化后写入共享区域,本进程的内存缓存只存放尚未写入或写入失败的结果,读取时先查共享区域再查本进程.
+    需在创建后立即设置,各进程应设置相同的值,文件已存在时以文件大小为准 */
+@property (nonatomic, assign) NSUInteger sharedMemoryByteBudget;
+
+/** 内存缓存准入策略,默认nil即全部写入内存.可设为ACNetCacheTinyLFUPolicy,内存缓存需要淘汰时只写入比被淘汰者访问更频繁的结果,只访问一次的结果只写磁盘.
+    未准入的结果不会改写到磁盘:只写内存(toDisk为NO)的结果未准入时直接丢弃 */
+@property (nonatomic, strong, nullable) id<ACNetCacheAdmissionPolicy> admissionPolicy;
+
+/** 启动时预加载到内存的热点缓存总大小(字节),默认4MB.为0时不统计热点也不预加载,需在创建后立即设置 */
+@property (nonatomic, assign) NSUInteger hotSetByteBudget;
+
+/** 热点Key清单的最大数量,默认256 */
+@property (nonatomic, assign) NSUInteger hotSetCapacity;
+
+/** 是否缓存失败结果(如404或空结果),缓存期间同一请求直接返回失败,不再请求网络.默认NO */
+@property (nonatomic, assign) BOOL negativeCacheEnabled;
+
+/** 失败结果的缓存时长,默认30秒 */
+@property (nonatomic, assign) Expire_Time negativeCacheExpire;
+
+/** 需要缓存的失败状态码,默认404和410 */
+@property (nonatomic, copy) NSIndexSet *negativeCacheStatusCodes;
+
+/** 缓存代数,从0开始,每次deleteAllResponses(共享模式下包括其他进程的)加1,此前写入的结果全部失效 */
+@property (atomic, assign, readonly) NSUInteger generation;
+
+/** 是否与其他进程共享磁盘缓存目录,见cacheWithNamespace:directiory:keyGenerator:shared: */
+@property (nonatomic, assign, readonly, getter=isShared) BOOL shared;
+
 #pragma mark - Constructor
 
 /**
@@ -68,6 +161,19 @@ NS_ASSUME_NONNULL_BEGIN
  */
 + (instancetype)cacheWithNamespace:(NSString *)ns directiory:(nullable NSString *)directory keyGenerator:(nullable ACNetCacheKeyGenerator)keyGenerator;
 
+/**
+ 实例化.shared为YES时,多个进程(如主App与扩展)可以使用同一命名空间和目录:
+ 磁盘修改以文件锁互斥并记入共享的变更日志,各进程据此更新keyFilter并使内存中被其他进程修改或删除的结果失效,
+ deleteAllResponses对所有进程生效.共享模式下不支持contentAddressed.共享状态文件创建失败时退化为非共享模式
+
+ @param ns 命名空间
+ @param directory 缓存目录,多进程共享时应为共享容器中的目录
+ @param keyGenerator 缓存Key生成器
+ @param shared 是否与其他进程共享
+ @return 实例
+ */
++ (instancetype)cacheWithNamespace:(NSString *)ns directiory:(nullable NSString *)directory keyGenerator:(nullable ACNetCacheKeyGenerator)keyGenerator shared:(BOOL)shared;
+
 #pragma mark - Check
 
 /**
@@ -148,6 +254,68 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (BOOL)diskCacheExistsForUrl:(NSString *)url param:(NSDictionary *)param expires:(Expire_Time)expire;
 
+#pragma mark - Memory
+
+/**
+ 同步获取内存缓存的response,不过期,不读磁盘,无block和队列切换开销
+ 
+ @param url URL
+ @param param 请求参数
+ @return 内存中缓存的response,未命中返回nil
+ */
+- (nullable id)responseForUrl:(NSString *)url param:(nullable NSDictionary *)param;
+
+/**
+ 同步获取内存缓存的response,不读磁盘
+ 
+ @param url URL
+ @param param 请求参数
+ @param expire 过期时间
+ @return 内存中缓存的response,未命中返回nil
+ */
+- (nullable id)responseForUrl:(NSString *)url param:(nullable NSDictionary *)param expires:(Expire_Time)expire;
+
+/**
+ 同步获取内存缓存的response,不读磁盘
+ 
+ @param url URL
+ @param param 请求参数
+ @param generator 缓存Key生成器
+ @param expire 过期时间
+ @param cacheDate 缓存时间
+ @return 内存中缓存的response,未命中返回nil
+ */
+- (nullable id)responseForUrl:(NSString *)url param:(nullable NSDictionary *)param keyGenerator:(nullable ACNetCacheKeyGenerator)generator expires:(Expire_Time)expire cacheDate:(NSDate * _Nullable * _Nullable)cacheDate;
+
+#pragma mark - Model
+
+/**
+ 同步获取内存中由缓存结果解析出的模型,仅当模型对应的结果仍是内存中的缓存结果时有效
+ 
+ @param url URL
+ @param param 请求参数
+ @param generator 缓存Key生成器
+ @param decoder 解析器名称
+ @param expire 过期时间
+ @param cacheDate 缓存时间
+ @return 模型,未命中返回nil
+ */
+- (nullable id)modelForUrl:(NSString *)url param:(nullable NSDictionary *)param keyGenerator:(nullable ACNetCacheKeyGenerator)generator decoder:(NSString *)decoder expires:(Expire_Time)expire cacheDate:(NSDate * _Nullable * _Nullable)cacheDate;
+
+/**
+ 缓存由response解析出的模型到内存.response须为当前缓存的结果,内存中没有结果时(如磁盘命中)一并缓存response;
+ 之后结果被更新或删除,模型随之失效.启用共享内存层时模型绑定到共享区域中该结果的写入时间,response不写入本进程的内存缓存
+ 
+ @param model 模型
+ @param decoder 解析器名称
+ @param response 解析模型所用的结果
+ @param cacheDate response的缓存时间
+ @param url URL
+ @param param 请求参数
+ @param generator 缓存Key生成器
+ */
+- (void)storeModel:(id)model decoder:(NSString *)decoder forResponse:(id)response cacheDate:(nullable NSDate *)cacheDate url:(NSString *)url param:(nullable NSDictionary *)param keyGenerator:(nullable ACNetCacheKeyGenerator)generator;
+
 #pragma mark - Store
 
 /**
@@ -169,6 +337,17 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (void)storeResponse:(id)response forUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(ACNetCacheKeyGenerator)generator;
 
+/**
+ 缓存请求得到的response,generation与当前不同(请求发出后调用过deleteAllResponses)时丢弃,避免登出等清空缓存后旧请求的结果又被写回
+ 
+ @param response 要缓存的结果
+ @param url URL
+ @param param 请求参数
+ @param generator 缓存Key生成器
+ @param generation 发出请求时的generation
+ */
+- (void)storeResponse:(id)response forUrl:(NSString *)url param:(nullable NSDictionary *)param keyGenerator:(nullable ACNetCacheKeyGenerator)generator generation:(NSUInteger)generation;
+
 /**
  缓存response
  
@@ -192,6 +371,19 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (void)storeResponse:(id)response forUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(nullable ACNetCacheKeyGenerator)generator toMemory:(BOOL)toMemory toDisk:(BOOL)toDisk;
 
+/**
+ 缓存response并打上标签,标签与URL路径记录在二级索引中,可用deleteResponsesWithTag:或deleteResponsesWithURLPrefix:删除
+ 
+ @param response 要缓存的结果
+ @param url URL
+ @param param 请求参数
+ @param generator 缓存Key生成器
+ @param tags 标签,nil时使用tagGenerator
+ @param toMemory 是否缓存到内存
+ @param toDisk 是否缓存到磁盘
+ */
+- (void)storeResponse:(id)response forUrl:(NSString *)url param:(nullable NSDictionary *)param keyGenerator:(nullable ACNetCacheKeyGenerator)generator tags:(nullable NSArray<NSString *> *)tags toMemory:(BOOL)toMemory toDisk:(BOOL)toDisk;
+
 #pragma mark - Fetch
 
 /**
@@ -225,6 +417,19 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (void)fetchResponseForUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(nullable ACNetCacheKeyGenerator)generator expires:(Expire_Time)expire async:(BOOL)async completion:(ACNetCacheFetchCompletion)completion;
 
+/**
+ 获取本地缓存的response
+ 
+ @param url URL
+ @param param 请求参数
+ @param generator 缓存Key生成器
+ @param expire 过期时间
+ @param async 是否异步
+ @param queue 异步读取磁盘缓存后的回调队列,传nil则使用self.completionQueue
+ @param completion 回调
+ */
+- (void)fetchResponseForUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(nullable ACNetCacheKeyGenerator)generator expires:(Expire_Time)expire async:(BOOL)async completionQueue:(nullable dispatch_queue_t)queue completion:(ACNetCacheFetchCompletion)completion;
+
 /**
  获取本地缓存的response
  
@@ -236,6 +441,125 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (void)fetchResponseForUrl:(NSString *)url param:(NSDictionary *)param expires:(Expire_Time)expire async:(BOOL)async completion:(nullable ACNetCacheFetchCompletion)completion;
 
+#pragma mark - Batch
+
+/**
+ 生成缓存Key,可用于批量获取或缓存
+ 
+ @param url URL
+ @param param 请求参数
+ @param generator 缓存Key生成器
+ @return 缓存Key
+ */
+- (NSString *)cacheKeyForUrl:(NSString *)url param:(nullable NSDictionary *)param keyGenerator:(nullable ACNetCacheKeyGenerator)generator;
+
+/**
+ 批量获取本地缓存的response.内存命中的直接取出,其余的在一次磁盘操作中按Key顺序读取,最后统一回调一次
+ 
+ @param keys 缓存Key
+ @param expire 过期时间
+ @param completion 回调(磁盘读取后在self.completionQueue中回调),results与keys一一对应
+ */
+- (void)fetchResponsesForKeys:(NSArray<NSString *> *)keys expires:(Expire_Time)expire completion:(ACNetCacheBatchFetchCompletion)completion;
+
+/**
+ 批量获取本地缓存的response
+ 
+ @param urls URL
+ @param params 请求参数,与urls一一对应,无参数的位置传NSNull;传nil表示均无参数
+ @param generator 缓存Key生成器
+ @param expire 过期时间
+ @param completion 回调,results与urls一一对应
+ */
+- (void)fetchResponsesForUrls:(NSArray<NSString *> *)urls params:(nullable NSArray *)params keyGenerator:(nullable ACNetCacheKeyGenerator)generator expires:(Expire_Time)expire completion:(ACNetCacheBatchFetchCompletion)completion;
+
+/**
+ 批量缓存response,每个Key的磁盘写入单独提交,按Key排序依次在后台写入,之后的读取能读到尚未写完的结果
+ 
+ @param responses 缓存Key与response的对应关系
+ @param toMemory 是否缓存到内存
+ @param toDisk 是否缓存到磁盘
+ */
+- (void)storeResponses:(NSDictionary<NSString *, id> *)responses toMemory:(BOOL)toMemory toDisk:(BOOL)toDisk;
+
+#pragma mark - Stream
+
+/**
+ 生成一个用于流式写入的临时文件路径,与磁盘缓存位于同一目录,提交时只需移动文件
+
+ @return 临时文件路径
+ */
+- (NSString *)temporaryFilePathForStreaming;
+
+/**
+ 将流式写入完成的文件提交为url+param对应的磁盘缓存,文件以原始数据缓存,读取时由streamedResponseDecoder解析.
+ 提交成功后文件被移入缓存目录,失败时文件保留在原处,由调用方删除
+
+ @param filePath 文件路径
+ @param response 已解析的结果,非nil时一并更新内存缓存,nil时清除内存缓存
+ @param url url
+ @param param 参数
+ @param generator 缓存key生成器
+ @return 是否提交成功
+ */
+- (BOOL)storeStreamedFileAtPath:(NSString *)filePath response:(nullable id)response forUrl:(NSString *)url param:(nullable NSDictionary *)param keyGenerator:(nullable ACNetCacheKeyGenerator)generator;
+
+/**
+ 将流式写入完成的文件提交为磁盘缓存,generation与当前不同(请求发出后调用过deleteAllResponses)时不提交,返回NO
+
+ @param filePath 文件路径
+ @param response 已解析的结果,非nil时一并更新内存缓存,nil时清除内存缓存
+ @param url url
+ @param param 参数
+ @param generator 缓存key生成器
+ @param generation 发出请求时的generation
+ @return 是否提交成功
+ */
+- (BOOL)storeStreamedFileAtPath:(NSString *)filePath response:(nullable id)response forUrl:(NSString *)url param:(nullable NSDictionary *)param keyGenerator:(nullable ACNetCacheKeyGenerator)generator generation:(NSUInteger)generation;
+
+#pragma mark - Hot Set
+
+/**
+ 保存最常命中的Key清单,下次创建同一命名空间的缓存时会在后台将其预加载到内存.
+ 进入后台、退出时及每分钟会自动保存,一般无需手动调用
+ */
+- (void)persistHotSet;
+
+#pragma mark - Negative
+
+/**
+ 缓存失败结果(仅内存),negativeCacheEnabled为NO时忽略
+ 
+ @param error 请求error
+ @param statusCode HTTP状态码,没有则传0
+ @param url URL
+ @param param 请求参数
+ @param generator 缓存Key生成器
+ */
+- (void)storeFailure:(NSError *)error statusCode:(NSInteger)statusCode forUrl:(NSString *)url param:(nullable NSDictionary *)param keyGenerator:(nullable ACNetCacheKeyGenerator)generator;
+
+/**
+ 缓存请求得到的失败结果,generation与当前不同(请求发出后调用过deleteAllResponses)时丢弃
+ 
+ @param error 请求error
+ @param statusCode HTTP状态码,没有则传0
+ @param url URL
+ @param param 请求参数
+ @param generator 缓存Key生成器
+ @param generation 发出请求时的generation
+ */
+- (void)storeFailure:(NSError *)error statusCode:(NSInteger)statusCode forUrl:(NSString *)url param:(nullable NSDictionary *)param keyGenerator:(nullable ACNetCacheKeyGenerator)generator generation:(NSUInteger)generation;
+
+/**
+ 获取缓存的失败结果
+ 
+ @param url URL
+ @param param 请求参数
+ @param generator 缓存Key生成器
+ @return 失败结果对应的error(domain和code与原error一致),无缓存或已过期返回nil
+ */
+- (nullable NSError *)failureForUrl:(NSString *)url param:(nullable NSDictionary *)param keyGenerator:(nullable ACNetCacheKeyGenerator)generator;
+
 #pragma mark - Delete
 
 /**
@@ -276,6 +600,27 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (void)deleteResponseForUrl:(NSString *)url param:(NSDictionary *)param fromMemory:(BOOL)fromMemory fromDisk:(BOOL)fromDisk;
 
+/**
+ 删除所有带有该标签的缓存(内存及磁盘),按二级索引查找,不扫描磁盘目录
+
+ @param tag 标签
+ */
+- (void)deleteResponsesWithTag:(NSString *)tag;
+
+/**
+ 删除所有URL路径以prefix开头的缓存(内存及磁盘),不区分参数,如@"/users/123/"删除该用户下所有GET结果.按二级索引查找,不扫描磁盘目录
+
+ @param prefix URL路径前缀,传入完整URL时只取其路径;不以/开头时补上,与相对于baseURL存储的结果同样匹配
+ */
+- (void)deleteResponsesWithURLPrefix:(NSString *)prefix;
+
+/**
+ 删除所有缓存(如退出登录、数据结构或语言变化时),耗时与缓存数量无关:
+ generation加1,内存缓存立即替换为空;磁盘目录在此前的磁盘操作完成后整体改名移走,由后台低优先级任务删除.
+ 此前发出、之后才返回的请求以发出时的generation写入,会被丢弃
+ */
+- (void)deleteAllResponses;
+
 @end
 
 NS_ASSUME_NONNULL_END
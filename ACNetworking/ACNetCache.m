@@ -7,24 +7,606 @@
 //
 
 #import "ACNetCache.h"
+#import "ACJSONTape.h"
+#import "ACNetCacheSharedArena.h"
+#import "ACJSONParser.h"
+#import <CommonCrypto/CommonDigest.h>
+#import <objc/runtime.h>
+#include <sys/xattr.h>
+#include <malloc/malloc.h>
+#include <mach/mach_time.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <stdatomic.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#elif defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
+#if TARGET_OS_IOS
+#import <UIKit/UIKit.h>
+#endif
+
+/** 热点Key清单的文件名 */
+static NSString * const ACNetCacheHotSetFileName = @".acnetcache_hotset";
+
+/** 流式写入的临时目录名 */
+static NSString * const ACNetCacheStreamingDirectoryName = @".acnetcache_streaming";
+
+/** 已失效的磁盘目录改名后所在的目录,位于磁盘缓存目录旁,名称为磁盘缓存目录名加此后缀 */
+static NSString * const ACNetCacheTrashDirectorySuffix = @".trash";
+
+/** 跨进程共享内存层的映射文件,位于磁盘缓存目录旁,名称为磁盘缓存目录名加此后缀 */
+static NSString * const ACNetCacheSharedArenaFileSuffix = @".arena";
+
+/** 共享模式下的跨进程状态文件,位于磁盘缓存目录旁,名称为磁盘缓存目录名加此后缀,同时用作文件锁 */
+static NSString * const ACNetCacheSharedStateFileSuffix = @".shared";
+
+static uint32_t const ACNetCacheSharedStateMagic = 0x41435353;
+
+/** 共享模式下,超过此时长未修改的流式写入临时文件视为其他进程遗留,启动时清理 */
+static Expire_Time const ACNetCacheSharedTemporaryFileLifetime = 3600;
+
+/** 标记缓存文件为流式写入的原始数据的扩展属性名 */
+static const char * const ACNetCacheStreamedAttributeName = "com.acnetworking.netcache.streamed";
+
+/** 二级索引(Key对应的URL路径及标签)快照的文件名 */
+static NSString * const ACNetCacheIndexFileName = @".acnetcache_index";
+
+/** 快照之后二级索引变更日志的文件名,启动时在快照上重放 */
+static NSString * const ACNetCacheIndexJournalFileName = @".acnetcache_indexjournal";
+
+/** 变更日志的记录数达到此值且不少于索引的Key数时写入新的快照并清空日志,写快照的开销均摊到每次变更 */
+static NSUInteger const ACNetCacheIndexJournalCompactionInterval = 1024;
+
+/** 二级索引变更日志的记录类型,记录格式为[类型 1字节][内容长度 4字节][内容][CRC32C 4字节],内容为@[Key, 路径, 标签...]或@[Key]的二进制plist */
+static uint8_t const ACNetCacheIndexJournalSet = 1;
+static uint8_t const ACNetCacheIndexJournalRemove = 2;
+
+/** 磁盘Key过滤器检查点的文件名,内容为日志代数及过滤器 */
+static NSString * const ACNetCacheKeyFilterFileName = @".acnetcache_keyfilter";
+
+/** 检查点之后keyFilter变更日志的文件名,代数与检查点一致时才有效 */
+static NSString * const ACNetCacheKeyJournalFileName = @".acnetcache_keyjournal";
+
+/** 变更日志达到此记录数时写入新的检查点,使启动时的恢复时间有上限 */
+static NSUInteger const ACNetCacheKeyJournalCheckpointInterval = 4096;
+
+/** 变更日志的记录类型,记录格式为[类型 1字节][Key长度 2字节][Key][CRC32C 4字节] */
+static uint8_t const ACNetCacheKeyJournalAdd = 1;
+static uint8_t const ACNetCacheKeyJournalRemove = 2;
+/** 覆盖已有的缓存文件,不影响keyFilter,仅在共享模式下记录,使其他进程内存中的结果失效 */
+static uint8_t const ACNetCacheKeyJournalUpdate = 3;
+
+/** 校验信息的扩展属性名,值为ACNetCacheChecksum */
+static const char * const ACNetCacheChecksumAttributeName = "com.acnetworking.netcache.checksum";
+
+/** 校验失败的缓存文件移入的目录名,其中的文件在后台删除 */
+static NSString * const ACNetCacheQuarantineDirectoryName = @".acnetcache_quarantine";
+
+/** 内容寻址存储的目录名 */
+static NSString * const ACNetCacheBlobDirectoryName = @".acnetcache_blobs";
+
+/** 内容引用计数的文件名,位于内容目录下 */
+static NSString * const ACNetCacheBlobRefCountFileName = @".refcounts";
+
+/** 引用计数有未保存变化的标记文件名,位于内容目录下.存在时保存的引用计数可能落后于缓存文件,读取时改为扫描重建 */
+static NSString * const ACNetCacheBlobRefCountDirtyFileName = @".refcounts.dirty";
+
+/** 指向内容的缓存文件前缀,其后为内容的SHA256 */
+static NSString * const ACNetCacheBlobPointerPrefix = @"acblob:";
+
+/**
+ 计算SHA256
+
+ @param data 数据
+ @return 十六进制SHA256
+ */
+static NSString *ACNetCacheSHA256(NSData *data) {
+    unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256(data.bytes, (CC_LONG)data.length, digest);
+    NSMutableString *hash = [NSMutableString stringWithCapacity:CC_SHA256_DIGEST_LENGTH * 2];
+    for (int i = 0; i < CC_SHA256_DIGEST_LENGTH; i++) [hash appendFormat:@"%02x", digest[i]];
+    return hash;
+}
+
+/** 缓存文件的校验信息 */
+typedef struct __attribute__((packed)) {
+    /** 数据长度 */
+    uint64_t length;
+    /** 数据的CRC32C */
+    uint32_t crc;
+} ACNetCacheChecksum;
+
+/**
+ 计算CRC32C,arm64使用CRC指令,x86在支持SSE4.2时使用其指令,其余查表
+
+ @param bytes 数据
+ @param length 长度
+ @return CRC32C
+ */
+static uint32_t ACNetCacheCRC32C(const void *bytes, size_t length) {
+    const uint8_t *p = bytes;
+    uint32_t crc = 0xFFFFFFFFU;
+#if defined(__ARM_FEATURE_CRC32)
+    for (; length >= 8; p += 8, length -= 8) {
+        uint64_t value;
+        memcpy(&value, p, 8);
+        crc = __crc32cd(crc, value);
+    }
+    for (; length; p++, length--) crc = __crc32cb(crc, *p);
+#elif defined(__SSE4_2__)
+    uint64_t crc64 = crc;
+    for (; length >= 8; p += 8, length -= 8) {
+        uint64_t value;
+        memcpy(&value, p, 8);
+        crc64 = _mm_crc32_u64(crc64, value);
+    }
+    crc = (uint32_t)crc64;
+    for (; length; p++, length--) crc = _mm_crc32_u8(crc, *p);
+#else
+    static uint32_t table[256];
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t value = i;
+            for (int j = 0; j < 8; j++) value = (value >> 1) ^ (0x82F63B78U & (0U - (value & 1)));
+            table[i] = value;
+        }
+    });
+    for (; length; p++, length--) crc = table[(crc ^ *p) & 0xFF] ^ (crc >> 8);
+#endif
+    return ~crc;
+}
+
+/**
+ 计算数据的校验信息
+
+ @param data 数据
+ @return 校验信息
+ */
+static ACNetCacheChecksum ACNetCacheChecksumOfData(NSData *data) {
+    ACNetCacheChecksum checksum = {data.length, ACNetCacheCRC32C(data.bytes, data.length)};
+    return checksum;
+}
+
+/**
+ 文件是否为流式写入的原始数据
+
+ @param fd 文件
+ @return 是否为原始数据
+ */
+static BOOL ACNetCacheIsStreamedFile(int fd) {
+    return fgetxattr(fd, ACNetCacheStreamedAttributeName, NULL, 0, 0, 0) >= 0;
+}
+
+/**
+ 读取文件上记录的校验信息
+
+ @param fd 文件
+ @param checksum 校验信息
+ @return 扩展属性的大小,旧版文件没有校验信息,返回-1
+ */
+static ssize_t ACNetCacheReadChecksum(int fd, ACNetCacheChecksum *checksum) {
+    return fgetxattr(fd, ACNetCacheChecksumAttributeName, checksum, sizeof(*checksum), 0, 0);
+}
+
+/**
+ 数据是否与文件上记录的校验信息一致,旧版文件没有校验信息,视为一致.
+ 流式写入的文件在提交时已完整读取校验过一次,之后只比较长度,不再每次读取都计算整个文件
+
+ @param data 数据
+ @param checksum ACNetCacheReadChecksum读取的校验信息
+ @param size ACNetCacheReadChecksum的返回值
+ @param streamed 是否为流式写入的原始数据
+ @return 是否一致
+ */
+static BOOL ACNetCacheDataMatchesChecksum(NSData *data, ACNetCacheChecksum checksum, ssize_t size, BOOL streamed) {
+    if (size < 0) return YES;
+    if (size != sizeof(checksum) || checksum.length != data.length) return NO;
+    return streamed || checksum.crc == ACNetCacheCRC32C(data.bytes, data.length);
+}
+
+/**
+ 映射整个文件为只读NSData,不复制
+
+ @param fd 文件
+ @param length 文件长度
+ @return 数据,失败时返回nil
+ */
+static NSData *ACNetCacheMapFile(int fd, size_t length) {
+    if (length == 0) return [NSData data];
+    void *bytes = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (bytes == MAP_FAILED) return nil;
+    return [[NSData alloc] initWithBytesNoCopy:bytes length:length deallocator:^(void *mapped, NSUInteger mappedLength) {
+        munmap(mapped, mappedLength);
+    }];
+}
+
+/** 以关联对象记录在结果上的缓存数据大小 */
+static const void * const ACNetCacheDataLengthKey = &ACNetCacheDataLengthKey;
+
+/**
+ 记录结果对应的缓存数据大小,之后估算cost时不再序列化.只记录在容器上,字符串、数字可能是tagged pointer
+
+ @param object 结果
+ @param length 缓存数据的大小
+ */
+static void ACNetCacheRecordDataLength(id object, NSUInteger length) {
+    if (length == 0 || !([object isKindOfClass:NSDictionary.class] || [object isKindOfClass:NSArray.class])) return;
+    objc_setAssociatedObject(object, ACNetCacheDataLengthKey, @(length), OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+}
+
+/** 粗略估算cost时,容器中每个元素计入的字节数 */
+static const NSUInteger ACNetCacheEstimatedElementCost = 64;
+
+/**
+ 估算结果常驻内存的大小,用作内存缓存的cost,不遍历也不序列化对象:tape解码的容器取其数据大小;
+ 从缓存数据解析或写入时记录过数据大小的取记录的大小;其余按分配的大小及容器的元素数粗略估算,之后在self.ioQueue中序列化时更新
+
+ @param object 结果
+ @param exact 是否为准确的数据大小(可NULL)
+ @return 字节数
+ */
+static NSUInteger ACNetCacheEstimatedCost(id object, BOOL *exact) {
+    if (exact) *exact = YES;
+    NSUInteger tapeLength = [ACJSONTape dataLengthOfJSONObject:object];
+    if (tapeLength) return tapeLength;
+    NSNumber *length = objc_getAssociatedObject(object, ACNetCacheDataLengthKey);
+    if (length) return length.unsignedIntegerValue;
+    if ([object isKindOfClass:NSData.class]) return 32 + [(NSData *)object length];
+    if (exact) *exact = NO;
+    NSUInteger count = 0;
+    if ([object isKindOfClass:NSDictionary.class]) count = [(NSDictionary *)object count] * 2;
+    if ([object isKindOfClass:NSArray.class]) count = [(NSArray *)object count];
+    if ([object isKindOfClass:NSString.class]) count = [(NSString *)object length] / ACNetCacheEstimatedElementCost;
+    return MAX(malloc_size((__bridge const void *)object), 16) + count * ACNetCacheEstimatedElementCost;
+}
+
+/** 单调时钟的纳秒数,不受系统时间调整影响 */
+typedef int64_t ACNetCacheTicks;
+
+/** 不会到期 */
+static ACNetCacheTicks const ACNetCacheTicksNever = INT64_MAX;
+
+/**
+ 当前的单调时钟.iOS 10起使用包含休眠时间的mach_continuous_time,之前使用mach_absolute_time;timebase只取一次
+
+ @return 纳秒
+ */
+static inline ACNetCacheTicks ACNetCacheNow(void) {
+    static mach_timebase_info_data_t timebase;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        mach_timebase_info(&timebase);
+    });
+    uint64_t ticks;
+    if (@available(iOS 10.0, *)) {
+        ticks = mach_continuous_time();
+    } else {
+        ticks = mach_absolute_time();
+    }
+    return (ACNetCacheTicks)(ticks * timebase.numer / timebase.denom);
+}
+
+/**
+ ticks之后interval秒的时间,溢出时返回ACNetCacheTicksNever
+
+ @param ticks 起始时间
+ @param interval 秒,可为负
+ @return 时间
+ */
+static inline ACNetCacheTicks ACNetCacheTicksAfter(ACNetCacheTicks ticks, NSTimeInterval interval) {
+    double result = (double)ticks + interval * NSEC_PER_SEC;
+    if (result >= (double)ACNetCacheTicksNever) return ACNetCacheTicksNever;
+    if (result <= (double)INT64_MIN) return INT64_MIN;
+    return (ACNetCacheTicks)result;
+}
+
+static inline NSTimeInterval ACNetCacheSecondsFromTicks(ACNetCacheTicks ticks) {
+    return (NSTimeInterval)ticks / NSEC_PER_SEC;
+}
+
+/**
+ 将单调时钟时间换算为NSDate,只在回调需要cacheDate时调用
+
+ @param ticks 时间
+ @return 日期
+ */
+static NSDate *ACNetCacheDateFromTicks(ACNetCacheTicks ticks) {
+    return [NSDate dateWithTimeIntervalSinceNow:ACNetCacheSecondsFromTicks(ticks - ACNetCacheNow())];
+}
+
+/** 时间轮层数 */
+static NSUInteger const ACTimerWheelLevels = 4;
+
+/** 每层槽数的位数,每层64个槽,第n层每个槽跨度为64^n个tick */
+static NSUInteger const ACTimerWheelSlotBits = 6;
+
+static NSUInteger const ACTimerWheelSlotMask = (1 << ACTimerWheelSlotBits) - 1;
+
+/** 内存缓存回收到期对象的间隔(秒),时间轮的tick为1秒 */
+static NSTimeInterval const ACMemoryCacheExpiryInterval = 2;
+
+/**
+ 分层时间轮,按单调时钟的到期时间(秒)索引key.4层各64个槽,tick为1秒,覆盖约194天,更远的到期时间先放在最外层,降级时重新计算.
+ 各层以位图记录有key的槽,推进时直接跳到下一个有key的槽或需要降级的外层槽,中间的空tick不逐个处理;
+ 外层槽在内层转满一圈时降级到内层,每个key最多降级3次.非线程安全
+ */
+@interface ACTimerWheel : NSObject
+
+/** 已索引的key数量 */
+@property (nonatomic, assign, readonly) NSUInteger count;
+
+/**
+ 实例化
+
+ @param startTime 起始时间,tick从此开始计算
+ @return 时间轮
+ */
+- (instancetype)initWithStartTime:(NSTimeInterval)startTime;
+
+/**
+ 按到期时间索引key,已索引的key会先移除
+
+ @param key key
+ @param deadline 到期时间
+ */
+- (void)scheduleKey:(id)key deadline:(NSTimeInterval)deadline;
+
+/**
+ 移除key
+
+ @param key key
+ */
+- (void)unscheduleKey:(id)key;
+
+/**
+ 推进到time,返回期间到期的key
+
+ @param time 当前时间
+ @return 到期的key
+ */
+- (NSArray *)advanceToTime:(NSTimeInterval)time;
+
+@end
+
+@implementation ACTimerWheel {
+    NSTimeInterval _startTime;
+    uint64_t _currentTick;
+    /** ACTimerWheelLevels * 64个槽 */
+    NSMutableArray<NSMutableSet *> *_slots;
+    /** key:到期tick */
+    NSMutableDictionary<id, NSNumber *> *_deadlines;
+    /** key:所在槽 */
+    NSMutableDictionary<id, NSNumber *> *_locations;
+    /** 各层有key的槽的位图 */
+    uint64_t _occupied[ACTimerWheelLevels];
+}
+
+- (instancetype)initWithStartTime:(NSTimeInterval)startTime {
+    if (self = [super init]) {
+        _startTime = startTime;
+        _slots = [NSMutableArray arrayWithCapacity:ACTimerWheelLevels << ACTimerWheelSlotBits];
+        for (NSUInteger i = 0; i < ACTimerWheelLevels << ACTimerWheelSlotBits; i++) [_slots addObject:[NSMutableSet set]];
+        _deadlines = [NSMutableDictionary dictionary];
+        _locations = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+- (NSUInteger)count {
+    return _deadlines.count;
+}
+
+- (void)scheduleKey:(id)key deadline:(NSTimeInterval)deadline {
+    [self unscheduleKey:key];
+    /** 向上取整,保证不会提前到期 */
+    uint64_t tick = (uint64_t)ceil(MAX(deadline - _startTime, 0));
+    tick = MAX(tick, _currentTick + 1);
+    _deadlines[key] = @(tick);
+    [self insertKey:key tick:tick];
+}
+
+- (void)unscheduleKey:(id)key {
+    NSNumber *location = _locations[key];
+    if (!location) return;
+    NSMutableSet *slot = _slots[location.unsignedIntegerValue];
+    [slot removeObject:key];
+    if (slot.count == 0) [self markSlotAtLocation:location.unsignedIntegerValue occupied:NO];
+    [_locations removeObjectForKey:key];
+    [_deadlines removeObjectForKey:key];
+}
+
+- (NSArray *)advanceToTime:(NSTimeInterval)time {
+    uint64_t target = (uint64_t)floor(MAX(time - _startTime, 0));
+    NSMutableArray *expired = [NSMutableArray array];
+    while (_currentTick < target) {
+        /** 其间的tick没有要到期或降级的槽,直接跳过 */
+        uint64_t next = [self nextEventTick];
+        if (next > target) {
+            _currentTick = target;
+            break;
+        }
+        _currentTick = next;
+        /** 内层转满一圈时,将外层对应槽降级 */
+        for (NSUInteger level = 1; level < ACTimerWheelLevels; level++) {
+            if (_currentTick & ((1ULL << (ACTimerWheelSlotBits * level)) - 1)) break;
+            NSUInteger location = (level << ACTimerWheelSlotBits) | ((_currentTick >> (ACTimerWheelSlotBits * level)) & ACTimerWheelSlotMask);
+            NSMutableSet *slot = _slots[location];
+            NSArray *keys = slot.allObjects;
+            [slot removeAllObjects];
+            [self markSlotAtLocation:location occupied:NO];
+            for (id key in keys) [self insertKey:key tick:_deadlines[key].unsignedLongLongValue];
+        }
+        NSUInteger location = _currentTick & ACTimerWheelSlotMask;
+        NSMutableSet *slot = _slots[location];
+        NSArray *keys = slot.allObjects;
+        [slot removeAllObjects];
+        [self markSlotAtLocation:location occupied:NO];
+        for (id key in keys) {
+            uint64_t tick = _deadlines[key].unsignedLongLongValue;
+            if (tick > _currentTick) {
+                [self insertKey:key tick:tick];
+                continue;
+            }
+            [_deadlines removeObjectForKey:key];
+            [_locations removeObjectForKey:key];
+            [expired addObject:key];
+        }
+    }
+    return expired;
+}
+
+/**
+ 按到期tick与当前tick的距离选择层,放入对应槽
+
+ @param key key
+ @param tick 到期tick
+ */
+- (void)insertKey:(id)key tick:(uint64_t)tick {
+    uint64_t delta = tick > _currentTick ? tick - _currentTick : 0;
+    NSUInteger level = 0;
+    while (level < ACTimerWheelLevels - 1 && delta >> (ACTimerWheelSlotBits * (level + 1))) level++;
+    /** 超出时间轮范围时先放在最外层最远的槽,降级时按真实到期时间重新放置 */
+    uint64_t span = 1ULL << (ACTimerWheelSlotBits * ACTimerWheelLevels);
+    if (delta >= span) tick = _currentTick + span - 1;
+    NSUInteger location = (level << ACTimerWheelSlotBits) | ((tick >> (ACTimerWheelSlotBits * level)) & ACTimerWheelSlotMask);
+    [_slots[location] addObject:key];
+    [self markSlotAtLocation:location occupied:YES];
+    _locations[key] = @(location);
+}
+
+/**
+ 更新槽在位图中的状态
+
+ @param location 槽
+ @param occupied 是否有key
+ */
+- (void)markSlotAtLocation:(NSUInteger)location occupied:(BOOL)occupied {
+    uint64_t bit = 1ULL << (location & ACTimerWheelSlotMask);
+    if (occupied) {
+        _occupied[location >> ACTimerWheelSlotBits] |= bit;
+    } else {
+        _occupied[location >> ACTimerWheelSlotBits] &= ~bit;
+    }
+}
+
+/**
+ 当前tick之后第一个需要处理的tick:各层从当前位置的下一个槽起找第一个有key的槽,
+ 内层为该槽到期的tick,外层为该槽降级的tick,取最早的一个
+
+ @return tick,时间轮为空时返回UINT64_MAX
+ */
+- (uint64_t)nextEventTick {
+    uint64_t next = UINT64_MAX;
+    for (NSUInteger level = 0; level < ACTimerWheelLevels; level++) {
+        uint64_t occupied = _occupied[level];
+        if (!occupied) continue;
+        NSUInteger shift = ACTimerWheelSlotBits * level;
+        uint64_t index = _currentTick >> shift;
+        /** 循环右移,使第0位对应下一个槽 */
+        unsigned rotation = (unsigned)((index + 1) & ACTimerWheelSlotMask);
+        uint64_t rotated = rotation ? (occupied >> rotation) | (occupied << (64 - rotation)) : occupied;
+        next = MIN(next, (index + 1 + (uint64_t)__builtin_ctzll(rotated)) << shift);
+    }
+    return next;
+}
+
+@end
+
+/** ACMemoryCache中有cost的key在访问顺序链表中的节点,由costNodeDict持有 */
+@interface ACMemoryCacheNode : NSObject
+
+@property (nonatomic, strong) id key;
+
+@property (nonatomic, assign) NSUInteger cost;
+
+@property (nonatomic, unsafe_unretained) ACMemoryCacheNode *prev;
+
+@property (nonatomic, unsafe_unretained) ACMemoryCacheNode *next;
+
+@end
+
+@implementation ACMemoryCacheNode
+
+@end
 
 @interface ACMemoryCache <KeyType, ObjectType> : NSCache <KeyType, ObjectType>
 
-@property (nonatomic, strong) NSMutableDictionary<KeyType, NSDate *> *expireDateDict;
+/** 各key的过期时间(ACNetCacheTicks) */
+@property (nonatomic, strong) NSMutableDictionary<KeyType, NSNumber *> *expireTickDict;
+
+/** 各key的添加时间(ACNetCacheTicks) */
+@property (nonatomic, strong) NSMutableDictionary<KeyType, NSNumber *> *updateTickDict;
+
+/** 各key的cost */
+@property (nonatomic, strong) NSMutableDictionary<KeyType, ACMemoryCacheNode *> *costNodeDict;
+
+/** 最近访问的节点,节点按访问时间由近及远链接 */
+@property (nonatomic, unsafe_unretained) ACMemoryCacheNode *headNode;
+
+/** 最久未访问的节点 */
+@property (nonatomic, unsafe_unretained) ACMemoryCacheNode *tailNode;
+
+/** 已缓存对象的cost之和 */
+@property (nonatomic, assign) NSUInteger totalCost;
 
-@property (nonatomic, strong) NSMutableDictionary<KeyType, NSDate *> *updateDateDict;
+/** cost之和的上限,为0时不限制.超出时从最久未访问的开始淘汰,直到降至上限的90% */
+@property (nonatomic, assign) NSUInteger byteLimit;
+
+/** 对象自添加起的最长保留时间,到期后由时间轮回收,为0时不限制 */
+@property (nonatomic, assign) NSTimeInterval maximumAge;
+
+/** 按到期时间索引有过期时间或maximumAge的key */
+@property (nonatomic, strong) ACTimerWheel *expiryWheel;
+
+/** 定期推进expiryWheel并回收到期对象,时间轮为空时停止 */
+@property (nonatomic, strong) dispatch_source_t expiryTimer;
+
+/** 保护各时间及cost记录和expiryWheel,NSCache本身是线程安全的 */
+@property (nonatomic, strong) dispatch_semaphore_t lock;
 
 @end
 
 @implementation ACMemoryCache
 
+- (instancetype)init {
+    if (self = [super init]) {
+        _expireTickDict = [NSMutableDictionary dictionary];
+        _updateTickDict = [NSMutableDictionary dictionary];
+        _costNodeDict = [NSMutableDictionary dictionary];
+        _expiryWheel = [[ACTimerWheel alloc] initWithStartTime:ACNetCacheSecondsFromTicks(ACNetCacheNow())];
+        _lock = dispatch_semaphore_create(1);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    if (_expiryTimer) dispatch_source_cancel(_expiryTimer);
+}
+
 #pragma mark - Override
 
 - (id)objectForKey:(id)key {
     /** 首先检查该key所缓存的对象是否有过期时间,如果有且已过期,则返回nil */
-    NSDate *expireDate = [self.expireDateDict objectForKey:key];
-    if (expireDate && [expireDate timeIntervalSinceNow] <= 0) return nil;
-    return [super objectForKey:key];
+    ACNetCacheTicks now = ACNetCacheNow();
+    dispatch_semaphore_wait(self.lock, DISPATCH_TIME_FOREVER);
+    ACNetCacheTicks deadline = [self _deadlineForKey:key];
+    dispatch_semaphore_signal(self.lock);
+    if (deadline <= now) return nil;
+    id object = [super objectForKey:key];
+    if (object && self.byteLimit) {
+        dispatch_semaphore_wait(self.lock, DISPATCH_TIME_FOREVER);
+        ACMemoryCacheNode *node = self.costNodeDict[key];
+        if (node) [self _moveNodeToHead:node];
+        dispatch_semaphore_signal(self.lock);
+    }
+    return object;
 }
 
 /**
@@ -48,6 +630,18 @@
     [self setObject:obj forKey:key cost:g refreshExpireDate:YES];
 }
 
+/**
+ 移除对象及其过期时间、添加时间
+
+ @param key key
+ */
+- (void)removeObjectForKey:(id)key {
+    [super removeObjectForKey:key];
+    dispatch_semaphore_wait(self.lock, DISPATCH_TIME_FOREVER);
+    [self _forgetKey:key];
+    dispatch_semaphore_signal(self.lock);
+}
+
 #pragma mark - Expanded Method
 /**
  缓存对象
@@ -57,10 +651,7 @@
  @param refresh 是否移除key对应的过期时间
  */
 - (void)setObject:(id)obj forKey:(id)key refreshExpireDate:(BOOL)refresh {
-    [super setObject:obj forKey:key];
-    /** 添加缓存的同时缓存该obj的添加时间 */
-    [self.updateDateDict setObject:[NSDate date] forKey:key];
-    if (refresh && [self.expireDateDict.allKeys containsObject:key]) [self.expireDateDict removeObjectForKey:key];
+    [self setObject:obj forKey:key cost:0 refreshExpireDate:refresh];
 }
 
 
@@ -73,10 +664,7 @@
  @param refresh 是否移除key对应的过期时间
  */
 - (void)setObject:(id)obj forKey:(id)key cost:(NSUInteger)g refreshExpireDate:(BOOL)refresh {
-    [super setObject:obj forKey:key cost:g];
-    /** 添加缓存的同时缓存该obj的添加时间 */
-    [self.updateDateDict setObject:[NSDate date] forKey:key];
-    if (refresh && [self.expireDateDict.allKeys containsObject:key]) [self.expireDateDict removeObjectForKey:key];
+    [self setObject:obj forKey:key cost:g expireTick:ACNetCacheTicksNever refreshExpireDate:refresh];
 }
 
 /**
@@ -87,7 +675,7 @@
  @param expire 过期时间
  */
 - (void)setObject:(id)obj forKey:(id)key expires:(Expire_Time)expire {
-    [self setObject:obj forKey:key expireDate:[NSDate dateWithTimeIntervalSinceNow:expire]];
+    [self setObject:obj forKey:key cost:0 expires:expire];
 }
 
 /**
@@ -99,7 +687,7 @@
  @param expire 过期时间
  */
 - (void)setObject:(id)obj forKey:(id)key cost:(NSUInteger)g expires:(Expire_Time)expire {
-    [self setObject:obj forKey:key cost:g expireDate:[NSDate dateWithTimeIntervalSinceNow:expire]];
+    [self setObject:obj forKey:key cost:g expireTick:ACNetCacheTicksAfter(ACNetCacheNow(), expire) refreshExpireDate:NO];
 }
 
 /**
@@ -110,12 +698,7 @@
  @param expireDate 过期日期
  */
 - (void)setObject:(id)obj forKey:(id)key expireDate:(NSDate *)expireDate {
-    if (expireDate) {
-        [self.expireDateDict setObject:expireDate forKey:key];
-    } else if ([self.expireDateDict objectForKey:key]) {
-        [self.expireDateDict removeObjectForKey:key];
-    }
-    [self setObject:obj forKey:key refreshExpireDate:NO];
+    [self setObject:obj forKey:key cost:0 expireDate:expireDate];
 }
 
 /**
@@ -124,15 +707,35 @@
  @param obj 对象
  @param key key
  @param g 消耗
- @param expireDate 过期日期
+ @param expireDate 过期日期,nil为不过期
  */
 - (void)setObject:(id)obj forKey:(id)key cost:(NSUInteger)g expireDate:(NSDate *)expireDate {
-    if (expireDate) {
-        [self.expireDateDict setObject:expireDate forKey:key];
-    } else if ([self.expireDateDict objectForKey:key]) {
-        [self.expireDateDict removeObjectForKey:key];
+    ACNetCacheTicks expireTick = expireDate ? ACNetCacheTicksAfter(ACNetCacheNow(), expireDate.timeIntervalSinceNow) : ACNetCacheTicksNever;
+    [self setObject:obj forKey:key cost:g expireTick:expireTick refreshExpireDate:YES];
+}
+
+/**
+ 缓存对象,同时记录添加时间
+
+ @param obj 对象
+ @param key key
+ @param g 消耗
+ @param expireTick 过期时间,ACNetCacheTicksNever时按refresh处理原有的过期时间
+ @param refresh expireTick为ACNetCacheTicksNever时,是否移除key原有的过期时间
+ */
+- (void)setObject:(id)obj forKey:(id)key cost:(NSUInteger)g expireTick:(ACNetCacheTicks)expireTick refreshExpireDate:(BOOL)refresh {
+    ACNetCacheTicks now = ACNetCacheNow();
+    dispatch_semaphore_wait(self.lock, DISPATCH_TIME_FOREVER);
+    [super setObject:obj forKey:key cost:g];
+    self.updateTickDict[key] = @(now);
+    if (expireTick != ACNetCacheTicksNever) {
+        self.expireTickDict[key] = @(expireTick);
+    } else if (refresh) {
+        [self.expireTickDict removeObjectForKey:key];
     }
-    [self setObject:obj forKey:key cost:g refreshExpireDate:NO];
+    [self _recordCost:g forKey:key];
+    [self _scheduleExpiryForKey:key];
+    dispatch_semaphore_signal(self.lock);
 }
 
 /**
@@ -143,518 +746,3762 @@
  @return 缓存的对象
  */
 - (id)objectForKey:(id)key expires:(Expire_Time)expire {
-    NSDate *addedDate = [self.updateDateDict objectForKey:key];
-    if (addedDate && [[addedDate dateByAddingTimeInterval:expire] timeIntervalSinceNow] <= 0) return nil;
+    ACNetCacheTicks now = ACNetCacheNow();
+    dispatch_semaphore_wait(self.lock, DISPATCH_TIME_FOREVER);
+    NSNumber *updateTick = self.updateTickDict[key];
+    dispatch_semaphore_signal(self.lock);
+    if (updateTick && ACNetCacheTicksAfter(updateTick.longLongValue, expire) <= now) return nil;
     return [self objectForKey:key];
 }
 
-- (NSDate *)updateDateForKey:(NSString *)key {
-    return self.updateDateDict[key];
+/**
+ 仅在key未缓存时缓存对象,并指定添加时间,用于从磁盘预加载,不会覆盖预加载期间写入的新结果
+
+ @param obj 对象
+ @param key key
+ @param g 消耗
+ @param updateDate 添加时间
+ @return 是否缓存
+ */
+- (BOOL)addObject:(id)obj forKey:(id)key cost:(NSUInteger)g updateDate:(NSDate *)updateDate {
+    ACNetCacheTicks now = ACNetCacheNow();
+    /** 墙上时间只在这里换算一次,之后按单调时钟计算 */
+    ACNetCacheTicks updateTick = updateDate ? ACNetCacheTicksAfter(now, MIN(updateDate.timeIntervalSinceNow, 0)) : now;
+    dispatch_semaphore_wait(self.lock, DISPATCH_TIME_FOREVER);
+    BOOL absent = !self.updateTickDict[key] || ![super objectForKey:key];
+    if (absent) {
+        [super setObject:obj forKey:key cost:g];
+        self.updateTickDict[key] = @(updateTick);
+        [self.expireTickDict removeObjectForKey:key];
+        [self _recordCost:g forKey:key];
+        [self _scheduleExpiryForKey:key];
+    }
+    dispatch_semaphore_signal(self.lock);
+    return absent;
 }
 
-#pragma mark - Lazy
+/**
+ key的添加时间,仅在回调需要时转换为NSDate
 
-/** 用于保存对象的过期日期 */
-- (NSMutableDictionary *)expireDateDict {
-    if (!_expireDateDict) {
-        _expireDateDict = [NSMutableDictionary dictionary];
-    }
-    return _expireDateDict;
+ @param key key
+ @return 添加时间
+ */
+- (NSDate *)updateDateForKey:(NSString *)key {
+    dispatch_semaphore_wait(self.lock, DISPATCH_TIME_FOREVER);
+    NSNumber *updateTick = self.updateTickDict[key];
+    dispatch_semaphore_signal(self.lock);
+    return updateTick ? ACNetCacheDateFromTicks(updateTick.longLongValue) : nil;
 }
 
-/** 用于保存对象的添加日期 */
-- (NSMutableDictionary *)updateDateDict {
-    if (!_updateDateDict) {
-        _updateDateDict = [NSMutableDictionary dictionary];
+/**
+ key对应的仍是obj时更新其cost,不改变其访问顺序;已被替换或移除时不做处理
+
+ @param g 消耗
+ @param obj 对象
+ @param key key
+ */
+- (void)setCost:(NSUInteger)g forObject:(id)obj key:(id)key {
+    dispatch_semaphore_wait(self.lock, DISPATCH_TIME_FOREVER);
+    if ([super objectForKey:key] == obj) {
+        [super setObject:obj forKey:key cost:g];
+        ACMemoryCacheNode *node = self.costNodeDict[key];
+        if (node && g) {
+            self.totalCost = self.totalCost - MIN(node.cost, self.totalCost) + g;
+            node.cost = g;
+            [self _trimToByteLimit];
+        } else {
+            [self _recordCost:g forKey:key];
+        }
     }
-    return _updateDateDict;
+    dispatch_semaphore_signal(self.lock);
 }
 
-@end
-
-@interface ACNetCache()
+/**
+ key对应的是否仍是obj,不改变其访问顺序
 
-@property (nonatomic, copy) NSString *diskDirectory;
+ @param obj 对象
+ @param key key
+ @return 是否仍是obj
+ */
+- (BOOL)containsObject:(id)obj forKey:(id)key {
+    dispatch_semaphore_wait(self.lock, DISPATCH_TIME_FOREVER);
+    BOOL contains = [super objectForKey:key] == obj;
+    dispatch_semaphore_signal(self.lock);
+    return contains;
+}
 
-@property (strong, nonatomic, nonnull) dispatch_queue_t ioQueue;
+/**
+ key对应的仍是obj时移除
 
-@property (strong, nonatomic, nonnull) NSFileManager *fileManager;
+ @param obj 对象
+ @param key key
+ @return 是否移除,key对应的对象已被替换或移除时返回NO
+ */
+- (BOOL)removeObject:(id)obj forKey:(id)key {
+    dispatch_semaphore_wait(self.lock, DISPATCH_TIME_FOREVER);
+    BOOL contains = [super objectForKey:key] == obj;
+    if (contains) {
+        [super removeObjectForKey:key];
+        [self _forgetKey:key];
+    }
+    dispatch_semaphore_signal(self.lock);
+    return contains;
+}
 
-@property (nonatomic, strong) ACMemoryCache *memoryCache;
+- (void)setMaximumAge:(NSTimeInterval)maximumAge {
+    dispatch_semaphore_wait(self.lock, DISPATCH_TIME_FOREVER);
+    _maximumAge = maximumAge;
+    for (id key in self.updateTickDict.allKeys) [self _scheduleExpiryForKey:key];
+    dispatch_semaphore_signal(self.lock);
+}
 
-@end
+- (void)setByteLimit:(NSUInteger)byteLimit {
+    dispatch_semaphore_wait(self.lock, DISPATCH_TIME_FOREVER);
+    _byteLimit = byteLimit;
+    [self _trimToByteLimit];
+    dispatch_semaphore_signal(self.lock);
+}
+
+/**
+ 内部方法,移除key的所有记录(不含NSCache中的对象),需确保此方法在self.lock内调用
+
+ @param key key
+ */
+- (void)_forgetKey:(id)key {
+    [self.expireTickDict removeObjectForKey:key];
+    [self.updateTickDict removeObjectForKey:key];
+    [self _forgetCostForKey:key];
+    [self.expiryWheel unscheduleKey:key];
+}
+
+#pragma mark - Cost
+
+/**
+ 内部方法,记录key的cost并在超出byteLimit时淘汰,需确保此方法在self.lock内调用
+
+ @param cost cost
+ @param key key
+ */
+- (void)_recordCost:(NSUInteger)cost forKey:(id)key {
+    [self _forgetCostForKey:key];
+    if (cost == 0) return;
+    ACMemoryCacheNode *node = [ACMemoryCacheNode new];
+    node.key = key;
+    node.cost = cost;
+    self.costNodeDict[key] = node;
+    [self _moveNodeToHead:node];
+    self.totalCost += cost;
+    [self _trimToByteLimit];
+}
+
+/**
+ 内部方法,移除key的cost记录,需确保此方法在self.lock内调用
+
+ @param key key
+ */
+- (void)_forgetCostForKey:(id)key {
+    ACMemoryCacheNode *node = self.costNodeDict[key];
+    if (!node) return;
+    self.totalCost -= MIN(node.cost, self.totalCost);
+    [self _unlinkNode:node];
+    [self.costNodeDict removeObjectForKey:key];
+}
+
+/**
+ 内部方法,将节点移到链表头部,节点可以不在链表中.需确保此方法在self.lock内调用
+
+ @param node 节点
+ */
+- (void)_moveNodeToHead:(ACMemoryCacheNode *)node {
+    if (self.headNode == node) return;
+    [self _unlinkNode:node];
+    node.next = self.headNode;
+    self.headNode.prev = node;
+    self.headNode = node;
+    if (!self.tailNode) self.tailNode = node;
+}
+
+/**
+ 内部方法,将节点移出链表.需确保此方法在self.lock内调用
+
+ @param node 节点
+ */
+- (void)_unlinkNode:(ACMemoryCacheNode *)node {
+    if (node.prev) node.prev.next = node.next;
+    if (node.next) node.next.prev = node.prev;
+    if (self.headNode == node) self.headNode = node.next;
+    if (self.tailNode == node) self.tailNode = node.prev;
+    node.prev = nil;
+    node.next = nil;
+}
+
+/**
+ 内部方法,cost之和超出byteLimit时,从最久未访问的开始淘汰,直到降至上限的90%.
+ 已被系统回收的对象同样在链表中,淘汰时一并清理.需确保此方法在self.lock内调用
+ */
+- (void)_trimToByteLimit {
+    if (self.byteLimit == 0 || self.totalCost <= self.byteLimit) return;
+    NSUInteger target = self.byteLimit / 10 * 9;
+    while (self.totalCost > target && self.tailNode) {
+        id key = self.tailNode.key;
+        [super removeObjectForKey:key];
+        [self _forgetKey:key];
+    }
+}
+
+/**
+ 写入cost大小的对象后若超出byteLimit,返回最先被淘汰的key,即最久未访问的key
+
+ @param cost 将写入对象的cost
+ @return 最先被淘汰的key,未超出时返回nil
+ */
+- (id)evictionCandidateForCost:(NSUInteger)cost {
+    dispatch_semaphore_wait(self.lock, DISPATCH_TIME_FOREVER);
+    id candidate = self.byteLimit && self.totalCost + cost > self.byteLimit ? self.tailNode.key : nil;
+    dispatch_semaphore_signal(self.lock);
+    return candidate;
+}
+
+#pragma mark - Expiry
+
+/**
+ 内部方法,key的到期时间:过期时间与添加时间+maximumAge中较早的一个.需确保此方法在self.lock内调用
+
+ @param key key
+ @return 到期时间,不会到期时返回ACNetCacheTicksNever
+ */
+- (ACNetCacheTicks)_deadlineForKey:(id)key {
+    NSNumber *expireTick = self.expireTickDict[key];
+    ACNetCacheTicks deadline = expireTick ? expireTick.longLongValue : ACNetCacheTicksNever;
+    NSNumber *updateTick = self.maximumAge > 0 ? self.updateTickDict[key] : nil;
+    if (updateTick) deadline = MIN(deadline, ACNetCacheTicksAfter(updateTick.longLongValue, self.maximumAge));
+    return deadline;
+}
+
+/**
+ 内部方法,按到期时间将key放入时间轮,需要时启动回收定时器.需确保此方法在self.lock内调用
+
+ @param key key
+ */
+- (void)_scheduleExpiryForKey:(id)key {
+    ACNetCacheTicks deadline = [self _deadlineForKey:key];
+    if (deadline == ACNetCacheTicksNever) {
+        [self.expiryWheel unscheduleKey:key];
+        return;
+    }
+    [self.expiryWheel scheduleKey:key deadline:ACNetCacheSecondsFromTicks(deadline)];
+    if (self.expiryTimer) return;
+    self.expiryTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_global_queue(QOS_CLASS_UTILITY, 0));
+    dispatch_source_set_timer(self.expiryTimer, dispatch_time(DISPATCH_TIME_NOW, ACMemoryCacheExpiryInterval * NSEC_PER_SEC), ACMemoryCacheExpiryInterval * NSEC_PER_SEC, NSEC_PER_SEC);
+    __weak typeof(self) weakSelf = self;
+    dispatch_source_set_event_handler(self.expiryTimer, ^{
+        [weakSelf reclaimExpiredObjects];
+    });
+    dispatch_resume(self.expiryTimer);
+}
+
+/**
+ 推进时间轮,移除到期的对象及其记录,时间轮为空时停止定时器
+ */
+- (void)reclaimExpiredObjects {
+    dispatch_semaphore_wait(self.lock, DISPATCH_TIME_FOREVER);
+    for (id key in [self.expiryWheel advanceToTime:ACNetCacheSecondsFromTicks(ACNetCacheNow())]) {
+        [super removeObjectForKey:key];
+        [self _forgetKey:key];
+    }
+    if (self.expiryWheel.count == 0 && self.expiryTimer) {
+        dispatch_source_cancel(self.expiryTimer);
+        self.expiryTimer = nil;
+    }
+    dispatch_semaphore_signal(self.lock);
+}
+
+@end
+
+@interface ACNetCacheResult ()
+
+@property (nonatomic, copy, readwrite) NSString *key;
+
+@property (nonatomic, assign, readwrite) ACNetCacheType type;
+
+@property (nonatomic, strong, readwrite) id response;
+
+@property (nonatomic, strong, readwrite) NSDate *cacheDate;
+
+@end
+
+@implementation ACNetCacheResult
+
+@end
+
+/** 内存中由缓存结果解析出的模型 */
+@interface ACNetCacheModelEntry : NSObject
+
+/** 解析模型所用的结果,与内存中的缓存结果不一致时模型失效 */
+@property (nonatomic, weak) id source;
+
+/** 启用共享内存层时,解析模型所用的结果在共享区域中的写入时间,与共享区域中的记录不一致时模型失效;0表示结果在本进程的内存缓存中 */
+@property (nonatomic, assign) NSTimeInterval timestamp;
+
+/** 解析器名称:模型 */
+@property (nonatomic, copy) NSDictionary<NSString *, id> *models;
+
+@end
+
+@implementation ACNetCacheModelEntry
+
+@end
+
+/** 尚未改名生效的dispatch_io写入,改名前该路径的读取以其数据为准 */
+@interface ACNetCachePendingWrite : NSObject
+
+/** 写入的数据 */
+@property (nonatomic, strong) NSData *data;
+
+/** 提交写入的时间,即读取时的缓存时间 */
+@property (nonatomic, strong) NSDate *date;
+
+/**
+ 写入的数据是否已过期
+
+ @param expire 过期时间
+ @return 是否过期
+ */
+- (BOOL)isExpiredForExpires:(Expire_Time)expire;
+
+@end
+
+@implementation ACNetCachePendingWrite
+
+- (BOOL)isExpiredForExpires:(Expire_Time)expire {
+    return expire <= 0 || self.date.timeIntervalSinceNow + expire <= 0;
+}
+
+@end
+
+/** 缓存的失败结果 */
+@interface ACNetCacheFailure : NSObject
+
+@property (nonatomic, copy) NSString *domain;
+
+@property (nonatomic, assign) NSInteger code;
+
+@property (nonatomic, assign) NSInteger statusCode;
+
+@property (nonatomic, copy) NSString *localizedDescription;
+
+@end
+
+@implementation ACNetCacheFailure
+
+@end
+
+/**
+ 以/开头的路径,相对于baseURL的路径(如@"users/123/profile")与完整URL的路径一致
+
+ @param path 路径
+ @return 路径
+ */
+static NSString *ACNetCacheRootedPath(NSString *path) {
+    if (path.length == 0) return @"/";
+    return [path hasPrefix:@"/"] ? path : [@"/" stringByAppendingString:path];
+}
+
+/**
+ URL的路径部分,不含scheme、host及参数,总以/开头,用于二级索引
+
+ @param url URL、路径或相对于baseURL的路径
+ @return 路径
+ */
+static NSString *ACNetCacheURLPath(NSString *url) {
+    NSURLComponents *components = [NSURLComponents componentsWithString:url];
+    return ACNetCacheRootedPath(components ? components.percentEncodedPath : [url componentsSeparatedByString:@"?"].firstObject);
+}
+
+/**
+ 缓存Key的二级索引,记录每个Key的URL路径及标签,可按标签或路径前缀找出Key.
+ 路径按字典序排列,前缀查找为二分定位后顺序读取,与索引大小无关.线程安全
+ */
+@interface ACNetCacheIndex : NSObject
+
+/**
+ 从文件读取索引,文件不存在或无法解析时为空索引
+
+ @param path 文件路径
+ @return 索引
+ */
+- (instancetype)initWithContentsOfFile:(NSString *)path;
+
+/**
+ 记录Key的路径及标签,替换原有记录.路径不以/开头时补上
+
+ @param path URL路径
+ @param tags 标签
+ @param key 缓存Key
+ */
+- (BOOL)setPath:(NSString *)path tags:(NSArray<NSString *> *)tags forKey:(NSString *)key;
+
+/**
+ 移除Key的记录
+
+ @param key 缓存Key
+ @return 是否有该Key的记录
+ */
+- (BOOL)removeKey:(NSString *)key;
+
+/**
+ 移除并返回带有标签的Key
+
+ @param tag 标签
+ @return 缓存Key
+ */
+- (NSSet<NSString *> *)removeKeysWithTag:(NSString *)tag;
+
+/**
+ 移除并返回路径以prefix开头的Key
+
+ @param prefix 路径前缀
+ @return 缓存Key
+ */
+- (NSSet<NSString *> *)removeKeysWithPathPrefix:(NSString *)prefix;
+
+/**
+ 加入index中有而本索引中没有的Key的记录
+
+ @param index 索引
+ */
+- (void)mergeEntriesFromIndex:(ACNetCacheIndex *)index;
+
+/**
+ 原子写入文件
+
+ @param path 文件路径
+ @return 是否写入
+ */
+- (BOOL)writeToFile:(NSString *)path;
+
+/** 记录的Key数 */
+@property (nonatomic, assign, readonly) NSUInteger count;
+
+@end
+
+@implementation ACNetCacheIndex {
+    /** Key:@[路径, 标签...] */
+    NSMutableDictionary<NSString *, NSArray<NSString *> *> *_entries;
+    NSMutableDictionary<NSString *, NSMutableSet<NSString *> *> *_tagKeys;
+    NSMutableDictionary<NSString *, NSMutableSet<NSString *> *> *_pathKeys;
+    /** _pathKeys的所有路径,按字面字典序排列 */
+    NSMutableArray<NSString *> *_sortedPaths;
+    dispatch_semaphore_t _lock;
+}
+
+- (instancetype)init {
+    return [self initWithContentsOfFile:@""];
+}
+
+- (instancetype)initWithContentsOfFile:(NSString *)path {
+    if (self = [super init]) {
+        _entries = [NSMutableDictionary dictionary];
+        _tagKeys = [NSMutableDictionary dictionary];
+        _pathKeys = [NSMutableDictionary dictionary];
+        _sortedPaths = [NSMutableArray array];
+        _lock = dispatch_semaphore_create(1);
+        NSDictionary *saved = path.length ? [NSDictionary dictionaryWithContentsOfFile:path] : nil;
+        [saved enumerateKeysAndObjectsUsingBlock:^(NSString *key, NSArray<NSString *> *entry, BOOL *stop) {
+            if (![key isKindOfClass:NSString.class] || ![entry isKindOfClass:NSArray.class] || entry.count == 0) return;
+            [self _setPath:entry.firstObject tags:[entry subarrayWithRange:NSMakeRange(1, entry.count - 1)] forKey:key];
+        }];
+    }
+    return self;
+}
+
+- (BOOL)setPath:(NSString *)path tags:(NSArray<NSString *> *)tags forKey:(NSString *)key {
+    if (!path || !key) return NO;
+    dispatch_semaphore_wait(_lock, DISPATCH_TIME_FOREVER);
+    BOOL changed = [self _setPath:path tags:tags forKey:key];
+    dispatch_semaphore_signal(_lock);
+    return changed;
+}
+
+- (BOOL)removeKey:(NSString *)key {
+    if (!key) return NO;
+    dispatch_semaphore_wait(_lock, DISPATCH_TIME_FOREVER);
+    BOOL exists = _entries[key] != nil;
+    [self _removeKey:key];
+    dispatch_semaphore_signal(_lock);
+    return exists;
+}
+
+- (NSSet<NSString *> *)removeKeysWithTag:(NSString *)tag {
+    if (!tag) return [NSSet set];
+    dispatch_semaphore_wait(_lock, DISPATCH_TIME_FOREVER);
+    NSSet<NSString *> *keys = [_tagKeys[tag] copy] ?: [NSSet set];
+    for (NSString *key in keys) [self _removeKey:key];
+    dispatch_semaphore_signal(_lock);
+    return keys;
+}
+
+- (NSSet<NSString *> *)removeKeysWithPathPrefix:(NSString *)prefix {
+    if (!prefix) return [NSSet set];
+    NSMutableSet<NSString *> *keys = [NSMutableSet set];
+    dispatch_semaphore_wait(_lock, DISPATCH_TIME_FOREVER);
+    NSUInteger start = [self _insertionIndexForPath:prefix];
+    NSUInteger end = start;
+    while (end < _sortedPaths.count && [_sortedPaths[end] hasPrefix:prefix]) {
+        [keys unionSet:_pathKeys[_sortedPaths[end]]];
+        end++;
+    }
+    for (NSString *key in keys) [self _removeKey:key];
+    dispatch_semaphore_signal(_lock);
+    return keys;
+}
+
+- (void)mergeEntriesFromIndex:(ACNetCacheIndex *)index {
+    if (!index || index == self) return;
+    dispatch_semaphore_wait(index->_lock, DISPATCH_TIME_FOREVER);
+    NSDictionary<NSString *, NSArray<NSString *> *> *entries = [index->_entries copy];
+    dispatch_semaphore_signal(index->_lock);
+    dispatch_semaphore_wait(_lock, DISPATCH_TIME_FOREVER);
+    [entries enumerateKeysAndObjectsUsingBlock:^(NSString *key, NSArray<NSString *> *entry, BOOL *stop) {
+        if (self->_entries[key]) return;
+        [self _setPath:entry.firstObject tags:[entry subarrayWithRange:NSMakeRange(1, entry.count - 1)] forKey:key];
+    }];
+    dispatch_semaphore_signal(_lock);
+}
+
+- (BOOL)writeToFile:(NSString *)path {
+    dispatch_semaphore_wait(_lock, DISPATCH_TIME_FOREVER);
+    NSDictionary *entries = [_entries copy];
+    dispatch_semaphore_signal(_lock);
+    return [entries writeToFile:path atomically:YES];
+}
+
+- (NSUInteger)count {
+    dispatch_semaphore_wait(_lock, DISPATCH_TIME_FOREVER);
+    NSUInteger count = _entries.count;
+    dispatch_semaphore_signal(_lock);
+    return count;
+}
+
+/**
+ 内部方法,需确保持有_lock
+
+ @return 记录是否有变化,与原有记录相同时不做修改
+ */
+- (BOOL)_setPath:(NSString *)path tags:(NSArray<NSString *> *)tags forKey:(NSString *)key {
+    if (![path isKindOfClass:NSString.class]) return NO;
+    path = ACNetCacheRootedPath(path);
+    NSMutableArray<NSString *> *entry = [NSMutableArray arrayWithObject:path];
+    for (NSString *tag in tags) {
+        if (![tag isKindOfClass:NSString.class] || [entry indexOfObject:tag inRange:NSMakeRange(1, entry.count - 1)] != NSNotFound) continue;
+        [entry addObject:tag];
+    }
+    if ([_entries[key] isEqualToArray:entry]) return NO;
+    [self _removeKey:key];
+    NSMutableSet<NSString *> *pathKeys = _pathKeys[path];
+    if (!pathKeys) {
+        pathKeys = _pathKeys[path] = [NSMutableSet set];
+        [_sortedPaths insertObject:path atIndex:[self _insertionIndexForPath:path]];
+    }
+    [pathKeys addObject:key];
+    for (NSUInteger i = 1; i < entry.count; i++) {
+        NSMutableSet<NSString *> *tagKeys = _tagKeys[entry[i]] ?: (_tagKeys[entry[i]] = [NSMutableSet set]);
+        [tagKeys addObject:key];
+    }
+    _entries[key] = entry;
+    return YES;
+}
+
+/**
+ 内部方法,需确保持有_lock
+ */
+- (void)_removeKey:(NSString *)key {
+    NSArray<NSString *> *entry = _entries[key];
+    if (!entry) return;
+    [_entries removeObjectForKey:key];
+    NSString *path = entry.firstObject;
+    NSMutableSet<NSString *> *pathKeys = _pathKeys[path];
+    [pathKeys removeObject:key];
+    if (pathKeys.count == 0) {
+        [_pathKeys removeObjectForKey:path];
+        NSUInteger index = [self _insertionIndexForPath:path];
+        if (index < _sortedPaths.count && [_sortedPaths[index] isEqualToString:path]) [_sortedPaths removeObjectAtIndex:index];
+    }
+    for (NSUInteger i = 1; i < entry.count; i++) {
+        NSMutableSet<NSString *> *tagKeys = _tagKeys[entry[i]];
+        [tagKeys removeObject:key];
+        if (tagKeys.count == 0) [_tagKeys removeObjectForKey:entry[i]];
+    }
+}
+
+/**
+ 内部方法,path在_sortedPaths中的位置(已存在时为其位置,否则为插入位置),需确保持有_lock
+ */
+- (NSUInteger)_insertionIndexForPath:(NSString *)path {
+    return [_sortedPaths indexOfObject:path inSortedRange:NSMakeRange(0, _sortedPaths.count) options:NSBinarySearchingFirstEqual | NSBinarySearchingInsertionIndex usingComparator:^NSComparisonResult(NSString *obj1, NSString *obj2) {
+        return [obj1 compare:obj2 options:NSLiteralSearch];
+    }];
+}
+
+@end
+
+/**
+ 在records末尾追加一条二级索引变更日志的记录
+
+ @param records 记录
+ @param op 记录类型
+ @param fields Key,设置路径及标签时其后依次为路径及标签
+ */
+static void ACNetCacheAppendIndexJournalRecord(NSMutableData *records, uint8_t op, NSArray<NSString *> *fields) {
+    NSData *content = [NSPropertyListSerialization dataWithPropertyList:fields format:NSPropertyListBinaryFormat_v1_0 options:0 error:NULL];
+    if (!content || content.length > UINT32_MAX) return;
+    NSUInteger start = records.length;
+    uint32_t length = (uint32_t)content.length;
+    [records appendBytes:&op length:1];
+    [records appendBytes:&length length:sizeof(length)];
+    [records appendData:content];
+    uint32_t crc = ACNetCacheCRC32C((const uint8_t *)records.bytes + start, records.length - start);
+    [records appendBytes:&crc length:sizeof(crc)];
+}
+
+/**
+ 生成一组Key移出二级索引的变更日志记录
+
+ @param keys 缓存Key
+ @return 记录
+ */
+static NSData *ACNetCacheIndexJournalRemovals(NSSet<NSString *> *keys) {
+    NSMutableData *records = [NSMutableData data];
+    for (NSString *key in keys) ACNetCacheAppendIndexJournalRecord(records, ACNetCacheIndexJournalRemove, @[key]);
+    return records;
+}
+
+/**
+ 将二级索引变更日志中的记录依次应用到index,遇到损坏或未写完的记录时停止
+
+ @param journal 日志数据
+ @param index 索引,为nil时只统计记录数
+ @param count 有效记录数(可NULL)
+ @return 有效记录的总长度
+ */
+static NSUInteger ACNetCacheApplyIndexJournal(NSData *journal, ACNetCacheIndex *index, NSUInteger *count) {
+    const uint8_t *bytes = journal.bytes;
+    NSUInteger position = 0;
+    NSUInteger records = 0;
+    while (position + 5 <= journal.length) {
+        uint8_t op = bytes[position];
+        uint32_t length;
+        memcpy(&length, bytes + position + 1, sizeof(length));
+        if ((size_t)length + 5 + sizeof(uint32_t) > journal.length - position) break;
+        uint32_t crc;
+        memcpy(&crc, bytes + position + 5 + length, sizeof(crc));
+        if (crc != ACNetCacheCRC32C(bytes + position, 5 + length)) break;
+        NSArray<NSString *> *fields = [NSPropertyListSerialization propertyListWithData:[journal subdataWithRange:NSMakeRange(position + 5, length)] options:NSPropertyListImmutable format:NULL error:NULL];
+        if (![fields isKindOfClass:NSArray.class] || fields.count == 0 || ![fields.firstObject isKindOfClass:NSString.class]) break;
+        if (op == ACNetCacheIndexJournalSet && fields.count >= 2) {
+            [index setPath:fields[1] tags:[fields subarrayWithRange:NSMakeRange(2, fields.count - 2)] forKey:fields.firstObject];
+        } else if (op == ACNetCacheIndexJournalRemove) {
+            [index removeKey:fields.firstObject];
+        } else {
+            break;
+        }
+        position += 5 + length + sizeof(uint32_t);
+        records++;
+    }
+    if (count) *count = records;
+    return position;
+}
+
+/** 过滤器文件头标识 */
+static uint32_t const ACNetCacheKeyFilterMagic = 0x41434246;
+
+/** 每个Key对应的计数器数 */
+static NSUInteger const ACNetCacheKeyHashCount = 7;
+
+/**
+ 计算Key的两个64位hash(FNV-1a后以SplitMix64混合),用于keyFilter(第i个计数器取h1+i*h2)及磁盘分片.Key通常为ASCII,优先直接读取字符串内部的字节
+
+ @param key Key
+ @param h1 hash1
+ @param h2 hash2,恒为奇数
+ */
+static void ACNetCacheKeyHash(NSString *key, uint64_t *h1, uint64_t *h2) {
+    const char *bytes = CFStringGetCStringPtr((__bridge CFStringRef)key, kCFStringEncodingUTF8) ?: key.UTF8String;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const char *p = bytes; p && *p; p++) {
+        hash = (hash ^ (uint8_t)*p) * 0x100000001b3ULL;
+    }
+    uint64_t x = hash + 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    *h1 = hash;
+    *h2 = x | 1;
+}
+
+/** 磁盘缓存每层分片目录数 */
+static uint64_t const ACNetCacheShardFanout = 64;
+
+/**
+ Key所在的两级分片目录,如@"1f/0a",共64×64个,10万条缓存时每个目录约25个文件
+
+ @param key Key
+ @return 相对磁盘缓存目录的路径
+ */
+static NSString *ACNetCacheShardForKey(NSString *key) {
+    uint64_t h1, h2;
+    ACNetCacheKeyHash(key, &h1, &h2);
+    return [NSString stringWithFormat:@"%02x/%02x", (unsigned)((h2 >> 32) % ACNetCacheShardFanout), (unsigned)((h2 >> 48) % ACNetCacheShardFanout)];
+}
+
+/**
+ 逐项读取目录,只在文件系统不提供类型(DT_UNKNOWN)时读取文件属性
+
+ @param path 目录
+ @param block 回调,参数为文件名及类型(DT_REG、DT_DIR等)
+ */
+static void ACNetCacheEnumerateDirectory(NSString *path, void (^block)(NSString *name, unsigned char type)) {
+    DIR *dir = opendir(path.fileSystemRepresentation);
+    if (!dir) return;
+    struct dirent *entry;
+    while ((entry = readdir(dir))) {
+        if (entry->d_name[0] == '.') continue;
+        @autoreleasepool {
+            NSString *name = [NSString stringWithUTF8String:entry->d_name];
+            unsigned char type = entry->d_type;
+            struct stat fileStat;
+            if (type == DT_UNKNOWN && lstat([path stringByAppendingPathComponent:name].fileSystemRepresentation, &fileStat) == 0) {
+                if (S_ISREG(fileStat.st_mode)) type = DT_REG;
+                else if (S_ISDIR(fileStat.st_mode)) type = DT_DIR;
+                else if (S_ISLNK(fileStat.st_mode)) type = DT_LNK;
+            }
+            block(name, type);
+        }
+    }
+    closedir(dir);
+}
+
+/**
+ 计数型布隆过滤器,记录磁盘中存在的Key:判定不存在时一定不存在,判定存在时约1%的概率误判.
+ 每个Key对应7个8位计数器(容量的10倍,取2的幂),删除时减1,饱和的计数器不再减少.线程安全
+ */
+@interface ACNetCacheKeyFilter : NSObject
+
+/** 设计容量,超出后误判率上升,需按更大的容量重建 */
+@property (nonatomic, assign, readonly) NSUInteger capacity;
+
+/** 加入的Key数量 */
+@property (nonatomic, assign, readonly) NSUInteger count;
+
+/**
+ 实例化
+
+ @param capacity 设计容量
+ @return 过滤器
+ */
+- (instancetype)initWithCapacity:(NSUInteger)capacity;
+
+/**
+ 从dataRepresentation恢复
+
+ @param data 数据
+ @return 过滤器,数据无效时返回nil
+ */
+- (instancetype)initWithData:(NSData *)data;
+
+/**
+ 加入Key,同一Key只应加入一次
+
+ @param key Key
+ */
+- (void)addKey:(NSString *)key;
+
+/**
+ 移除已加入的Key
+
+ @param key Key
+ */
+- (void)removeKey:(NSString *)key;
+
+/**
+ Key是否可能存在
+
+ @param key Key
+ @return NO时一定不存在
+ */
+- (BOOL)mayContainKey:(NSString *)key;
+
+/**
+ 序列化
+
+ @return 数据
+ */
+- (NSData *)dataRepresentation;
+
+@end
+
+@implementation ACNetCacheKeyFilter {
+    uint8_t *_counters;
+    /** 计数器数量-1 */
+    uint64_t _mask;
+    dispatch_semaphore_t _lock;
+}
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity {
+    if (self = [super init]) {
+        _capacity = MAX(capacity, 1024);
+        uint64_t size = 1;
+        while (size < _capacity * 10) size <<= 1;
+        _mask = size - 1;
+        _counters = calloc(size, 1);
+        _lock = dispatch_semaphore_create(1);
+    }
+    return self;
+}
+
+- (instancetype)initWithData:(NSData *)data {
+    if (data.length < 24) return nil;
+    const uint8_t *bytes = data.bytes;
+    uint32_t magic;
+    uint64_t capacity, count;
+    memcpy(&magic, bytes, 4);
+    memcpy(&capacity, bytes + 8, 8);
+    memcpy(&count, bytes + 16, 8);
+    if (magic != ACNetCacheKeyFilterMagic || capacity == 0 || capacity > NSUIntegerMax / 10) return nil;
+    if (self = [self initWithCapacity:(NSUInteger)capacity]) {
+        if (_capacity != capacity || data.length != 24 + _mask + 1) return nil;
+        memcpy(_counters, bytes + 24, (size_t)(_mask + 1));
+        _count = (NSUInteger)count;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_counters);
+}
+
+- (void)addKey:(NSString *)key {
+    uint64_t h1, h2;
+    ACNetCacheKeyHash(key, &h1, &h2);
+    dispatch_semaphore_wait(_lock, DISPATCH_TIME_FOREVER);
+    for (NSUInteger i = 0; i < ACNetCacheKeyHashCount; i++) {
+        uint8_t *counter = &_counters[(h1 + i * h2) & _mask];
+        if (*counter < UINT8_MAX) (*counter)++;
+    }
+    _count++;
+    dispatch_semaphore_signal(_lock);
+}
+
+- (void)removeKey:(NSString *)key {
+    uint64_t h1, h2;
+    ACNetCacheKeyHash(key, &h1, &h2);
+    dispatch_semaphore_wait(_lock, DISPATCH_TIME_FOREVER);
+    for (NSUInteger i = 0; i < ACNetCacheKeyHashCount; i++) {
+        uint8_t *counter = &_counters[(h1 + i * h2) & _mask];
+        if (*counter > 0 && *counter < UINT8_MAX) (*counter)--;
+    }
+    if (_count > 0) _count--;
+    dispatch_semaphore_signal(_lock);
+}
+
+- (BOOL)mayContainKey:(NSString *)key {
+    uint64_t h1, h2;
+    ACNetCacheKeyHash(key, &h1, &h2);
+    BOOL contains = YES;
+    dispatch_semaphore_wait(_lock, DISPATCH_TIME_FOREVER);
+    for (NSUInteger i = 0; i < ACNetCacheKeyHashCount && contains; i++) {
+        contains = _counters[(h1 + i * h2) & _mask] > 0;
+    }
+    dispatch_semaphore_signal(_lock);
+    return contains;
+}
+
+- (NSData *)dataRepresentation {
+    NSMutableData *data = [NSMutableData dataWithLength:24];
+    uint8_t *bytes = data.mutableBytes;
+    uint32_t magic = ACNetCacheKeyFilterMagic;
+    uint64_t capacity = _capacity;
+    dispatch_semaphore_wait(_lock, DISPATCH_TIME_FOREVER);
+    uint64_t count = _count;
+    memcpy(bytes, &magic, 4);
+    memcpy(bytes + 8, &capacity, 8);
+    memcpy(bytes + 16, &count, 8);
+    [data appendBytes:_counters length:(NSUInteger)(_mask + 1)];
+    dispatch_semaphore_signal(_lock);
+    return data;
+}
+
+@end
+
+/** 共享模式下映射到各进程的状态,计数只在持有文件锁时增加 */
+typedef struct {
+    uint32_t magic;
+    uint32_t reserved;
+    /** 磁盘缓存代数,每次deleteAllResponses加1 */
+    _Atomic uint64_t generation;
+    /** 磁盘修改序号,每追加一条变更日志或deleteAllResponses加1 */
+    _Atomic uint64_t sequence;
+} ACNetCacheSharedState;
+
+NSString * const ACNetCacheFailureStatusCodeKey = @"com.acnetworking.netcache.statuscode";
+
+@interface ACNetCache() {
+    /** 已提交但尚未在self.ioQueue中执行的磁盘写入数,不为0时不按keyFilter判定不存在 */
+    atomic_long _pendingDiskWrites;
+    /** 共享模式下映射的跨进程状态,非共享模式为NULL */
+    ACNetCacheSharedState *_sharedState;
+    /** 本进程已同步到的磁盘修改序号,与_sharedState->sequence不同时内存缓存及keyFilter可能已过时 */
+    atomic_ullong _observedSequence;
+    /** 是否已安排同步其他进程的修改 */
+    atomic_bool _synchronizationScheduled;
+}
+
+@property (nonatomic, copy) NSString *diskDirectory;
+
+@property (strong, nonatomic, nonnull) dispatch_queue_t ioQueue;
+
+/** dispatch_io写入的回调队列,写完后回到self.ioQueue替换文件 */
+@property (strong, nonatomic, nonnull) dispatch_queue_t ioWriteQueue;
+
+@property (strong, nonatomic, nonnull) NSFileManager *fileManager;
+
+/** deleteAllResponses时整体替换,因此以下三个内存缓存为atomic */
+@property (atomic, strong) ACMemoryCache *memoryCache;
+
+/** 跨进程共享内存层,未启用时为nil */
+@property (atomic, strong) ACNetCacheSharedArena *sharedArena;
+
+/** 失败结果缓存,与memoryCache分开存放,避免与正常结果互相挤占 */
+@property (atomic, strong) ACMemoryCache *negativeCache;
+
+/** 由内存缓存结果解析出的模型 */
+@property (atomic, strong) NSCache<NSString *, ACNetCacheModelEntry *> *modelCache;
+
+@property (atomic, assign, readwrite) NSUInteger generation;
+
+/** 最近一次deleteAllResponses的时间,早于此时间的结果不再写入内存 */
+@property (atomic, strong) NSDate *invalidationDate;
+
+/** 各Key的命中次数,用于生成热点Key清单 */
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSNumber *> *hitCounts;
+
+@property (nonatomic, strong) dispatch_semaphore_t hitLock;
+
+/** 命中次数在上次保存清单后是否有变化 */
+@property (nonatomic, assign) BOOL hotSetDirty;
+
+/** 定期保存热点Key清单 */
+@property (nonatomic, strong) dispatch_source_t hotSetTimer;
+
+/** 最近写入磁盘的缓存内容的SHA256,用于跳过未变化内容的重复写入 */
+@property (nonatomic, strong) NSCache<NSString *, NSString *> *entryDigests;
+
+/** 内容的引用计数,只在self.ioQueue中访问 */
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSNumber *> *blobRefCounts;
+
+/** 是否已安排保存引用计数 */
+@property (nonatomic, assign) BOOL blobRefCountsSaveScheduled;
+
+/** 是否已创建引用计数的未保存标记 */
+@property (nonatomic, assign) BOOL blobRefCountsDirty;
+
+/** Key对应的URL路径及标签,创建时为空,磁盘中的记录在self.ioQueue中读取后合并 */
+@property (atomic, strong) ACNetCacheIndex *secondaryIndex;
+
+/** 读取磁盘中的二级索引,完成前处于enter状态 */
+@property (nonatomic, strong) dispatch_group_t indexLoadGroup;
+
+/** 二级索引变更日志的文件描述符,未打开时为-1,只在self.ioQueue中访问 */
+@property (nonatomic, assign) int indexJournalDescriptor;
+
+/** 二级索引变更日志中的记录数,只在self.ioQueue中访问 */
+@property (nonatomic, assign) NSUInteger indexJournalRecordCount;
+
+/** 二级索引变更日志中已应用的位置,共享模式下此后的记录由其他进程追加.只在self.ioQueue中访问 */
+@property (nonatomic, assign) off_t indexJournalOffset;
+
+/** 磁盘中存在的Key,启动时在self.ioQueue中读取或重建,此前为nil.只在self.ioQueue中修改 */
+@property (atomic, strong) ACNetCacheKeyFilter *keyFilter;
+
+/** keyFilter变更日志的文件描述符,未打开时为-1,只在self.ioQueue中访问 */
+@property (nonatomic, assign) int keyJournalDescriptor;
+
+/** 当前检查点及变更日志的代数,只在self.ioQueue中访问 */
+@property (nonatomic, assign) uint64_t keyJournalGeneration;
+
+/** 当前变更日志中的记录数,只在self.ioQueue中访问 */
+@property (nonatomic, assign) NSUInteger keyJournalRecordCount;
+
+/** 变更日志中已应用到keyFilter的位置,只在self.ioQueue中访问 */
+@property (nonatomic, assign) off_t keyJournalOffset;
+
+@property (nonatomic, assign, readwrite, getter=isShared) BOOL shared;
+
+/** 共享状态文件的描述符,用于文件锁 */
+@property (nonatomic, assign) int sharedStateDescriptor;
+
+/** 文件锁的重入深度,只在self.ioQueue中访问 */
+@property (nonatomic, assign) NSUInteger sharedLockDepth;
+
+/** 本进程已同步到的磁盘缓存代数,只在self.ioQueue中访问 */
+@property (nonatomic, assign) uint64_t observedGeneration;
+
+/** 已创建的分片目录,只在self.ioQueue中访问 */
+@property (nonatomic, strong) NSMutableSet<NSString *> *shardDirectories;
+
+/** 是否仍有旧版平铺在磁盘缓存目录下的缓存文件未迁移,只在self.ioQueue中访问 */
+@property (nonatomic, assign) BOOL migratingFlatEntries;
+
+/** 正在以dispatch_io写入的缓存文件路径及最新的写入,只有仍为最新的写入才会替换文件,此前读取该路径返回其数据.只在self.ioQueue中访问 */
+@property (nonatomic, strong) NSMutableDictionary<NSString *, ACNetCachePendingWrite *> *pendingEntryWrites;
+
+/** 启动时的流式写入临时文件清理是否已完成,完成后临时文件目录一直存在 */
+@property (atomic, assign) BOOL streamingDirectoryReady;
+
+@end
 
 
 @implementation ACNetCache
 
-#pragma mark - Singleton
+#pragma mark - Singleton
+
++ (instancetype)sharedCache {
+    static ACNetCache *_sharedCache;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        _sharedCache = [ACNetCache cacheWithNamespace:@"defaultCache"];
+    });
+    return _sharedCache;
+}
+
+#pragma mark - Constructor
+
+- (instancetype)initWithNamespace:(NSString *)ns directiory:(NSString *)directory keyGenerator:(ACNetCacheKeyGenerator)keyGenerator shared:(BOOL)shared {
+    if (self = [super init]) {
+        _ioQueue = dispatch_queue_create("com.acnetworking.netcache", DISPATCH_QUEUE_SERIAL);
+        _ioWriteQueue = dispatch_queue_create("com.acnetworking.netcache.write", DISPATCH_QUEUE_SERIAL);
+        NSString *fullNamespace = [@"com.acnetworking.netcache." stringByAppendingString:ns];
+        if (directory) {
+            _diskDirectory = [directory stringByAppendingPathComponent:fullNamespace];
+        } else {
+            _diskDirectory = [self makeDiskCachePath:fullNamespace];
+        }
+        _memoryCacheByteBudget = 32 * 1024 * 1024;
+        _maximumMemoryEntryCost = 4 * 1024 * 1024;
+        _memoryCacheMaximumAge = Expire_Time_Never;
+        [self setupMemoryCachesWithName:fullNamespace];
+        _negativeCacheExpire = 30;
+        NSMutableIndexSet *statusCodes = [NSMutableIndexSet indexSetWithIndex:404];
+        [statusCodes addIndex:410];
+        _negativeCacheStatusCodes = [statusCodes copy];
+        if (keyGenerator) _keyGenerator = keyGenerator;
+        _hotSetByteBudget = 4 * 1024 * 1024;
+        _hotSetCapacity = 256;
+        _hitCounts = [NSMutableDictionary dictionary];
+        _hitLock = dispatch_semaphore_create(1);
+        _entryDigests = [[NSCache alloc] init];
+        _entryDigests.countLimit = 1000;
+        dispatch_sync(_ioQueue, ^{
+            self.fileManager = [NSFileManager new];
+            self.shardDirectories = [NSMutableSet set];
+            self.pendingEntryWrites = [NSMutableDictionary dictionary];
+        });
+        _sharedStateDescriptor = -1;
+        if (shared) [self setupSharedState];
+        [self setupHotSet];
+        /** 清理上次未提交的流式写入临时文件,只删除本实例创建前的文件;共享模式下其他进程可能正在写入,只清理长时间未修改的 */
+        NSTimeInterval launchTime = [NSDate date].timeIntervalSince1970;
+        dispatch_async(_ioQueue, ^{
+            NSString *streamingDirectory = [self.diskDirectory stringByAppendingPathComponent:ACNetCacheStreamingDirectoryName];
+            for (NSString *fileName in [self.fileManager contentsOfDirectoryAtPath:streamingDirectory error:NULL]) {
+                NSString *filePath = [streamingDirectory stringByAppendingPathComponent:fileName];
+                struct stat fileStat;
+                if (lstat(filePath.fileSystemRepresentation, &fileStat) != 0) continue;
+                BOOL stale = self.shared ? [self fileExpiredAtPath:filePath expires:ACNetCacheSharedTemporaryFileLifetime] : fileStat.st_mtimespec.tv_sec < (time_t)launchTime;
+                if (stale) unlink(filePath.fileSystemRepresentation);
+            }
+            [self _createStreamingDirectory];
+            self.streamingDirectoryReady = YES;
+        });
+        /** 将旧版平铺的缓存文件迁移到分片目录 */
+        dispatch_async(_ioQueue, ^{
+            [self _migrateFlatEntries];
+        });
+        /** 清理上次未删除完的失效目录及隔离的文件 */
+        [self emptyTrash];
+        [self emptyDirectoryInBackground:[self metadataPathForName:ACNetCacheQuarantineDirectoryName]];
+        _keyJournalDescriptor = -1;
+        [self setupKeyFilter];
+        _indexJournalDescriptor = -1;
+        [self setupSecondaryIndex];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+    if (_hotSetTimer) dispatch_source_cancel(_hotSetTimer);
+    if (_keyJournalDescriptor >= 0) close(_keyJournalDescriptor);
+    if (_indexJournalDescriptor >= 0) close(_indexJournalDescriptor);
+    if (_sharedState) munmap(_sharedState, sizeof(ACNetCacheSharedState));
+    if (_sharedStateDescriptor >= 0) close(_sharedStateDescriptor);
+}
+
++ (instancetype)cacheWithNamespace:(NSString *)ns {
+    return [self cacheWithNamespace:ns directiory:nil];
+}
+
++ (instancetype)cacheWithNamespace:(NSString *)ns directiory:(nullable NSString *)directory {
+    return [self cacheWithNamespace:ns directiory:directory keyGenerator:nil];
+}
+
++ (instancetype)cacheWithNamespace:(NSString *)ns directiory:(nullable NSString *)directory keyGenerator:(nullable ACNetCacheKeyGenerator)keyGenerator {
+    return [self cacheWithNamespace:ns directiory:directory keyGenerator:keyGenerator shared:NO];
+}
+
++ (instancetype)cacheWithNamespace:(NSString *)ns directiory:(nullable NSString *)directory keyGenerator:(nullable ACNetCacheKeyGenerator)keyGenerator shared:(BOOL)shared {
+    return [[self alloc] initWithNamespace:ns directiory:directory keyGenerator:keyGenerator shared:shared];
+}
+
+- (NSString *)makeDiskCachePath:(NSString*)fullNamespace {
+    NSArray<NSString *> *paths = NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES);
+    return [paths[0] stringByAppendingPathComponent:fullNamespace];
+}
+
+/**
+ 按当前设置创建空的内存缓存、失败结果缓存及模型缓存,替换原有的
+
+ @param name 内存缓存名称
+ */
+- (void)setupMemoryCachesWithName:(NSString *)name {
+    ACMemoryCache *memoryCache = [[ACMemoryCache alloc] init];
+    memoryCache.name = name;
+    memoryCache.byteLimit = self.memoryCacheByteBudget;
+    memoryCache.maximumAge = self.memoryCacheMaximumAge < Expire_Time_Never ? MAX(self.memoryCacheMaximumAge, 0) : 0;
+    ACMemoryCache *negativeCache = [[ACMemoryCache alloc] init];
+    negativeCache.name = [name stringByAppendingString:@".negative"];
+    negativeCache.countLimit = 1000;
+    NSCache *modelCache = [[NSCache alloc] init];
+    modelCache.name = [name stringByAppendingString:@".model"];
+    self.memoryCache = memoryCache;
+    self.negativeCache = negativeCache;
+    self.modelCache = modelCache;
+}
+
+#pragma mark - Check
+
+/**
+ 检查内存或磁盘缓存中是否有缓存的response
+ 
+ @param url URL
+ @param param 请求参数
+ @return 是否有缓存
+ */
+- (BOOL)cacheExistsForUrl:(NSString *)url param:(NSDictionary *)param {
+    return [self cacheExistsForUrl:url param:param keyGenerator:nil];
+}
+
+/**
+ 检查内存或磁盘缓存中是否有缓存的response
+ 
+ @param url URL
+ @param param 请求参数
+ @param expire 过期时间
+ @return 是否有缓存
+ */
+- (BOOL)cacheExistsForUrl:(NSString *)url param:(NSDictionary *)param expires:(Expire_Time)expire {
+    return [self cacheExistsForUrl:url param:param expires:expire keyGenerator:nil];
+}
+
+/**
+ 检查内存或磁盘缓存中是否有缓存的response
+ 
+ @param url URL
+ @param param 请求参数
+ @param generator 缓存key生成器
+ @return 是否有缓存
+ */
+- (BOOL)cacheExistsForUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(ACNetCacheKeyGenerator)generator {
+    return [self cacheExistsForUrl:url param:param expires:Expire_Time_Never keyGenerator:generator];
+}
+
+/**
+ 检查内存或磁盘缓存中是否有缓存的response
+ 
+ @param url URL
+ @param param 请求参数
+ @param expire 过期时间
+ @param generator 缓存key生成器
+ @return 是否有缓存
+ */
+- (BOOL)cacheExistsForUrl:(NSString *)url param:(NSDictionary *)param expires:(Expire_Time)expire keyGenerator:(ACNetCacheKeyGenerator)generator {
+    return [self memoryCacheExistsForUrl:url param:param keyGenerator:generator expires:expire] || [self diskCacheExistsForUrl:url param:param keyGenerator:generator expires:expire];
+}
+
+/**
+ 检查内存缓存中是否存在对应的response缓存
+ 
+ @param url URL
+ @param param 请求参数
+ @return 是否有缓存
+ */
+- (BOOL)memoryCacheExistsForUrl:(NSString *)url param:(NSDictionary *)param {
+    return [self memoryCacheExistsForUrl:url param:param keyGenerator:nil];
+}
+
+/**
+ 检查内存缓存中是否存在对应的response缓存
+ 
+ @param url URL
+ @param param 请求参数
+ @param generator 缓存Key生成器
+ @return 是否有缓存
+ */
+- (BOOL)memoryCacheExistsForUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(ACNetCacheKeyGenerator)generator {
+    return [self memoryCacheExistsForKey:[self fetchCacheKeyWithUrl:url param:param keyGenerator:generator]];
+}
+
+/**
+ 检查内存缓存中是否存在对应的response缓存
+ 
+ @param url URL
+ @param param 请求参数
+ @param expire 过期时间
+ @return 是否有缓存
+ */
+- (BOOL)memoryCacheExistsForUrl:(NSString *)url param:(NSDictionary *)param expires:(Expire_Time)expire {
+    return [self memoryCacheExistsForUrl:url param:param keyGenerator:nil expires:expire];
+}
+
+/**
+ 检查内存缓存中是否存在对应的response缓存
+ 
+ @param url URL
+ @param param 请求参数
+ @param expire 过期时间
+ @param generator 缓存Key生成器
+ @return 是否有缓存
+ */
+- (BOOL)memoryCacheExistsForUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(ACNetCacheKeyGenerator)generator expires:(Expire_Time)expire {
+    return [self memoryCacheExistsForKey:[self fetchCacheKeyWithUrl:url  param:param keyGenerator:generator] expires:expire];
+}
+
+/**
+ 检查内存缓存中是否存在对应的response缓存
+ 
+ @param key Key
+ @return 是否有缓存
+ */
+- (BOOL)memoryCacheExistsForKey:(NSString *)key {
+    return [self memoryCacheExistsForKey:key expires:Expire_Time_Never];
+}
+
+/**
+ 检查内存缓存中是否存在对应的response缓存
+ 
+ @param key Key
+ @param expire 过期时间
+ @return 是否有缓存
+ */
+- (BOOL)memoryCacheExistsForKey:(NSString *)key expires:(Expire_Time)expire {
+    if ([self sharedViewIsCurrent] && [self.memoryCache objectForKey:key expires:expire]) return YES;
+    return [self sharedMemoryDataForKey:key expires:expire cacheDate:NULL] != nil;
+}
+
+/**
+ 检查磁盘缓存中是否存在对应的response缓存
+ 
+ @param url URL
+ @param param 请求参数
+ @return 是否有缓存
+ */
+- (BOOL)diskCacheExistsForUrl:(NSString *)url param:(NSDictionary *)param {
+    return [self diskCacheExistsForUrl:url param:param keyGenerator:nil];
+}
+
+/**
+ 检查磁盘缓存中是否存在对应的response缓存
+ 
+ @param url URL
+ @param param 请求参数
+ @param expire 过期时间
+ @return 是否有缓存
+ */
+- (BOOL)diskCacheExistsForUrl:(NSString *)url param:(NSDictionary *)param expires:(Expire_Time)expire {
+    return [self diskCacheExistsForUrl:url param:param keyGenerator:nil expires:expire];
+}
+
+/**
+ 检查磁盘缓存中是否存在对应的response缓存
+ 
+ @param url URL
+ @param param 请求参数
+ @param generator 缓存Key生成器
+ @return 是否有缓存
+ */
+- (BOOL)diskCacheExistsForUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(ACNetCacheKeyGenerator)generator {
+    return [self diskCacheExistsForKey:[self fetchCacheKeyWithUrl:url  param:param keyGenerator:generator] expires:Expire_Time_Never];
+}
+
+/**
+ 检查磁盘缓存中是否存在对应的response缓存
+ 
+ @param url URL
+ @param param 请求参数
+ @param expire 过期时间
+ @param generator 缓存Key生成器
+ @return 是否有缓存
+ */
+- (BOOL)diskCacheExistsForUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(ACNetCacheKeyGenerator)generator expires:(Expire_Time)expire {
+    return [self diskCacheExistsForKey:[self fetchCacheKeyWithUrl:url  param:param keyGenerator:generator] expires:expire];
+}
+
+/**
+ 检查磁盘缓存中是否存在对应的response缓存
+ 
+ @param key Key
+ @return 是否有缓存
+ */
+- (BOOL)diskCacheExistsForKey:(NSString *)key expires:(Expire_Time)expire {
+    if (![self diskCacheMayContainKey:key]) return NO;
+    __block BOOL exists = NO;
+    dispatch_sync(self.ioQueue, ^{
+        exists = [self _diskCacheExistsForKey:key expires:expire];
+    });
+    return exists;
+}
+
+/**
+ 内部方法,检查磁盘缓存中是否存在对应的response缓存,需确保此方法在self.ioQueue中调用
+
+ @param key Key
+ @param expire 过期时间
+ @return 是否有缓存
+ */
+- (BOOL)_diskCacheExistsForKey:(NSString *)key expires:(Expire_Time)expire {
+    if (!key) return NO;
+    [self _synchronizeSharedState];
+    NSString *filePath = [self filePathForStoreKey:key];
+    ACNetCachePendingWrite *pending = self.pendingEntryWrites[filePath];
+    if (pending) return ![pending isExpiredForExpires:expire];
+    BOOL exists = [self.fileManager fileExistsAtPath:filePath];
+    if (exists) exists = ![self fileExpiredAtPath:filePath expires:expire];
+    return exists;
+}
+
+#pragma mark - Memory
+
+/**
+ 同步获取内存缓存的response,不过期
+ 
+ @param url URL
+ @param param 请求参数
+ @return 内存中缓存的response
+ */
+- (id)responseForUrl:(NSString *)url param:(NSDictionary *)param {
+    return [self responseForUrl:url param:param expires:Expire_Time_Never];
+}
+
+/**
+ 同步获取内存缓存的response
+ 
+ @param url URL
+ @param param 请求参数
+ @param expire 过期时间
+ @return 内存中缓存的response
+ */
+- (id)responseForUrl:(NSString *)url param:(NSDictionary *)param expires:(Expire_Time)expire {
+    return [self responseForUrl:url param:param keyGenerator:nil expires:expire cacheDate:NULL];
+}
+
+/**
+ 同步获取内存缓存的response
+ 
+ @param url URL
+ @param param 请求参数
+ @param generator 缓存Key生成器
+ @param expire 过期时间
+ @param cacheDate 缓存时间
+ @return 内存中缓存的response
+ */
+- (id)responseForUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(ACNetCacheKeyGenerator)generator expires:(Expire_Time)expire cacheDate:(NSDate **)cacheDate {
+    if (!url) return nil;
+    NSString *storeKey = [self fetchCacheKeyWithUrl:url param:param keyGenerator:generator];
+    id response = [self memoryResponseForKey:storeKey expires:expire cacheDate:cacheDate];
+    if (response) [self recordHitForKey:storeKey];
+    return response;
+}
+
+#pragma mark - Model
+
+/**
+ 同步获取内存中由缓存结果解析出的模型
+ 
+ @param url URL
+ @param param 请求参数
+ @param generator 缓存Key生成器
+ @param decoder 解析器名称
+ @param expire 过期时间
+ @param cacheDate 缓存时间
+ @return 模型
+ */
+- (id)modelForUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(ACNetCacheKeyGenerator)generator decoder:(NSString *)decoder expires:(Expire_Time)expire cacheDate:(NSDate **)cacheDate {
+    if (!url || !decoder) return nil;
+    NSString *storeKey = [self fetchCacheKeyWithUrl:url param:param keyGenerator:generator];
+    ACNetCacheModelEntry *entry = [self.modelCache objectForKey:storeKey];
+    id model = nil;
+    NSDate *date = nil;
+    /** 共享区域中有该Key时以其记录为准,本进程内存缓存中的结果已过时 */
+    NSTimeInterval timestamp = [self.sharedArena timestampForKey:storeKey];
+    if (timestamp) {
+        if (timestamp + expire <= [NSDate date].timeIntervalSince1970) return nil;
+        @synchronized (entry) {
+            if (entry.timestamp == timestamp) model = entry.models[decoder];
+        }
+        date = [NSDate dateWithTimeIntervalSince1970:timestamp];
+    } else {
+        id response = [self sharedViewIsCurrent] ? [self.memoryCache objectForKey:storeKey expires:expire] : nil;
+        if (!response) return nil;
+        @synchronized (entry) {
+            if (entry.source == response && entry.timestamp == 0) model = entry.models[decoder];
+        }
+        date = [self.memoryCache updateDateForKey:storeKey];
+    }
+    if (!model) return nil;
+    [self recordHitForKey:storeKey];
+    if (cacheDate) *cacheDate = date;
+    return model;
+}
+
+/**
+ 缓存由response解析出的模型到内存
+ 
+ @param model 模型
+ @param decoder 解析器名称
+ @param response 解析模型所用的结果
+ @param cacheDate response的缓存时间
+ @param url URL
+ @param param 请求参数
+ @param generator 缓存Key生成器
+ */
+- (void)storeModel:(id)model decoder:(NSString *)decoder forResponse:(id)response cacheDate:(NSDate *)cacheDate url:(NSString *)url param:(NSDictionary *)param keyGenerator:(ACNetCacheKeyGenerator)generator {
+    if (!model || !decoder || !response || !url) return;
+    NSString *storeKey = [self fetchCacheKeyWithUrl:url param:param keyGenerator:generator];
+    /** deleteAllResponses前读到的结果已失效 */
+    NSDate *invalidationDate = self.invalidationDate;
+    if (invalidationDate && cacheDate && [cacheDate compare:invalidationDate] == NSOrderedAscending) return;
+    ACNetCacheModelEntry *entry = self.sharedArena ? [self sharedModelEntryForResponse:response cacheDate:cacheDate key:storeKey] : nil;
+    if (!entry) {
+        /** 内存中没有结果(磁盘命中)时补充缓存,已有其他结果则说明response已过时,不缓存模型.启用共享内存层时不写入本进程的内存缓存 */
+        id current = [self.memoryCache objectForKey:storeKey];
+        if (!current && !self.sharedArena) {
+            NSUInteger cost = ACNetCacheEstimatedCost(response, NULL);
+            if ([self shouldAdmitResponseForKey:storeKey cost:cost] && [self.memoryCache addObject:response forKey:storeKey cost:cost updateDate:cacheDate]) current = response;
+        }
+        if (current != response || [self.sharedArena timestampForKey:storeKey]) return;
+        entry = [self.modelCache objectForKey:storeKey];
+        if (!entry || entry.source != response || entry.timestamp != 0) {
+            entry = [ACNetCacheModelEntry new];
+            entry.source = response;
+            [self.modelCache setObject:entry forKey:storeKey];
+        }
+    }
+    @synchronized (entry) {
+        NSMutableDictionary *models = [NSMutableDictionary dictionaryWithDictionary:entry.models];
+        models[decoder] = model;
+        entry.models = models;
+    }
+}
+
+/**
+ 共享区域中该Key的记录对应的模型条目:response须为该记录的结果,即本进程写入该记录时的结果,或读取自该记录(缓存时间一致).
+ 共享区域中没有该Key且response来自磁盘时,以原缓存时间补充写入共享区域.可在任意线程调用
+
+ @param response 解析模型所用的结果
+ @param cacheDate response的缓存时间
+ @param storeKey 缓存的Key
+ @return 模型条目,共享区域中没有该Key的记录时返回nil;response已过时返回nil
+ */
+- (ACNetCacheModelEntry *)sharedModelEntryForResponse:(id)response cacheDate:(NSDate *)cacheDate key:(NSString *)storeKey {
+    NSTimeInterval timestamp = [self.sharedArena timestampForKey:storeKey];
+    if (!timestamp && cacheDate && ![self.memoryCache objectForKey:storeKey] && [self storeResponseToSharedMemory:response data:nil forKey:storeKey timestamp:cacheDate.timeIntervalSince1970]) {
+        timestamp = cacheDate.timeIntervalSince1970;
+    }
+    if (!timestamp) return nil;
+    ACNetCacheModelEntry *entry = [self.modelCache objectForKey:storeKey];
+    if (entry.timestamp == timestamp && (entry.source == response || cacheDate.timeIntervalSince1970 == timestamp)) return entry;
+    if (cacheDate.timeIntervalSince1970 != timestamp) return nil;
+    entry = [ACNetCacheModelEntry new];
+    entry.source = response;
+    entry.timestamp = timestamp;
+    [self.modelCache setObject:entry forKey:storeKey];
+    return entry;
+}
+
+#pragma mark - Store
+
+/**
+ 缓存response
+ 
+ @param response 要缓存的结果
+ @param url URL
+ @param param 请求参数
+ */
+- (void)storeResponse:(id)response forUrl:(nonnull NSString *)url param:(NSDictionary *)param {
+    [self storeResponse:response forUrl:url param:param toMemory:YES toDisk:YES];
+}
+
+/**
+ 缓存response
+ 
+ @param response 要缓存的结果
+ @param url URL
+ @param param 请求参数
+ @param generator 缓存Key生成器
+ */
+- (void)storeResponse:(id)response forUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(ACNetCacheKeyGenerator)generator {
+    [self storeResponse:response forUrl:url param:param keyGenerator:generator toMemory:YES toDisk:YES];
+}
+
+/**
+ 缓存请求得到的response,请求发出后清空过缓存时丢弃
+
+ @param response 要缓存的结果
+ @param url URL
+ @param param 请求参数
+ @param generator 缓存Key生成器
+ @param generation 发出请求时的generation
+ */
+- (void)storeResponse:(id)response forUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(ACNetCacheKeyGenerator)generator generation:(NSUInteger)generation {
+    [self storeResponse:response forUrl:url param:param keyGenerator:generator tags:nil toMemory:YES toDisk:YES generation:generation];
+}
+
+/**
+ 缓存response
+
+ @param response 要缓存的结果
+ @param url URL
+ @param param 请求参数
+ @param toMemory 是否缓存到内存
+ @param generator 缓存Key生成器
+ @param toDisk 是否缓存到磁盘
+ */
+- (void)storeResponse:(id)response forUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(ACNetCacheKeyGenerator)generator toMemory:(BOOL)toMemory toDisk:(BOOL)toDisk {
+    [self storeResponse:response forUrl:url param:param keyGenerator:generator tags:nil toMemory:toMemory toDisk:toDisk];
+}
+
+/**
+ 缓存response并打上标签
+
+ @param response 要缓存的结果
+ @param url URL
+ @param param 请求参数
+ @param generator 缓存Key生成器
+ @param tags 标签,nil时使用tagGenerator
+ @param toMemory 是否缓存到内存
+ @param toDisk 是否缓存到磁盘
+ */
+- (void)storeResponse:(id)response forUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(ACNetCacheKeyGenerator)generator tags:(NSArray<NSString *> *)tags toMemory:(BOOL)toMemory toDisk:(BOOL)toDisk {
+    [self storeResponse:response forUrl:url param:param keyGenerator:generator tags:tags toMemory:toMemory toDisk:toDisk generation:self.generation];
+}
+
+/**
+ 缓存response,generation与当前不同时丢弃.磁盘写入在self.ioQueue中再次检查,写入内存后若已清空则移除,
+ 保证deleteAllResponses之后不会留下此前发出的请求的结果.序列化都在self.ioQueue中进行,不占用调用方的线程
+
+ @param response 要缓存的结果
+ @param url URL
+ @param param 请求参数
+ @param generator 缓存Key生成器
+ @param tags 标签,nil时使用tagGenerator
+ @param toMemory 是否缓存到内存
+ @param toDisk 是否缓存到磁盘
+ @param generation 结果所属的generation
+ */
+- (void)storeResponse:(id)response forUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(ACNetCacheKeyGenerator)generator tags:(NSArray<NSString *> *)tags toMemory:(BOOL)toMemory toDisk:(BOOL)toDisk generation:(NSUInteger)generation {
+    if ((!toMemory && !toDisk) || generation != self.generation) return;
+    NSString *storeKey = [self fetchCacheKeyWithUrl:url param:param keyGenerator:generator];
+    /** 有了正常结果,之前缓存的失败结果即失效 */
+    [self.negativeCache removeObjectForKey:storeKey];
+    [self indexKey:storeKey url:url param:param tags:tags];
+    /** 同时写入内存及磁盘时只在写入磁盘时序列化一次,数据大小即内存缓存的cost */
+    if (toMemory) {
+        [self storeResponseToMemory:response forKey:storeKey archiving:toDisk];
+        if (generation != self.generation) [self removeMemoryResponseForKey:storeKey];
+    }
+    if (toDisk) [self storeResponseToDisk:response data:nil generation:generation forKey:storeKey];
+}
+
+/**
+ 缓存response
+ 
+ @param response 要缓存的结果
+ @param url URL
+ @param param 请求参数
+ @param toDisk 是否缓存到磁盘
+ */
+- (void)storeResponse:(id)response forUrl:(NSString *)url param:(NSDictionary *)param toMemory:(BOOL)toMemory toDisk:(BOOL)toDisk {
+    [self storeResponse:response forUrl:url param:param keyGenerator:nil toMemory:toMemory toDisk:toDisk];
+}
+
+/**
+ 缓存response到内存:启用共享内存层时优先写入共享区域,写入失败时按准入策略写入本进程的内存缓存,未准入时移除内存中该Key的旧结果,避免之后读到过时的结果
+
+ @param response 要缓存的结果
+ @param storeKey 缓存的Key
+ */
+- (void)storeResponseToMemory:(id)response forKey:(NSString *)storeKey {
+    [self storeResponseToMemory:response forKey:storeKey archiving:NO];
+}
+
+/**
+ 缓存response到内存,不在调用方的线程中序列化.未记录数据大小的结果先按粗略估算的cost写入,在self.ioQueue中序列化后更新为数据大小.
+ 启用共享内存层时先移除共享区域中的旧结果并暂存在本进程的内存缓存中,保证之后的读取命中,在self.ioQueue中序列化后写入共享区域
+
+ @param response 要缓存的结果
+ @param storeKey 缓存的Key
+ @param archiving 调用方是否会在self.ioQueue中序列化response并交由_didArchiveResponse:data:forKey:处理(如同时写入磁盘)
+ */
+- (void)storeResponseToMemory:(id)response forKey:(NSString *)storeKey archiving:(BOOL)archiving {
+    BOOL exact = NO;
+    NSUInteger cost = ACNetCacheEstimatedCost(response, &exact);
+    if (self.sharedArena && !(exact && self.maximumMemoryEntryCost && cost > self.maximumMemoryEntryCost)) {
+        [self.sharedArena removeDataForKey:storeKey];
+        [self.memoryCache setObject:response forKey:storeKey cost:cost];
+    } else if ([self shouldAdmitResponseForKey:storeKey cost:cost]) {
+        [self.memoryCache setObject:response forKey:storeKey cost:cost];
+        if (exact) return;
+    } else {
+        [self removeMemoryResponseForKey:storeKey];
+        return;
+    }
+    if (archiving) return;
+    dispatch_async(self.ioQueue, ^{
+        [self _didArchiveResponse:response data:[self archivedDataWithResponse:response] forKey:storeKey];
+    });
+}
+
+/**
+ 内部方法,response在self.ioQueue中序列化之后:记录数据大小并更新本进程内存缓存中的cost;启用共享内存层时将暂存的结果写入共享区域,
+ 写入成功后移除暂存的结果,此时暂存的结果已被替换或删除则移除刚写入的数据.需确保此方法在self.ioQueue中调用
+
+ @param response 结果
+ @param data 序列化的数据
+ @param storeKey 缓存的Key
+ */
+- (void)_didArchiveResponse:(id)response data:(NSData *)data forKey:(NSString *)storeKey {
+    if (data.length == 0) return;
+    ACNetCacheRecordDataLength(response, data.length);
+    NSUInteger cost = MAX(data.length, 16);
+    if (!self.sharedArena) return [self.memoryCache setCost:cost forObject:response key:storeKey];
+    if (![self.memoryCache containsObject:response forKey:storeKey]) return;
+    if ([self storeResponseToSharedMemory:response data:data forKey:storeKey]) {
+        if (![self.memoryCache removeObject:response forKey:storeKey]) [self.sharedArena removeDataForKey:storeKey];
+    } else if (self.maximumMemoryEntryCost && cost > self.maximumMemoryEntryCost) {
+        [self.memoryCache removeObject:response forKey:storeKey];
+    } else {
+        /** 共享区域写入失败,保留在本进程的内存缓存中 */
+        [self.memoryCache setCost:cost forObject:response key:storeKey];
+    }
+}
+
+/**
+ 结果是否可以写入内存:超过maximumMemoryEntryCost的不写入;替换内存中已有的结果不会挤占其他结果,直接写入;其余交由admissionPolicy判断
+
+ @param storeKey 缓存的Key
+ @param cost 结果的估算大小
+ @return 是否写入
+ */
+- (BOOL)shouldAdmitResponseForKey:(NSString *)storeKey cost:(NSUInteger)cost {
+    if (self.maximumMemoryEntryCost && cost > self.maximumMemoryEntryCost) return NO;
+    id<ACNetCacheAdmissionPolicy> policy = self.admissionPolicy;
+    if (!policy) return YES;
+    if ([self.memoryCache objectForKey:storeKey]) return YES;
+    return [policy shouldAdmitKey:storeKey cost:cost victimKey:[self.memoryCache evictionCandidateForCost:cost]];
+}
+
+/**
+ 缓存response到磁盘
+
+ @param response 要缓存的结果
+ @param storeKey 缓存的Key
+ */
+- (void)storeResponseToDisk:(id)response forKey:(NSString *)storeKey {
+    [self storeResponseToDisk:response data:nil generation:self.generation forKey:storeKey];
+}
+
+/**
+ 缓存response到磁盘
+
+ @param response 要缓存的结果
+ @param data 已序列化的数据,nil时在self.ioQueue中序列化
+ @param generation 结果所属的generation,轮到写入时已清空过缓存则丢弃
+ @param storeKey 缓存的Key
+ */
+- (void)storeResponseToDisk:(id)response data:(NSData *)data generation:(NSUInteger)generation forKey:(NSString *)storeKey {
+    if (!storeKey || !response || (data && data.length == 0)) return;
+    /** 写入完成前keyFilter可能尚未包含该Key,期间的查询不经过keyFilter */
+    atomic_fetch_add(&_pendingDiskWrites, 1);
+    dispatch_async(self.ioQueue, ^{
+        [self _storeResponseToDisk:response data:data generation:generation forKey:storeKey completion:^{
+            atomic_fetch_sub(&self->_pendingDiskWrites, 1);
+        }];
+    });
+}
+
+/**
+ 内部方法,缓存response到磁盘,内容与已缓存的相同时只更新缓存时间,序列化结果为空时不写入.在此序列化的结果同时更新其内存缓存.
+ 共享模式下先获取文件锁,同步其他进程的修改后再确定路径及比较现有文件.需确保此方法在self.ioQueue中调用
+
+ @param response 要缓存的结果
+ @param data 已序列化的数据,nil时序列化response
+ @param generation 结果所属的generation,已清空过缓存(包括其他进程清空)时丢弃
+ @param storeKey 缓存的Key
+ @param completion 写入结束的回调,在self.ioQueue中执行
+ */
+- (void)_storeResponseToDisk:(id)response data:(NSData *)data generation:(NSUInteger)generation forKey:(NSString *)storeKey completion:(dispatch_block_t)completion {
+    if (!data) {
+        data = [self archivedDataWithResponse:response];
+        [self _didArchiveResponse:response data:data forKey:storeKey];
+    }
+    [self _lockSharedState];
+    if (data.length == 0 || generation != self.generation) {
+        [self _unlockSharedState];
+        return completion();
+    }
+    NSString *filePath = [self filePathForStoreKey:storeKey];
+    BOOL created = [self _willCreateEntryAtPath:filePath forKey:storeKey];
+    if (self.contentAddressed) {
+        [self.pendingEntryWrites removeObjectForKey:filePath];
+        [self.entryDigests removeObjectForKey:storeKey];
+        [self _storeBlobData:data forKey:storeKey];
+        [self _didWriteEntryAtPath:filePath forKey:storeKey created:created];
+        [self _unlockSharedState];
+        return completion();
+    }
+    [self _storeEntryData:data atPath:filePath forKey:storeKey completion:^{
+        [self _didWriteEntryAtPath:filePath forKey:storeKey created:created];
+        completion();
+    }];
+    [self _unlockSharedState];
+}
+
+/**
+ 内部方法,直接写入缓存文件,内容未变化时只更新修改时间.需确保此方法在self.ioQueue中调用
+
+ @param data 要缓存的数据
+ @param filePath 缓存文件路径
+ @param storeKey 缓存的Key
+ @param completion 写入结束的回调,在self.ioQueue中执行
+ */
+- (void)_storeEntryData:(NSData *)data atPath:(NSString *)filePath forKey:(NSString *)storeKey completion:(dispatch_block_t)completion {
+    NSString *digest = ACNetCacheSHA256(data);
+    /** 仍有未完成的写入时,现有文件即将被替换,不能据此跳过写入 */
+    if (!self.pendingEntryWrites[filePath] && [self _entryAtPath:filePath forKey:storeKey matchesData:data digest:digest]) {
+        utimes(filePath.fileSystemRepresentation, NULL);
+        return completion();
+    }
+    NSString *oldHash = [self _blobHashAtPath:filePath];
+    [self _writeData:data toPath:filePath completion:^(BOOL success) {
+        if (success) {
+            [self.entryDigests setObject:digest forKey:storeKey];
+            if (oldHash) [self _releaseBlobWithHash:oldHash];
+        } else {
+            [self.entryDigests removeObjectForKey:storeKey];
+        }
+        completion();
+    }];
+}
+
+/**
+ 将response转换为磁盘缓存数据,开启tapeEncodingEnabled且为JSON对象时使用tape格式,否则使用NSKeyedArchiver归档
+
+ @param response 要缓存的结果
+ @return 缓存数据
+ */
+- (NSData *)archivedDataWithResponse:(id)response {
+    NSData *data = self.tapeEncodingEnabled ? [ACJSONTape dataWithJSONObject:response] : nil;
+    return data ?: [NSKeyedArchiver archivedDataWithRootObject:response];
+}
+
+/**
+ 内部方法,判断已缓存的文件内容是否与data相同.优先比较记录的SHA256,没有记录时在文件大小一致的情况下读取文件比较.
+ 需确保此方法在self.ioQueue中调用
+
+ @param filePath 缓存文件路径
+ @param storeKey 缓存的Key
+ @param data 要缓存的数据
+ @param digest data的SHA256
+ @return 是否相同
+ */
+- (BOOL)_entryAtPath:(NSString *)filePath forKey:(NSString *)storeKey matchesData:(NSData *)data digest:(NSString *)digest {
+    NSString *storedDigest = [self.entryDigests objectForKey:storeKey];
+    if (storedDigest) return [storedDigest isEqualToString:digest] && [self.fileManager fileExistsAtPath:filePath];
+    if ([[self.fileManager attributesOfItemAtPath:filePath error:NULL] fileSize] != data.length) return NO;
+    NSData *stored = [NSData dataWithContentsOfFile:filePath options:NSDataReadingMappedIfSafe error:NULL];
+    if (![stored isEqualToData:data]) return NO;
+    [self.entryDigests setObject:digest forKey:storeKey];
+    return YES;
+}
+
+#pragma mark - Fetch
+
+/**
+ 异步获取本地缓存的response,不过期
+ 
+ @param url URL
+ @param param 请求参数
+ @param completion 回调
+ */
+- (void)fetchResponseForUrl:(NSString *)url param:(NSDictionary *)param completion:(ACNetCacheFetchCompletion)completion {
+    [self fetchResponseForUrl:url param:param expires:Expire_Time_Never completion:completion];
+}
+
+/**
+ 异步获取本地缓存的response
+
+ @param url URL
+ @param param 请求参数
+ @param expire 过期时间
+ @param completion 回调
+ */
+- (void)fetchResponseForUrl:(NSString *)url param:(NSDictionary *)param expires:(Expire_Time)expire completion:(ACNetCacheFetchCompletion)completion {
+    [self fetchResponseForUrl:url param:param expires:expire  async:YES completion:completion];
+}
+
+/**
+ 获取本地缓存的response
+ 
+ @param url URL
+ @param param 请求参数
+ @param expire 过期时间
+ @param completion 回调
+ @param generator 缓存Key生成器
+ @param async 是否异步
+ */
+- (void)fetchResponseForUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(ACNetCacheKeyGenerator)generator expires:(Expire_Time)expire async:(BOOL)async completion:(ACNetCacheFetchCompletion)completion {
+    [self fetchResponseForUrl:url param:param keyGenerator:generator expires:expire async:async completionQueue:nil completion:completion];
+}
+
+/**
+ 获取本地缓存的response
+ 
+ @param url URL
+ @param param 请求参数
+ @param generator 缓存Key生成器
+ @param expire 过期时间
+ @param async 是否异步
+ @param queue 回调队列
+ @param completion 回调
+ */
+- (void)fetchResponseForUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(ACNetCacheKeyGenerator)generator expires:(Expire_Time)expire async:(BOOL)async completionQueue:(dispatch_queue_t)queue completion:(ACNetCacheFetchCompletion)completion {
+    if (!completion) return;
+    if (!url) return completion(ACNetCacheTypeNone, nil, nil);
+    NSString *storeKey = [self fetchCacheKeyWithUrl:url param:param keyGenerator:generator];
+    NSDate *memoryDate = nil;
+    __block id result = [self memoryResponseForKey:storeKey expires:expire cacheDate:&memoryDate];
+    if (result) {
+        [self recordHitForKey:storeKey];
+        return completion(ACNetCacheTypeMemroy, result, memoryDate);
+    }
+    if (![self diskCacheMayContainKey:storeKey]) {
+        if (!async) return completion(ACNetCacheTypeNone, nil, nil);
+        dispatch_async(queue ?: self.completionQueue, ^{
+            completion(ACNetCacheTypeNone, nil, nil);
+        });
+        return;
+    }
+    if (async) {
+        dispatch_async(self.ioQueue, ^{
+            [self _readResponseForKey:storeKey expires:expire completion:^(id response, NSDate *cacheDate) {
+                dispatch_async(queue ?: self.completionQueue, ^{
+                    completion(response ? ACNetCacheTypeDisk : ACNetCacheTypeNone, response, cacheDate);
+                });
+            }];
+        });
+    } else {
+        __block NSDate *date = nil;
+        dispatch_sync(self.ioQueue, ^{
+            NSDate *cacheDate = nil;
+            result = [self _diskResponseForKey:storeKey expires:expire cacheDate:&cacheDate];
+            date = cacheDate;
+        });
+        completion(result ? ACNetCacheTypeDisk : ACNetCacheTypeNone, result, date);
+    }
+}
+
+/**
+ 内部方法,读取磁盘缓存的response,需确保此方法在self.ioQueue中调用
+
+ @param storeKey 缓存的Key
+ @param expire 过期时间
+ @param cacheDate 缓存时间
+ @return 缓存的response,无缓存或已过期返回nil
+ */
+- (id)_diskResponseForKey:(NSString *)storeKey expires:(Expire_Time)expire cacheDate:(NSDate **)cacheDate {
+    [self _synchronizeSharedState];
+    NSString *filePath = [self filePathForStoreKey:storeKey];
+    ACNetCachePendingWrite *pending = self.pendingEntryWrites[filePath];
+    if (pending) {
+        if ([pending isExpiredForExpires:expire]) return nil;
+        id response = [self responseWithData:pending.data streamed:NO corrupted:NULL];
+        if (response && cacheDate) *cacheDate = pending.date;
+        if (response) [self recordHitForKey:storeKey];
+        return response;
+    }
+    if (!filePath || [self fileExpiredAtPath:filePath expires:expire]) return nil;
+    id response = [self responseAtPath:filePath length:NULL];
+    if (response && cacheDate) *cacheDate = [self fileModificationDateAtPath:filePath];
+    if (response) [self recordHitForKey:storeKey];
+    return response;
+}
+
+/**
+ 获取本地缓存的response
+ 
+ @param url URL
+ @param param 请求参数
+ @param expire 过期时间
+ @param completion 回调
+ @param async 是否异步
+ */
+- (void)fetchResponseForUrl:(NSString *)url param:(NSDictionary *)param expires:(Expire_Time)expire async:(BOOL)async completion:(ACNetCacheFetchCompletion)completion {
+    [self fetchResponseForUrl:url param:param keyGenerator:nil expires:expire async:async completion:completion];
+}
+
+#pragma mark - Batch
+
+/**
+ 生成缓存Key
+ 
+ @param url URL
+ @param param 请求参数
+ @param generator 缓存Key生成器
+ @return 缓存Key
+ */
+- (NSString *)cacheKeyForUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(ACNetCacheKeyGenerator)generator {
+    return [self fetchCacheKeyWithUrl:url param:param keyGenerator:generator];
+}
+
+/**
+ 批量获取本地缓存的response
+ 
+ @param keys 缓存Key
+ @param expire 过期时间
+ @param completion 回调
+ */
+- (void)fetchResponsesForKeys:(NSArray<NSString *> *)keys expires:(Expire_Time)expire completion:(ACNetCacheBatchFetchCompletion)completion {
+    if (!completion) return;
+    NSMutableArray<ACNetCacheResult *> *results = [NSMutableArray arrayWithCapacity:keys.count];
+    NSMutableArray<ACNetCacheResult *> *misses = [NSMutableArray array];
+    for (NSString *key in keys) {
+        ACNetCacheResult *result = [ACNetCacheResult new];
+        result.key = key;
+        NSDate *cacheDate = nil;
+        result.response = [self memoryResponseForKey:key expires:expire cacheDate:&cacheDate];
+        if (result.response) {
+            [self recordHitForKey:key];
+            result.type = ACNetCacheTypeMemroy;
+            result.cacheDate = cacheDate;
+        } else if ([self diskCacheMayContainKey:key]) {
+            [misses addObject:result];
+        }
+        [results addObject:result];
+    }
+    if (misses.count == 0) return completion(results);
+    dispatch_async(self.ioQueue, ^{
+        /** 按Key排序后依次发起读取,相同Key只读一次,各读取同时进行 */
+        [misses sortUsingComparator:^NSComparisonResult(ACNetCacheResult *obj1, ACNetCacheResult *obj2) {
+            return [obj1.key compare:obj2.key];
+        }];
+        dispatch_group_t group = dispatch_group_create();
+        ACNetCacheResult *previous = nil;
+        for (ACNetCacheResult *result in misses) {
+            if ([previous.key isEqualToString:result.key]) continue;
+            previous = result;
+            dispatch_group_enter(group);
+            [self _readResponseForKey:result.key expires:expire completion:^(id response, NSDate *cacheDate) {
+                result.response = response;
+                result.cacheDate = cacheDate;
+                if (response) result.type = ACNetCacheTypeDisk;
+                dispatch_group_leave(group);
+            }];
+        }
+        dispatch_group_notify(group, self.completionQueue, ^{
+            /** misses已按Key排序,重复的Key总在其首个结果之后 */
+            ACNetCacheResult *first = nil;
+            for (ACNetCacheResult *result in misses) {
+                if (![first.key isEqualToString:result.key]) {
+                    first = result;
+                } else {
+                    result.response = first.response;
+                    result.cacheDate = first.cacheDate;
+                    result.type = first.type;
+                }
+            }
+            completion(results);
+        });
+    });
+}
+
+/**
+ 批量获取本地缓存的response
+ 
+ @param urls URL
+ @param params 请求参数
+ @param generator 缓存Key生成器
+ @param expire 过期时间
+ @param completion 回调
+ */
+- (void)fetchResponsesForUrls:(NSArray<NSString *> *)urls params:(NSArray *)params keyGenerator:(ACNetCacheKeyGenerator)generator expires:(Expire_Time)expire completion:(ACNetCacheBatchFetchCompletion)completion {
+    NSMutableArray<NSString *> *keys = [NSMutableArray arrayWithCapacity:urls.count];
+    [urls enumerateObjectsUsingBlock:^(NSString * _Nonnull url, NSUInteger idx, BOOL * _Nonnull stop) {
+        NSDictionary *param = idx < params.count && [params[idx] isKindOfClass:NSDictionary.class] ? params[idx] : nil;
+        [keys addObject:[self fetchCacheKeyWithUrl:url param:param keyGenerator:generator]];
+    }];
+    [self fetchResponsesForKeys:keys expires:expire completion:completion];
+}
+
+/**
+ 批量缓存response
+ 
+ @param responses 缓存Key与response的对应关系
+ @param toMemory 是否缓存到内存
+ @param toDisk 是否缓存到磁盘
+ */
+- (void)storeResponses:(NSDictionary<NSString *, id> *)responses toMemory:(BOOL)toMemory toDisk:(BOOL)toDisk {
+    if ((!toMemory && !toDisk) || responses.count == 0) return;
+    responses = [responses copy];
+    [responses enumerateKeysAndObjectsUsingBlock:^(NSString * _Nonnull key, id _Nonnull response, BOOL * _Nonnull stop) {
+        [self.negativeCache removeObjectForKey:key];
+        if (toMemory) [self storeResponseToMemory:response forKey:key];
+    }];
+    if (!toDisk) return;
+    /** 每个Key单独提交,序列化及写入之间其他磁盘操作可以插入执行 */
+    for (NSString *key in [responses.allKeys sortedArrayUsingSelector:@selector(compare:)]) {
+        [self storeResponseToDisk:responses[key] forKey:key];
+    }
+}
+
+#pragma mark - Negative
+
+/**
+ 缓存失败结果(仅内存),negativeCacheEnabled为NO时忽略
+ 
+ @param error 请求error
+ @param statusCode HTTP状态码,没有则传0
+ @param url URL
+ @param param 请求参数
+ @param generator 缓存Key生成器
+ */
+- (void)storeFailure:(NSError *)error statusCode:(NSInteger)statusCode forUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(ACNetCacheKeyGenerator)generator {
+    [self storeFailure:error statusCode:statusCode forUrl:url param:param keyGenerator:generator generation:self.generation];
+}
+
+/**
+ 缓存请求得到的失败结果,请求发出后清空过缓存时丢弃
+
+ @param error 请求error
+ @param statusCode HTTP状态码,没有则传0
+ @param url URL
+ @param param 请求参数
+ @param generator 缓存Key生成器
+ @param generation 发出请求时的generation
+ */
+- (void)storeFailure:(NSError *)error statusCode:(NSInteger)statusCode forUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(ACNetCacheKeyGenerator)generator generation:(NSUInteger)generation {
+    if (!self.negativeCacheEnabled || !error || !url || self.negativeCacheExpire <= 0 || generation != self.generation) return;
+    ACNetCacheFailure *failure = [ACNetCacheFailure new];
+    failure.domain = error.domain;
+    failure.code = error.code;
+    failure.statusCode = statusCode;
+    failure.localizedDescription = error.localizedDescription;
+    NSString *storeKey = [self fetchCacheKeyWithUrl:url param:param keyGenerator:generator];
+    [self.negativeCache setObject:failure forKey:storeKey expires:self.negativeCacheExpire];
+    if (generation != self.generation) [self.negativeCache removeObjectForKey:storeKey];
+}
+
+/**
+ 获取缓存的失败结果
+ 
+ @param url URL
+ @param param 请求参数
+ @param generator 缓存Key生成器
+ @return 失败结果对应的error,无缓存或已过期返回nil
+ */
+- (NSError *)failureForUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(ACNetCacheKeyGenerator)generator {
+    if (!self.negativeCacheEnabled || !url) return nil;
+    ACNetCacheFailure *failure = [self.negativeCache objectForKey:[self fetchCacheKeyWithUrl:url param:param keyGenerator:generator]];
+    if (!failure) return nil;
+    NSMutableDictionary *userInfo = [NSMutableDictionary dictionary];
+    if (failure.localizedDescription) userInfo[NSLocalizedDescriptionKey] = failure.localizedDescription;
+    if (failure.statusCode) userInfo[ACNetCacheFailureStatusCodeKey] = @(failure.statusCode);
+    return [NSError errorWithDomain:failure.domain code:failure.code userInfo:userInfo];
+}
+
+#pragma mark - Delete
+
+/**
+ 删除本地内存缓存和磁盘缓存的response
+ 
+ @param url URL
+ @param param 请求参数
+ */
+- (void)deleteResponseForUrl:(NSString *)url param:(NSDictionary *)param {
+    [self deleteResponseForUrl:url param:param fromMemory:YES fromDisk:YES];
+}
+
+/**
+ 删除本地内存缓存和磁盘缓存的response
+ 
+ @param url URL
+ @param param 请求参数
+ @param generator 缓存Key生成器
+ */
+- (void)deleteResponseForUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(nullable ACNetCacheKeyGenerator)generator {
+    [self deleteResponseForUrl:url param:param keyGenerator:generator fromMemory:YES fromDisk:YES];
+}
+
+/**
+ 删除本地response缓存
+ 
+ @param url URL
+ @param param 请求参数
+ @param generator 缓存Key生成器
+ @param fromMemory 是否删除内存缓存
+ @param fromDisk 是否删除磁盘缓存
+ */
+- (void)deleteResponseForUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(ACNetCacheKeyGenerator)generator fromMemory:(BOOL)fromMemory fromDisk:(BOOL)fromDisk {
+    NSString *storeKey = [self fetchCacheKeyWithUrl:url  param:param keyGenerator:generator];
+    [self.negativeCache removeObjectForKey:storeKey];
+    /** 启动时读取的记录尚未合并时,磁盘中的记录在删除缓存文件时移除 */
+    if (fromMemory && fromDisk && [self.secondaryIndex removeKey:storeKey]) [self journalIndexRemovalForKeys:[NSSet setWithObject:storeKey]];
+    if (fromMemory) [self removeMemoryResponseForKey:storeKey];
+    if (fromDisk && [self diskCacheExistsForKey:storeKey expires:Expire_Time_Never]) {
+        dispatch_async(self.ioQueue, ^{
+            [self _removeEntryForKey:storeKey];
+        });
+    }
+}
+
+/**
+ 删除本地response缓存
+ 
+ @param url URL
+ @param param 请求参数
+ @param fromMemory 是否删除内存缓存
+ @param fromDisk 是否删除磁盘缓存
+ */
+- (void)deleteResponseForUrl:(NSString *)url param:(NSDictionary *)param fromMemory:(BOOL)fromMemory fromDisk:(BOOL)fromDisk {
+    [self deleteResponseForUrl:url param:param keyGenerator:nil fromMemory:fromMemory fromDisk:fromDisk];
+}
+
+/**
+ 删除所有带有该标签的缓存
+
+ @param tag 标签
+ */
+- (void)deleteResponsesWithTag:(NSString *)tag {
+    if (!tag) return;
+    [self deleteResponsesForKeys:[[self _loadedSecondaryIndex] removeKeysWithTag:tag]];
+}
+
+/**
+ 删除所有URL路径以prefix开头的缓存
+
+ @param prefix URL路径前缀
+ */
+- (void)deleteResponsesWithURLPrefix:(NSString *)prefix {
+    if (!prefix) return;
+    [self deleteResponsesForKeys:[[self _loadedSecondaryIndex] removeKeysWithPathPrefix:ACNetCacheURLPath(prefix)]];
+}
+
+/**
+ 删除一组已从二级索引移除的Key的内存缓存和磁盘缓存,内存立即删除,磁盘在self.ioQueue中删除
+
+ @param keys 缓存Key
+ */
+- (void)deleteResponsesForKeys:(NSSet<NSString *> *)keys {
+    if (keys.count == 0) return;
+    for (NSString *key in keys) {
+        [self.negativeCache removeObjectForKey:key];
+        [self removeMemoryResponseForKey:key];
+        [self.modelCache removeObjectForKey:key];
+    }
+    [self journalIndexRemovalForKeys:keys];
+    dispatch_async(self.ioQueue, ^{
+        for (NSString *key in keys) [self _removeEntryForKey:key];
+    });
+}
+
+/**
+ 删除所有缓存:generation加1,内存缓存立即替换为空,原有的在后台释放,共享内存层随之清空;
+ 磁盘目录排在已提交的磁盘操作之后改名移走,之后的读写使用新目录,原目录由后台低优先级任务删除
+ */
+- (void)deleteAllResponses {
+    [self resetMemoryCaches];
+    [self.sharedArena removeAllData];
+    dispatch_async(self.ioQueue, ^{
+        [self _lockSharedState];
+        [self _moveDiskDirectoryToTrash];
+        [self _createStreamingDirectory];
+        if (self->_sharedState) {
+            self.observedGeneration = atomic_fetch_add(&self->_sharedState->generation, 1) + 1;
+            atomic_store(&self->_observedSequence, atomic_fetch_add(&self->_sharedState->sequence, 1) + 1);
+        }
+        [self _unlockSharedState];
+    });
+}
+
+/**
+ generation加1,内存缓存立即替换为空,原有的在后台释放.可在任意线程调用
+ */
+- (void)resetMemoryCaches {
+    ACMemoryCache *memoryCache, *negativeCache;
+    NSCache *modelCache;
+    @synchronized (self) {
+        memoryCache = self.memoryCache;
+        negativeCache = self.negativeCache;
+        modelCache = self.modelCache;
+        self.invalidationDate = [NSDate date];
+        self.generation += 1;
+        [self setupMemoryCachesWithName:memoryCache.name];
+        /** 索引文件随磁盘目录移走 */
+        self.secondaryIndex = [ACNetCacheIndex new];
+    }
+    dispatch_semaphore_wait(self.hitLock, DISPATCH_TIME_FOREVER);
+    self.hitCounts = [NSMutableDictionary dictionary];
+    self.hotSetDirty = NO;
+    dispatch_semaphore_signal(self.hitLock);
+    /** 原有缓存中的对象在后台释放,不阻塞调用方 */
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_BACKGROUND, 0), ^{
+        [memoryCache removeAllObjects];
+        [negativeCache removeAllObjects];
+        [modelCache removeAllObjects];
+    });
+}
+
+/**
+ 内部方法,将磁盘缓存目录改名移入失效目录并安排删除,内容引用计数随目录一起失效.需确保此方法在self.ioQueue中调用
+ */
+- (void)_moveDiskDirectoryToTrash {
+    [self _resetDiskState];
+    if (![self.fileManager fileExistsAtPath:self.diskDirectory]) return;
+    NSString *trashDirectory = [self trashDirectory];
+    [self.fileManager createDirectoryAtPath:trashDirectory withIntermediateDirectories:YES attributes:nil error:NULL];
+    NSString *trashPath = [trashDirectory stringByAppendingPathComponent:[NSUUID UUID].UUIDString];
+    /** 同一卷内改名为O(1),失败时只能逐个删除 */
+    if (rename(self.diskDirectory.fileSystemRepresentation, trashPath.fileSystemRepresentation) != 0) {
+        [self.fileManager removeItemAtPath:self.diskDirectory error:NULL];
+        return;
+    }
+    [self emptyTrash];
+}
+
+/**
+ 内部方法,丢弃本进程记录的磁盘缓存状态,用于磁盘缓存目录被移走之后.需确保此方法在self.ioQueue中调用
+ */
+- (void)_resetDiskState {
+    self.blobRefCounts = nil;
+    self.blobRefCountsDirty = NO;
+    self.keyFilter = [[ACNetCacheKeyFilter alloc] initWithCapacity:0];
+    [self _closeKeyJournal];
+    [self _closeIndexJournal];
+    [self.shardDirectories removeAllObjects];
+    [self.pendingEntryWrites removeAllObjects];
+    self.migratingFlatEntries = NO;
+    [self.entryDigests removeAllObjects];
+}
+
+/**
+ 在后台低优先级队列删除失效目录
+ */
+- (void)emptyTrash {
+    [self emptyDirectoryInBackground:[self trashDirectory]];
+}
+
+/**
+ 在后台低优先级队列删除目录中的所有文件
+
+ @param directory 目录
+ */
+- (void)emptyDirectoryInBackground:(NSString *)directory {
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_BACKGROUND, 0), ^{
+        NSFileManager *fileManager = [NSFileManager new];
+        for (NSString *fileName in [fileManager contentsOfDirectoryAtPath:directory error:NULL]) {
+            [fileManager removeItemAtPath:[directory stringByAppendingPathComponent:fileName] error:NULL];
+        }
+    });
+}
+
+#pragma mark - Stream
+
+/**
+ 生成一个用于流式写入的临时文件路径,与磁盘缓存位于同一目录,提交时只需移动文件.
+ 临时文件目录在启动清理完成后创建,清理完成前调用时等待清理完成
+
+ @return 临时文件路径
+ */
+- (NSString *)temporaryFilePathForStreaming {
+    if (!self.streamingDirectoryReady) dispatch_sync(self.ioQueue, ^{});
+    NSString *directory = [self.diskDirectory stringByAppendingPathComponent:ACNetCacheStreamingDirectoryName];
+    return [directory stringByAppendingPathComponent:[NSUUID UUID].UUIDString];
+}
+
+/**
+ 内部方法,创建流式写入的临时文件目录,用于启动清理之后及磁盘缓存目录被移走之后.需确保此方法在self.ioQueue中调用
+ */
+- (void)_createStreamingDirectory {
+    NSString *directory = [self.diskDirectory stringByAppendingPathComponent:ACNetCacheStreamingDirectoryName];
+    [self.fileManager createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:NULL];
+}
+
+/**
+ 将流式写入完成的文件提交为url+param对应的磁盘缓存
+
+ @param filePath 文件路径
+ @param response 已解析的结果
+ @param url url
+ @param param 参数
+ @param generator 缓存key生成器
+ @return 是否提交成功
+ */
+- (BOOL)storeStreamedFileAtPath:(NSString *)filePath response:(id)response forUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(ACNetCacheKeyGenerator)generator {
+    return [self storeStreamedFileAtPath:filePath response:response forUrl:url param:param keyGenerator:generator generation:self.generation];
+}
+
+/**
+ 将流式写入完成的文件提交为磁盘缓存,请求发出后清空过缓存时不提交
+
+ @param filePath 文件路径
+ @param response 已解析的结果
+ @param url url
+ @param param 参数
+ @param generator 缓存key生成器
+ @param generation 发出请求时的generation
+ @return 是否提交成功
+ */
+- (BOOL)storeStreamedFileAtPath:(NSString *)filePath response:(id)response forUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(ACNetCacheKeyGenerator)generator generation:(NSUInteger)generation {
+    if (!filePath || !url || generation != self.generation) return NO;
+    NSString *storeKey = [self fetchCacheKeyWithUrl:url param:param keyGenerator:generator];
+    [self indexKey:storeKey url:url param:param tags:nil];
+    __block BOOL success = NO;
+    __block unsigned long long fileSize = 0;
+    dispatch_sync(self.ioQueue, ^{
+        if (generation != self.generation) return;
+        fileSize = [[self.fileManager attributesOfItemAtPath:filePath error:NULL] fileSize];
+        success = [self _storeStreamedFileAtPath:filePath forKey:storeKey];
+    });
+    if (generation != self.generation) return success;
+    /** 以文件大小作为cost,不再为此序列化整个结果 */
+    ACNetCacheRecordDataLength(response, (NSUInteger)fileSize);
+    if (response) {
+        [self storeResponseToMemory:response forKey:storeKey];
+    } else {
+        [self removeMemoryResponseForKey:storeKey];
+    }
+    return success;
+}
+
+/**
+ 内部方法,为文件打上原始数据标记、记录校验信息并移动到缓存路径,覆盖原有缓存.
+ 整个文件只在提交时读取一次计算CRC,之后的读取只比较长度.需确保此方法在self.ioQueue中调用
+
+ @param filePath 文件路径
+ @param storeKey 缓存的Key
+ @return 是否成功
+ */
+- (BOOL)_storeStreamedFileAtPath:(NSString *)filePath forKey:(NSString *)storeKey {
+    NSString *entryPath = [self filePathForStoreKey:storeKey];
+    if (setxattr(filePath.fileSystemRepresentation, ACNetCacheStreamedAttributeName, "1", 1, 0, 0) != 0) return NO;
+    NSData *data = [NSData dataWithContentsOfFile:filePath options:NSDataReadingMappedIfSafe error:NULL];
+    ACNetCacheChecksum checksum = ACNetCacheChecksumOfData(data);
+    if (!data || setxattr(filePath.fileSystemRepresentation, ACNetCacheChecksumAttributeName, &checksum, sizeof(checksum), 0, 0) != 0) return NO;
+    utimes(filePath.fileSystemRepresentation, NULL);
+    NSString *oldHash = [self _blobHashAtPath:entryPath];
+    BOOL created = [self _willCreateEntryAtPath:entryPath forKey:storeKey];
+    /** 放弃尚未改名的写入,不会在之后以旧数据覆盖 */
+    [self.pendingEntryWrites removeObjectForKey:entryPath];
+    BOOL moved = rename(filePath.fileSystemRepresentation, entryPath.fileSystemRepresentation) == 0;
+    if (created || moved) [self _didWriteEntryAtPath:entryPath forKey:storeKey created:created];
+    if (!moved) return NO;
+    [self.entryDigests removeObjectForKey:storeKey];
+    if (oldHash) [self _releaseBlobWithHash:oldHash];
+    return YES;
+}
+
+/**
+ 缓存文件是否为流式写入的原始数据
+
+ @param filePath 缓存文件路径
+ @return 是否为原始数据
+ */
+- (BOOL)isStreamedEntryAtPath:(NSString *)filePath {
+    return getxattr(filePath.fileSystemRepresentation, ACNetCacheStreamedAttributeName, NULL, 0, 0, 0) >= 0;
+}
+
+/**
+ 读取并解析缓存文件,流式写入的原始数据由streamedResponseDecoder解析,tape格式按需访问,其余数据直接解档.可在任意线程调用
+
+ @param filePath 缓存文件路径
+ @param length 缓存数据的大小(可NULL)
+ @return 缓存结果
+ */
+- (id)responseAtPath:(NSString *)filePath length:(NSUInteger *)length {
+    NSData *data = [self entryDataAtPath:filePath];
+    if (!data) return nil;
+    if (length) *length = data.length;
+    BOOL corrupted = NO;
+    id response = [self responseWithData:data streamed:[self isStreamedEntryAtPath:filePath] corrupted:&corrupted];
+    /** 只隔离归档损坏的文件(包括没有校验信息的旧版文件);流式数据或解析器不认识的格式仍保留 */
+    if (corrupted) [self quarantineFileAtPath:filePath inode:0];
+    return response;
+}
+
+/**
+ 解析缓存数据,流式写入的原始数据由streamedResponseDecoder解析,tape格式按需访问,其余数据直接解档.可在任意线程调用
+
+ @param data 缓存数据
+ @param streamed 是否为流式写入的原始数据
+ @param corrupted 归档数据是否损坏(NSKeyedUnarchiver抛出异常),可NULL;其他原因无法解析时为NO
+ @return 缓存结果,无法解析时返回nil
+ */
+- (id)responseWithData:(NSData *)data streamed:(BOOL)streamed corrupted:(BOOL *)corrupted {
+    id response = nil;
+    if (streamed) {
+        response = self.streamedResponseDecoder(data);
+    } else if ([ACJSONTape isTapeData:data]) {
+        return [ACJSONTape JSONObjectWithData:data];
+    } else {
+        /** 数据损坏时NSKeyedUnarchiver会抛出异常 */
+        @try {
+            response = [NSKeyedUnarchiver unarchiveObjectWithData:data];
+        } @catch (NSException *exception) {
+            if (corrupted) *corrupted = YES;
+            return nil;
+        }
+    }
+    ACNetCacheRecordDataLength(response, data.length);
+    return response;
+}
+
+#pragma mark - Shared Memory
+
+/**
+ 读取内存中的结果:先查共享内存层,再查本进程的内存缓存(共享模式下尚未同步其他进程的修改时跳过).
+ 所有读取都经过这里,准入策略的访问在这里记录一次.可在任意线程调用
+
+ @param storeKey 缓存的Key
+ @param expire 过期时间
+ @param cacheDate 缓存时间
+ @return 结果,未命中返回nil
+ */
+- (id)memoryResponseForKey:(NSString *)storeKey expires:(Expire_Time)expire cacheDate:(NSDate **)cacheDate {
+    [self.admissionPolicy recordAccessForKey:storeKey];
+    NSData *data = [self sharedMemoryDataForKey:storeKey expires:expire cacheDate:cacheDate];
+    if (data) {
+        /** 本进程内存缓存中只有共享区域写入失败时的结果,共享区域之后有了该Key(如其他进程写入)时已过时 */
+        [self.memoryCache removeObjectForKey:storeKey];
+        return [self responseWithData:data streamed:NO corrupted:NULL];
+    }
+    id response = [self sharedViewIsCurrent] ? [self.memoryCache objectForKey:storeKey expires:expire] : nil;
+    if (response && cacheDate) *cacheDate = [self.memoryCache updateDateForKey:storeKey];
+    return response;
+}
+
+/**
+ 读取共享内存层中未过期的数据.可在任意线程调用
+
+ @param storeKey 缓存的Key
+ @param expire 过期时间
+ @param cacheDate 缓存时间
+ @return 数据,未启用或未命中返回nil
+ */
+- (NSData *)sharedMemoryDataForKey:(NSString *)storeKey expires:(Expire_Time)expire cacheDate:(NSDate **)cacheDate {
+    ACNetCacheSharedArena *arena = self.sharedArena;
+    if (!arena || !storeKey) return nil;
+    NSTimeInterval timestamp = 0;
+    NSData *data = [arena dataForKey:storeKey timestamp:&timestamp];
+    if (!data || timestamp + expire <= [NSDate date].timeIntervalSince1970) return nil;
+    if (cacheDate) *cacheDate = [NSDate dateWithTimeIntervalSince1970:timestamp];
+    return data;
+}
+
+/**
+ 将response序列化后写入共享内存层,超过maximumMemoryEntryCost的不写入.写入失败时共享区域中不再有该Key的旧结果.可在任意线程调用
+
+ @param response 要缓存的结果
+ @param data 已序列化的数据,nil时序列化response
+ @param storeKey 缓存的Key
+ @return 是否写入,未启用时返回NO
+ */
+- (BOOL)storeResponseToSharedMemory:(id)response data:(NSData *)data forKey:(NSString *)storeKey {
+    return [self storeResponseToSharedMemory:response data:data forKey:storeKey timestamp:[NSDate date].timeIntervalSince1970];
+}
+
+/**
+ 将response序列化后写入共享内存层,写入成功时之后的模型绑定到该记录
+
+ @param response 要缓存的结果
+ @param data 已序列化的数据,nil时序列化response
+ @param storeKey 缓存的Key
+ @param timestamp 缓存时间(距1970年的秒数)
+ @return 是否写入,未启用时返回NO
+ */
+- (BOOL)storeResponseToSharedMemory:(id)response data:(NSData *)data forKey:(NSString *)storeKey timestamp:(NSTimeInterval)timestamp {
+    ACNetCacheSharedArena *arena = self.sharedArena;
+    if (!arena) return NO;
+    if (!data) data = [self archivedDataWithResponse:response];
+    ACNetCacheRecordDataLength(response, data.length);
+    if (self.maximumMemoryEntryCost && data.length > self.maximumMemoryEntryCost) {
+        [arena removeDataForKey:storeKey];
+        return NO;
+    }
+    if (![arena setData:data forKey:storeKey timestamp:timestamp]) return NO;
+    /** 已按本进程内存缓存中的同一结果解析的模型改为绑定到该记录 */
+    ACNetCacheModelEntry *entry = [self.modelCache objectForKey:storeKey];
+    @synchronized (entry) {
+        if (entry.source == response) {
+            entry.timestamp = timestamp;
+            return YES;
+        }
+    }
+    entry = [ACNetCacheModelEntry new];
+    entry.source = response;
+    entry.timestamp = timestamp;
+    [self.modelCache setObject:entry forKey:storeKey];
+    return YES;
+}
+
+/**
+ 从本进程的内存缓存及共享内存层移除结果.可在任意线程调用
+
+ @param storeKey 缓存的Key
+ */
+- (void)removeMemoryResponseForKey:(NSString *)storeKey {
+    [self.memoryCache removeObjectForKey:storeKey];
+    [self.sharedArena removeDataForKey:storeKey];
+}
+
+#pragma mark - Hot Set
+
+/**
+ 监听进入后台及退出并定期保存热点Key清单,然后在后台预加载上次保存的热点缓存
+ */
+- (void)setupHotSet {
+#if TARGET_OS_IOS
+    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(persistHotSet) name:UIApplicationDidEnterBackgroundNotification object:nil];
+    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(persistHotSetBeforeTermination) name:UIApplicationWillTerminateNotification object:nil];
+#endif
+    self.hotSetTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0));
+    dispatch_source_set_timer(self.hotSetTimer, dispatch_time(DISPATCH_TIME_NOW, 60 * NSEC_PER_SEC), 60 * NSEC_PER_SEC, 10 * NSEC_PER_SEC);
+    __weak typeof(self) weakSelf = self;
+    dispatch_source_set_event_handler(self.hotSetTimer, ^{
+        [weakSelf persistHotSet];
+    });
+    dispatch_resume(self.hotSetTimer);
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0), ^{
+        [weakSelf preloadHotSet];
+    });
+}
+
+/**
+ 记录一次命中
+
+ @param key 缓存Key
+ */
+- (void)recordHitForKey:(NSString *)key {
+    if (self.hotSetByteBudget == 0 || !key) return;
+    dispatch_semaphore_wait(self.hitLock, DISPATCH_TIME_FOREVER);
+    self.hitCounts[key] = @(self.hitCounts[key].unsignedIntegerValue + 1);
+    self.hotSetDirty = YES;
+    /** 超出一定数量后只保留热点Key,并将次数减半,使近期的命中占更大比重 */
+    if (self.hitCounts.count > MAX(self.hotSetCapacity, 1) * 4) {
+        NSArray<NSString *> *hotKeys = [self _hotKeys];
+        NSMutableDictionary<NSString *, NSNumber *> *hitCounts = [NSMutableDictionary dictionaryWithCapacity:hotKeys.count];
+        for (NSString *hotKey in hotKeys) hitCounts[hotKey] = @(MAX(self.hitCounts[hotKey].unsignedIntegerValue / 2, 1));
+        self.hitCounts = hitCounts;
+    }
+    dispatch_semaphore_signal(self.hitLock);
+}
+
+/**
+ 内部方法,按命中次数排序的热点Key,需确保持有self.hitLock
+
+ @return 热点Key
+ */
+- (NSArray<NSString *> *)_hotKeys {
+    NSArray<NSString *> *keys = [self.hitCounts keysSortedByValueUsingComparator:^NSComparisonResult(NSNumber *obj1, NSNumber *obj2) {
+        return [obj2 compare:obj1];
+    }];
+    return keys.count > self.hotSetCapacity ? [keys subarrayWithRange:NSMakeRange(0, self.hotSetCapacity)] : keys;
+}
+
+/**
+ 保存热点Key清单
+ */
+- (void)persistHotSet {
+    NSArray<NSString *> *hotKeys = [self dirtyHotKeys];
+    if (!hotKeys) return;
+    dispatch_async(self.ioQueue, ^{
+        [hotKeys writeToFile:[self metadataFilePathForName:ACNetCacheHotSetFileName] atomically:YES];
+    });
+}
+
+/**
+ 退出前在当前线程保存热点Key清单:退出时self.ioQueue中排队的任务可能来不及执行.
+ 文件为原子替换,与self.ioQueue中的保存互不影响
+ */
+- (void)persistHotSetBeforeTermination {
+    NSArray<NSString *> *hotKeys = [self dirtyHotKeys];
+    if (!hotKeys) return;
+    NSFileManager *fileManager = [NSFileManager new];
+    [fileManager createDirectoryAtPath:self.diskDirectory withIntermediateDirectories:YES attributes:nil error:NULL];
+    [hotKeys writeToFile:[self metadataPathForName:ACNetCacheHotSetFileName] atomically:YES];
+}
+
+/**
+ 取出待保存的热点Key并清除修改标记
+
+ @return 热点Key,未开启热点预加载或上次保存后没有新的命中时返回nil
+ */
+- (NSArray<NSString *> *)dirtyHotKeys {
+    if (self.hotSetByteBudget == 0) return nil;
+    dispatch_semaphore_wait(self.hitLock, DISPATCH_TIME_FOREVER);
+    NSArray<NSString *> *hotKeys = self.hotSetDirty ? [self _hotKeys] : nil;
+    self.hotSetDirty = NO;
+    dispatch_semaphore_signal(self.hitLock);
+    return hotKeys;
+}
+
+/**
+ 将上次保存的热点缓存加载到内存,总大小不超过hotSetByteBudget.
+ 直接读取文件而不经过self.ioQueue,避免阻塞启动时的其他磁盘操作
+ */
+- (void)preloadHotSet {
+    NSUInteger budget = self.hotSetByteBudget;
+    /** 共享内存层的内容在进程之间及启动之间保留,不需要预加载 */
+    if (budget == 0 || self.sharedArena) return;
+    NSArray<NSString *> *hotKeys = [NSArray arrayWithContentsOfFile:[self metadataPathForName:ACNetCacheHotSetFileName]];
+    if (hotKeys.count == 0) return;
+    /** 沿用上次的排序作为初始命中次数,使清单在多次启动之间延续 */
+    dispatch_semaphore_wait(self.hitLock, DISPATCH_TIME_FOREVER);
+    [hotKeys enumerateObjectsUsingBlock:^(NSString * _Nonnull key, NSUInteger idx, BOOL * _Nonnull stop) {
+        if ([key isKindOfClass:NSString.class] && !self.hitCounts[key]) self.hitCounts[key] = @(hotKeys.count - idx);
+    }];
+    dispatch_semaphore_signal(self.hitLock);
+    NSFileManager *fileManager = [NSFileManager new];
+    NSUInteger loaded = 0;
+    ACMemoryCache *memoryCache = self.memoryCache;
+    for (NSString *key in hotKeys) {
+        /** 预加载期间删除了所有缓存,停止加载,已加载的随原内存缓存释放 */
+        if (self.memoryCache != memoryCache) break;
+        if (![key isKindOfClass:NSString.class] || [memoryCache objectForKey:key]) continue;
+        NSString *filePath = [self diskPathForStoreKey:key];
+        NSDictionary *attributes = [fileManager attributesOfItemAtPath:filePath error:NULL];
+        if (!attributes || loaded + [self entryLengthAtPath:filePath fileSize:attributes.fileSize] > budget) continue;
+        NSUInteger length = 0;
+        id response = [self responseAtPath:filePath length:&length];
+        if (!response) continue;
+        NSUInteger cost = ACNetCacheEstimatedCost(response, NULL);
+        if (self.maximumMemoryEntryCost && cost > self.maximumMemoryEntryCost) continue;
+        if ([memoryCache addObject:response forKey:key cost:cost updateDate:attributes.fileModificationDate]) loaded += length;
+    }
+}
+
+#pragma mark - Blob
+
+/**
+ 共享模式下其他进程无法得知本进程维护的引用计数,会误删仍被引用的内容,因此不使用内容寻址
+ */
+- (BOOL)contentAddressed {
+    return _contentAddressed && !self.shared;
+}
+
+/**
+ 内部方法,以内容寻址方式缓存数据:数据按SHA256只存一份,缓存文件只记录SHA256.
+ 内容未变化时只更新缓存文件的修改时间.需确保此方法在self.ioQueue中调用
+
+ @param data 要缓存的数据
+ @param storeKey 缓存的Key
+ */
+- (void)_storeBlobData:(NSData *)data forKey:(NSString *)storeKey {
+    NSString *hash = ACNetCacheSHA256(data);
+    NSString *filePath = [self filePathForStoreKey:storeKey];
+    NSString *oldHash = [self _blobHashAtPath:filePath];
+    if ([oldHash isEqualToString:hash] && [self.fileManager fileExistsAtPath:[self blobPathForHash:hash]]) {
+        utimes(filePath.fileSystemRepresentation, NULL);
+        return;
+    }
+    NSString *blobPath = [self blobPathForHash:hash];
+    if (![self.fileManager fileExistsAtPath:blobPath] && ![self _writeData:data atomicallyToPath:blobPath]) return;
+    NSMutableDictionary<NSString *, NSNumber *> *refCounts = [self _blobRefCounts];
+    /** 先落盘标记再写缓存文件,中途崩溃时下次启动扫描重建,不会因计数落后而删除仍被引用的内容 */
+    if (![self _markBlobRefCountsDirty]) return;
+    refCounts[hash] = @(refCounts[hash].unsignedIntegerValue + 1);
+    [self _writeData:[[ACNetCacheBlobPointerPrefix stringByAppendingString:hash] dataUsingEncoding:NSUTF8StringEncoding] atomicallyToPath:filePath];
+    if (oldHash) {
+        [self _releaseBlobWithHash:oldHash];
+    } else {
+        [self _scheduleBlobRefCountsSave];
+    }
+}
+
+/**
+ 内部方法,删除缓存文件,若其指向内容则减少内容的引用计数.需确保此方法在self.ioQueue中调用
 
-+ (instancetype)sharedCache {
-    static ACNetCache *_sharedCache;
-    static dispatch_once_t onceToken;
-    dispatch_once(&onceToken, ^{
-        _sharedCache = [ACNetCache cacheWithNamespace:@"defaultCache"];
+ @param storeKey 缓存的Key
+ */
+- (void)_removeEntryForKey:(NSString *)storeKey {
+    NSString *filePath = [self filePathForStoreKey:storeKey];
+    /** 放弃尚未改名的写入,删除之后不再出现 */
+    [self.pendingEntryWrites removeObjectForKey:filePath];
+    if (![self.fileManager fileExistsAtPath:filePath]) return;
+    NSString *hash = [self _blobHashAtPath:filePath];
+    if ([self.fileManager removeItemAtPath:filePath error:nil]) [self _didRemoveEntryForKey:storeKey];
+    [self.entryDigests removeObjectForKey:storeKey];
+    if (hash) [self _releaseBlobWithHash:hash];
+}
+
+/**
+ 内部方法,减少内容的引用计数,为0时删除内容.需确保此方法在self.ioQueue中调用
+
+ @param hash 内容SHA256
+ */
+- (void)_releaseBlobWithHash:(NSString *)hash {
+    NSMutableDictionary<NSString *, NSNumber *> *refCounts = [self _blobRefCounts];
+    [self _markBlobRefCountsDirty];
+    NSUInteger count = refCounts[hash].unsignedIntegerValue;
+    if (count > 1) {
+        refCounts[hash] = @(count - 1);
+    } else {
+        [refCounts removeObjectForKey:hash];
+        [self.fileManager removeItemAtPath:[self blobPathForHash:hash] error:NULL];
+    }
+    [self _scheduleBlobRefCountsSave];
+}
+
+/**
+ 内部方法,获取缓存文件指向的内容SHA256.需确保此方法在self.ioQueue中调用
+
+ @param filePath 缓存文件路径
+ @return 内容SHA256,普通缓存文件返回nil
+ */
+- (NSString *)_blobHashAtPath:(NSString *)filePath {
+    if (!self.blobRefCounts && ![self.fileManager fileExistsAtPath:[self.diskDirectory stringByAppendingPathComponent:ACNetCacheBlobDirectoryName]]) return nil;
+    if ([[self.fileManager attributesOfItemAtPath:filePath error:NULL] fileSize] > 128) return nil;
+    return [self blobHashInData:[NSData dataWithContentsOfFile:filePath]];
+}
+
+/**
+ 解析缓存文件内容中的SHA256
+
+ @param data 缓存文件内容
+ @return 内容SHA256,普通缓存文件返回nil
+ */
+- (NSString *)blobHashInData:(NSData *)data {
+    if (data.length != ACNetCacheBlobPointerPrefix.length + CC_SHA256_DIGEST_LENGTH * 2) return nil;
+    NSString *pointer = [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
+    if (![pointer hasPrefix:ACNetCacheBlobPointerPrefix]) return nil;
+    return [pointer substringFromIndex:ACNetCacheBlobPointerPrefix.length];
+}
+
+/**
+ 读取缓存文件对应的数据,指向内容的则读取内容.可在任意线程调用
+
+ @param filePath 缓存文件路径
+ @return 数据
+ */
+- (NSData *)entryDataAtPath:(NSString *)filePath {
+    NSData *data = [self verifiedDataAtPath:filePath];
+    NSString *hash = [self blobHashInData:data];
+    if (!hash) return data;
+    return [self verifiedDataAtPath:[self blobPathForHash:hash]];
+}
+
+/**
+ 缓存文件对应数据的大小,指向内容的取内容的大小.可在任意线程调用
+
+ @param filePath 缓存文件路径
+ @param fileSize 缓存文件本身的大小
+ @return 数据大小
+ */
+- (unsigned long long)entryLengthAtPath:(NSString *)filePath fileSize:(unsigned long long)fileSize {
+    if (fileSize != ACNetCacheBlobPointerPrefix.length + CC_SHA256_DIGEST_LENGTH * 2) return fileSize;
+    NSString *hash = [self blobHashInData:[NSData dataWithContentsOfFile:filePath]];
+    if (!hash) return fileSize;
+    struct stat blobStat;
+    return stat([self blobPathForHash:hash].fileSystemRepresentation, &blobStat) == 0 ? (unsigned long long)blobStat.st_size : fileSize;
+}
+
+/**
+ 映射文件并校验,校验失败时隔离文件.可在任意线程调用
+
+ @param filePath 文件路径
+ @return 数据,文件不存在或校验失败时返回nil
+ */
+- (NSData *)verifiedDataAtPath:(NSString *)filePath {
+    int fd = open(filePath.fileSystemRepresentation, O_RDONLY);
+    if (fd < 0) return nil;
+    struct stat fileStat;
+    NSData *data = fstat(fd, &fileStat) == 0 ? ACNetCacheMapFile(fd, (size_t)fileStat.st_size) : nil;
+    ACNetCacheChecksum checksum;
+    ssize_t size = ACNetCacheReadChecksum(fd, &checksum);
+    BOOL streamed = ACNetCacheIsStreamedFile(fd);
+    close(fd);
+    if (!data || ACNetCacheDataMatchesChecksum(data, checksum, size, streamed)) return data;
+    [self quarantineFileAtPath:filePath inode:fileStat.st_ino];
+    return nil;
+}
+
+/**
+ 内容的存储路径
+
+ @param hash 内容SHA256
+ @return 存储路径
+ */
+- (NSString *)blobPathForHash:(NSString *)hash {
+    return [[self.diskDirectory stringByAppendingPathComponent:ACNetCacheBlobDirectoryName] stringByAppendingPathComponent:hash];
+}
+
+/**
+ 内部方法,内容的引用计数,首次访问时从磁盘读取.读取失败或存在未保存标记(上次保存后写过缓存文件)时扫描缓存文件重建.需确保此方法在self.ioQueue中调用
+
+ @return 引用计数
+ */
+- (NSMutableDictionary<NSString *, NSNumber *> *)_blobRefCounts {
+    if (self.blobRefCounts) return self.blobRefCounts;
+    NSString *blobDirectory = [self.diskDirectory stringByAppendingPathComponent:ACNetCacheBlobDirectoryName];
+    [self.fileManager createDirectoryAtPath:blobDirectory withIntermediateDirectories:YES attributes:nil error:NULL];
+    BOOL dirty = [self.fileManager fileExistsAtPath:[blobDirectory stringByAppendingPathComponent:ACNetCacheBlobRefCountDirtyFileName]];
+    NSDictionary *saved = dirty ? nil : [NSDictionary dictionaryWithContentsOfFile:[blobDirectory stringByAppendingPathComponent:ACNetCacheBlobRefCountFileName]];
+    if (saved) {
+        self.blobRefCounts = [saved mutableCopy];
+        return self.blobRefCounts;
+    }
+    self.blobRefCounts = [NSMutableDictionary dictionary];
+    self.blobRefCountsDirty = dirty;
+    [self _enumerateEntriesUsingBlock:^(NSString *key, NSString *filePath) {
+        NSString *hash = [self _blobHashAtPath:filePath];
+        if (hash) self.blobRefCounts[hash] = @(self.blobRefCounts[hash].unsignedIntegerValue + 1);
+    }];
+    if (dirty) [self _scheduleBlobRefCountsSave];
+    return self.blobRefCounts;
+}
+
+/**
+ 内部方法,引用计数即将与保存的不一致时创建未保存标记,保存后删除.需确保此方法在self.ioQueue中调用
+
+ @return 标记是否存在
+ */
+- (BOOL)_markBlobRefCountsDirty {
+    if (self.blobRefCountsDirty) return YES;
+    NSString *markPath = [[self.diskDirectory stringByAppendingPathComponent:ACNetCacheBlobDirectoryName] stringByAppendingPathComponent:ACNetCacheBlobRefCountDirtyFileName];
+    int fd = open(markPath.fileSystemRepresentation, O_WRONLY | O_CREAT, 0644);
+    if (fd < 0) return NO;
+    fsync(fd);
+    close(fd);
+    self.blobRefCountsDirty = YES;
+    return YES;
+}
+
+/**
+ 内部方法,合并一段时间内的引用计数变化后再保存,保存成功后删除未保存标记.需确保此方法在self.ioQueue中调用
+ */
+- (void)_scheduleBlobRefCountsSave {
+    if (self.blobRefCountsSaveScheduled) return;
+    self.blobRefCountsSaveScheduled = YES;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(NSEC_PER_SEC)), self.ioQueue, ^{
+        self.blobRefCountsSaveScheduled = NO;
+        if (!self.blobRefCounts) return;
+        NSString *blobDirectory = [self.diskDirectory stringByAppendingPathComponent:ACNetCacheBlobDirectoryName];
+        if (![self.blobRefCounts writeToFile:[blobDirectory stringByAppendingPathComponent:ACNetCacheBlobRefCountFileName] atomically:YES]) return;
+        unlink([blobDirectory stringByAppendingPathComponent:ACNetCacheBlobRefCountDirtyFileName].fileSystemRepresentation);
+        self.blobRefCountsDirty = NO;
     });
-    return _sharedCache;
 }
 
-#pragma mark - Constructor
+#pragma mark - Dispatch IO
 
-- (instancetype)initWithNamespace:(NSString *)ns directiory:(NSString *)directory keyGenerator:(ACNetCacheKeyGenerator)keyGenerator {
-    if (self = [super init]) {
-        _ioQueue = dispatch_queue_create("com.acnetworking.netcache", DISPATCH_QUEUE_SERIAL);
-        NSString *fullNamespace = [@"com.acnetworking.netcache." stringByAppendingString:ns];
-        if (directory) {
-            _diskDirectory = [directory stringByAppendingPathComponent:fullNamespace];
-        } else {
-            _diskDirectory = [self makeDiskCachePath:fullNamespace];
+/**
+ 内部方法,读取Key的磁盘缓存,不占用self.ioQueue:在self.ioQueue中检查过期并打开文件,之后由dispatch_io分块读取,
+ 读取及解析在并发队列中进行,多个读取可同时进行.文件在打开后被替换或删除不影响本次读取;有尚未改名生效的写入时直接解析其数据.
+ 需确保此方法在self.ioQueue中调用
+
+ @param storeKey 缓存的Key
+ @param expire 过期时间
+ @param completion 回调,在并发队列中执行,无缓存或已过期时response为nil
+ */
+- (void)_readResponseForKey:(NSString *)storeKey expires:(Expire_Time)expire completion:(void (^)(id response, NSDate *cacheDate))completion {
+    [self _synchronizeSharedState];
+    NSString *filePath = [self filePathForStoreKey:storeKey];
+    ACNetCachePendingWrite *pending = self.pendingEntryWrites[filePath];
+    if (pending) {
+        if ([pending isExpiredForExpires:expire]) return completion(nil, nil);
+        return dispatch_async(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+            id response = [self responseWithData:pending.data streamed:NO corrupted:NULL];
+            if (response) [self recordHitForKey:storeKey];
+            completion(response, pending.date);
+        });
+    }
+    if ([self fileExpiredAtPath:filePath expires:expire]) return completion(nil, nil);
+    int fd = open(filePath.fileSystemRepresentation, O_RDONLY);
+    struct stat fileStat;
+    if (fd < 0 || fstat(fd, &fileStat) != 0) {
+        if (fd >= 0) close(fd);
+        return completion(nil, nil);
+    }
+    NSDate *cacheDate = [NSDate dateWithTimeIntervalSince1970:fileStat.st_mtimespec.tv_sec + fileStat.st_mtimespec.tv_nsec / (double)NSEC_PER_SEC];
+    BOOL streamed = ACNetCacheIsStreamedFile(fd);
+    [self readVerifiedFileDescriptor:fd path:filePath completion:^(NSData *data) {
+        void (^decode)(NSData *) = ^(NSData *entryData) {
+            BOOL corrupted = NO;
+            id response = entryData ? [self responseWithData:entryData streamed:streamed corrupted:&corrupted] : nil;
+            if (corrupted) [self quarantineFileAtPath:filePath inode:fileStat.st_ino];
+            if (response) [self recordHitForKey:storeKey];
+            completion(response, cacheDate);
+        };
+        NSString *hash = [self blobHashInData:data];
+        if (!hash) return decode(data);
+        NSString *blobPath = [self blobPathForHash:hash];
+        int blobFd = open(blobPath.fileSystemRepresentation, O_RDONLY);
+        if (blobFd < 0) return decode(nil);
+        [self readVerifiedFileDescriptor:blobFd path:blobPath completion:decode];
+    }];
+}
+
+/**
+ 以dispatch_io读取整个文件并校验,校验失败时隔离文件.可在任意线程调用
+
+ @param fd 文件描述符,读取结束后关闭
+ @param filePath 文件路径,用于隔离
+ @param completion 回调,在并发队列中执行,读取或校验失败时data为nil
+ */
+- (void)readVerifiedFileDescriptor:(int)fd path:(NSString *)filePath completion:(void (^)(NSData *data))completion {
+    struct stat fileStat;
+    ACNetCacheChecksum checksum;
+    ino_t inode = fstat(fd, &fileStat) == 0 ? fileStat.st_ino : 0;
+    ssize_t size = ACNetCacheReadChecksum(fd, &checksum);
+    BOOL streamed = ACNetCacheIsStreamedFile(fd);
+    [self readFileDescriptor:fd completion:^(NSData *data) {
+        if (data && !ACNetCacheDataMatchesChecksum(data, checksum, size, streamed)) {
+            [self quarantineFileAtPath:filePath inode:inode];
+            data = nil;
         }
-        _memoryCache = [[ACMemoryCache alloc] init];
-        _memoryCache.name = fullNamespace;
-        if (keyGenerator) _keyGenerator = keyGenerator;
-        dispatch_sync(_ioQueue, ^{
-            self.fileManager = [NSFileManager new];
+        completion(data);
+    }];
+}
+
+/**
+ 以dispatch_io读取整个文件并关闭,数据按64KB~1MB分块到达,以dispatch_data拼接,不复制.可在任意线程调用
+
+ @param fd 文件描述符,读取结束后关闭
+ @param completion 回调,在并发队列中执行,读取失败时data为nil
+ */
+- (void)readFileDescriptor:(int)fd completion:(void (^)(NSData *data))completion {
+    dispatch_queue_t queue = dispatch_get_global_queue(QOS_CLASS_UTILITY, 0);
+    dispatch_io_t channel = dispatch_io_create(DISPATCH_IO_RANDOM, fd, queue, ^(int error) {
+        close(fd);
+    });
+    if (!channel) {
+        close(fd);
+        return dispatch_async(queue, ^{
+            completion(nil);
         });
     }
-    return self;
+    dispatch_io_set_low_water(channel, 64 * 1024);
+    dispatch_io_set_high_water(channel, 1024 * 1024);
+    __block dispatch_data_t content = dispatch_data_empty;
+    dispatch_io_read(channel, 0, SIZE_MAX, queue, ^(bool done, dispatch_data_t data, int error) {
+        if (data) content = dispatch_data_create_concat(content, data);
+        if (!done) return;
+        dispatch_io_close(channel, 0);
+        /** dispatch_data_t即NSData,不连续时在首次访问bytes时合并 */
+        completion(error ? nil : (NSData *)content);
+    });
 }
 
-+ (instancetype)cacheWithNamespace:(NSString *)ns {
-    return [self cacheWithNamespace:ns directiory:nil];
+/**
+ 内部方法,以dispatch_io将数据写入临时文件,记录校验信息后回到self.ioQueue改名为filePath,替换原有文件.
+ 写入期间self.ioQueue继续执行其他磁盘操作,该路径的读取返回写入的数据;改名前该路径被删除、再次写入或缓存目录被移走时放弃本次写入,不会以旧数据覆盖.
+ 需确保此方法在self.ioQueue中调用
+
+ @param data 数据
+ @param filePath 文件路径
+ @param completion 回调,在self.ioQueue中执行
+ */
+- (void)_writeData:(NSData *)data toPath:(NSString *)filePath completion:(void (^)(BOOL success))completion {
+    NSString *temporaryPath = [self temporaryFilePathForStreaming];
+    int fd = open(temporaryPath.fileSystemRepresentation, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return completion(NO);
+    /** 校验信息在改名前写入,与数据一起生效 */
+    ACNetCacheChecksum checksum = ACNetCacheChecksumOfData(data);
+    /** 没有校验信息的文件会被当作旧版文件跳过校验,记录失败时不写入 */
+    if (fsetxattr(fd, ACNetCacheChecksumAttributeName, &checksum, sizeof(checksum), 0, 0) != 0) {
+        close(fd);
+        unlink(temporaryPath.fileSystemRepresentation);
+        return completion(NO);
+    }
+    dispatch_io_t channel = dispatch_io_create(DISPATCH_IO_RANDOM, fd, self.ioWriteQueue, ^(int error) {
+        close(fd);
+    });
+    if (!channel) {
+        close(fd);
+        unlink(temporaryPath.fileSystemRepresentation);
+        return completion(NO);
+    }
+    dispatch_data_t content = dispatch_data_create(data.bytes, data.length, self.ioWriteQueue, ^{
+        (void)data;
+    });
+    ACNetCachePendingWrite *pending = [ACNetCachePendingWrite new];
+    pending.data = data;
+    pending.date = [NSDate date];
+    self.pendingEntryWrites[filePath] = pending;
+    dispatch_io_write(channel, 0, content, self.ioWriteQueue, ^(bool done, dispatch_data_t remaining, int error) {
+        if (!done) return;
+        dispatch_io_close(channel, 0);
+        dispatch_async(self.ioQueue, ^{
+            /** 共享模式下其他进程在写入期间清空过缓存时,同步后pendingEntryWrites已清空 */
+            [self _lockSharedState];
+            BOOL current = self.pendingEntryWrites[filePath] == pending;
+            if (current) [self.pendingEntryWrites removeObjectForKey:filePath];
+            BOOL success = current && error == 0 && rename(temporaryPath.fileSystemRepresentation, filePath.fileSystemRepresentation) == 0;
+            if (!success) unlink(temporaryPath.fileSystemRepresentation);
+            completion(success);
+            [self _unlockSharedState];
+        });
+    });
 }
 
-+ (instancetype)cacheWithNamespace:(NSString *)ns directiory:(nullable NSString *)directory {
-    return [self cacheWithNamespace:ns directiory:directory keyGenerator:nil];
+/**
+ 内部方法,将数据写入临时文件,记录校验信息后改名为filePath,替换原有文件.需确保此方法在self.ioQueue中调用
+
+ @param data 数据
+ @param filePath 文件路径
+ @return 是否成功
+ */
+- (BOOL)_writeData:(NSData *)data atomicallyToPath:(NSString *)filePath {
+    NSString *temporaryPath = [self temporaryFilePathForStreaming];
+    int fd = open(temporaryPath.fileSystemRepresentation, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return NO;
+    ACNetCacheChecksum checksum = ACNetCacheChecksumOfData(data);
+    const uint8_t *bytes = data.bytes;
+    size_t written = 0;
+    while (written < data.length) {
+        ssize_t result = write(fd, bytes + written, data.length - written);
+        if (result < 0 && errno == EINTR) continue;
+        if (result <= 0) break;
+        written += (size_t)result;
+    }
+    BOOL success = written == data.length && fsetxattr(fd, ACNetCacheChecksumAttributeName, &checksum, sizeof(checksum), 0, 0) == 0;
+    close(fd);
+    success = success && rename(temporaryPath.fileSystemRepresentation, filePath.fileSystemRepresentation) == 0;
+    if (!success) unlink(temporaryPath.fileSystemRepresentation);
+    return success;
 }
 
-+ (instancetype)cacheWithNamespace:(NSString *)ns directiory:(nullable NSString *)directory keyGenerator:(nullable ACNetCacheKeyGenerator)keyGenerator {
-    return [[self alloc] initWithNamespace:ns directiory:directory keyGenerator:keyGenerator];
+#pragma mark - Quarantine
+
+/**
+ 隔离校验或解析失败的缓存文件:在self.ioQueue中移入隔离目录,从keyFilter中移除,由后台低优先级任务删除.
+ 文件在发现损坏后已被替换(inode不同)时不处理.可在任意线程调用
+
+ @param filePath 文件路径
+ @param inode 发现损坏时文件的inode,为0时取当前的
+ */
+- (void)quarantineFileAtPath:(NSString *)filePath inode:(ino_t)inode {
+    if (!filePath) return;
+    struct stat fileStat;
+    if (inode == 0 && lstat(filePath.fileSystemRepresentation, &fileStat) == 0) inode = fileStat.st_ino;
+    dispatch_async(self.ioQueue, ^{
+        struct stat currentStat;
+        if (lstat(filePath.fileSystemRepresentation, &currentStat) != 0 || currentStat.st_ino != inode) return;
+        NSString *directory = [self metadataFilePathForName:ACNetCacheQuarantineDirectoryName];
+        [self.fileManager createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:NULL];
+        NSString *quarantinePath = [directory stringByAppendingPathComponent:[NSUUID UUID].UUIDString];
+        if (rename(filePath.fileSystemRepresentation, quarantinePath.fileSystemRepresentation) != 0) unlink(filePath.fileSystemRepresentation);
+        NSString *blobDirectory = [self.diskDirectory stringByAppendingPathComponent:ACNetCacheBlobDirectoryName];
+        if (![filePath hasPrefix:blobDirectory]) {
+            NSString *storeKey = filePath.lastPathComponent;
+            [self.entryDigests removeObjectForKey:storeKey];
+            [self _didRemoveEntryForKey:storeKey];
+        }
+        [self emptyDirectoryInBackground:directory];
+    });
 }
 
-- (NSString *)makeDiskCachePath:(NSString*)fullNamespace {
-    NSArray<NSString *> *paths = NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES);
-    return [paths[0] stringByAppendingPathComponent:fullNamespace];
+#pragma mark - Key Filter
+
+/**
+ 在self.ioQueue中恢复或重建keyFilter,并在进入后台及退出时写入检查点
+ */
+- (void)setupKeyFilter {
+#if TARGET_OS_IOS
+    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(checkpointKeyFilter) name:UIApplicationDidEnterBackgroundNotification object:nil];
+    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(checkpointKeyFilter) name:UIApplicationWillTerminateNotification object:nil];
+#endif
+    dispatch_async(self.ioQueue, ^{
+        [self _loadKeyFilter];
+    });
 }
 
-#pragma mark - Check
+/**
+ 磁盘缓存中是否可能有该Key.keyFilter尚未就绪、有未执行的磁盘写入或尚未同步其他进程的修改时返回YES,由调用方读取磁盘确认;
+ 返回NO时一定没有,无需进入self.ioQueue.可在任意线程调用
+
+ @param key Key
+ @return 是否可能有
+ */
+- (BOOL)diskCacheMayContainKey:(NSString *)key {
+    if (!key) return NO;
+    ACNetCacheKeyFilter *filter = self.keyFilter;
+    if (!filter || atomic_load(&_pendingDiskWrites) > 0 || ![self sharedViewIsCurrent]) return YES;
+    return [filter mayContainKey:key];
+}
 
 /**
- 检查内存或磁盘缓存中是否有缓存的response
- 
- @param url URL
- @param param 请求参数
- @return 是否有缓存
+ 写入keyFilter的检查点并清空变更日志,变更日志为空时不处理
  */
-- (BOOL)cacheExistsForUrl:(NSString *)url param:(NSDictionary *)param {
-    return [self cacheExistsForUrl:url param:param keyGenerator:nil];
+- (void)checkpointKeyFilter {
+    dispatch_async(self.ioQueue, ^{
+        if (!self.keyFilter || (self.keyJournalDescriptor >= 0 && self.keyJournalRecordCount == 0)) return;
+        [self _checkpointKeyFilter];
+    });
 }
 
 /**
- 检查内存或磁盘缓存中是否有缓存的response
- 
- @param url URL
- @param param 请求参数
- @param expire 过期时间
- @return 是否有缓存
+ 内部方法,恢复keyFilter,检查点或变更日志不可用时扫描目录重建.需确保此方法在self.ioQueue中调用
  */
-- (BOOL)cacheExistsForUrl:(NSString *)url param:(NSDictionary *)param expires:(Expire_Time)expire {
-    return [self cacheExistsForUrl:url param:param expires:expire keyGenerator:nil];
+- (void)_loadKeyFilter {
+    [self _lockSharedState];
+    if (![self _loadKeyFilterCheckpointInvalidating:NO]) [self _rebuildKeyFilter];
+    [self _unlockSharedState];
 }
 
 /**
- 检查内存或磁盘缓存中是否有缓存的response
- 
- @param url URL
- @param param 请求参数
- @param generator 缓存key生成器
- @return 是否有缓存
+ 内部方法,读取检查点并重放代数一致的变更日志,日志在第一条损坏的记录处截断.需确保此方法在self.ioQueue中持有文件锁时调用
+
+ @param invalidating 是否使日志中的Key在内存中的结果失效
+ @return 检查点及变更日志是否可用
  */
-- (BOOL)cacheExistsForUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(ACNetCacheKeyGenerator)generator {
-    return [self cacheExistsForUrl:url param:param expires:Expire_Time_Never keyGenerator:generator];
+- (BOOL)_loadKeyFilterCheckpointInvalidating:(BOOL)invalidating {
+    [self _closeKeyJournal];
+    NSData *checkpoint = [NSData dataWithContentsOfFile:[self metadataPathForName:ACNetCacheKeyFilterFileName]];
+    ACNetCacheKeyFilter *filter = nil;
+    uint64_t generation = 0, journalGeneration = 0;
+    if (checkpoint.length > sizeof(generation)) {
+        memcpy(&generation, checkpoint.bytes, sizeof(generation));
+        filter = [[ACNetCacheKeyFilter alloc] initWithData:[checkpoint subdataWithRange:NSMakeRange(sizeof(generation), checkpoint.length - sizeof(generation))]];
+    }
+    if (!filter) return NO;
+    int fd = open([self metadataPathForName:ACNetCacheKeyJournalFileName].fileSystemRepresentation, O_RDWR | O_APPEND);
+    /** 日志缺失或属于其他检查点,检查点之后的变更无从得知 */
+    if (fd < 0 || pread(fd, &journalGeneration, sizeof(journalGeneration), 0) != sizeof(journalGeneration) || journalGeneration != generation) {
+        if (fd >= 0) close(fd);
+        return NO;
+    }
+    self.keyJournalDescriptor = fd;
+    self.keyJournalGeneration = generation;
+    self.keyJournalOffset = sizeof(journalGeneration);
+    /** 截掉未写完的记录,之后的记录追加在有效记录之后 */
+    if (![self _replayKeyJournalIntoFilter:filter invalidating:invalidating] && ftruncate(fd, self.keyJournalOffset) != 0) {
+        [self _closeKeyJournal];
+        return NO;
+    }
+    self.keyFilter = filter;
+    if (self.keyJournalRecordCount >= ACNetCacheKeyJournalCheckpointInterval) [self _checkpointKeyFilter];
+    return YES;
 }
 
 /**
- 检查内存或磁盘缓存中是否有缓存的response
- 
- @param url URL
- @param param 请求参数
- @param expire 过期时间
- @param generator 缓存key生成器
- @return 是否有缓存
+ 内部方法,从keyJournalOffset读取变更日志到末尾并应用到filter,遇到损坏的记录时停止.需确保此方法在self.ioQueue中调用
+
+ @param filter 过滤器
+ @param invalidating 是否使日志中的Key在内存中的结果失效(记录来自其他进程)
+ @return 是否读到末尾,NO表示末尾有损坏或未写完的记录
  */
-- (BOOL)cacheExistsForUrl:(NSString *)url param:(NSDictionary *)param expires:(Expire_Time)expire keyGenerator:(ACNetCacheKeyGenerator)generator {
-    return [self memoryCacheExistsForUrl:url param:param keyGenerator:generator expires:expire] || [self diskCacheExistsForUrl:url param:param keyGenerator:generator expires:expire];
+- (BOOL)_replayKeyJournalIntoFilter:(ACNetCacheKeyFilter *)filter invalidating:(BOOL)invalidating {
+    int fd = self.keyJournalDescriptor;
+    struct stat fileStat;
+    if (fd < 0 || fstat(fd, &fileStat) != 0) return NO;
+    off_t offset = self.keyJournalOffset;
+    if (fileStat.st_size <= offset) return fileStat.st_size == offset;
+    NSMutableData *journal = [NSMutableData dataWithLength:(NSUInteger)(fileStat.st_size - offset)];
+    if (pread(fd, journal.mutableBytes, journal.length, offset) != (ssize_t)journal.length) return NO;
+    const uint8_t *bytes = journal.bytes;
+    size_t position = 0;
+    while (position + 3 <= journal.length) {
+        uint8_t op = bytes[position];
+        uint16_t length;
+        memcpy(&length, bytes + position + 1, sizeof(length));
+        size_t recordLength = 3 + length + sizeof(uint32_t);
+        if (position + recordLength > journal.length) break;
+        uint32_t crc;
+        memcpy(&crc, bytes + position + 3 + length, sizeof(crc));
+        if (crc != ACNetCacheCRC32C(bytes + position, 3 + length)) break;
+        NSString *key = [[NSString alloc] initWithBytes:bytes + position + 3 length:length encoding:NSUTF8StringEncoding];
+        if (!key || op < ACNetCacheKeyJournalAdd || op > ACNetCacheKeyJournalUpdate) break;
+        if (op == ACNetCacheKeyJournalAdd) {
+            [filter addKey:key];
+        } else if (op == ACNetCacheKeyJournalRemove) {
+            [filter removeKey:key];
+        }
+        if (invalidating) {
+            [self.memoryCache removeObjectForKey:key];
+            [self.modelCache removeObjectForKey:key];
+            [self.entryDigests removeObjectForKey:key];
+        }
+        position += recordLength;
+        self.keyJournalRecordCount++;
+    }
+    self.keyJournalOffset = offset + (off_t)position;
+    return position == journal.length;
 }
 
 /**
- 检查内存缓存中是否存在对应的response缓存
- 
- @param url URL
- @param param 请求参数
- @return 是否有缓存
+ 内部方法,代数加1,原子写入检查点及只有代数的新变更日志,并打开日志用于追加.需确保此方法在self.ioQueue中调用
  */
-- (BOOL)memoryCacheExistsForUrl:(NSString *)url param:(NSDictionary *)param {
-    return [self memoryCacheExistsForUrl:url param:param keyGenerator:nil];
+- (void)_checkpointKeyFilter {
+    [self _lockSharedState];
+    [self _closeKeyJournal];
+    uint64_t generation = self.keyJournalGeneration + 1;
+    NSMutableData *checkpoint = [NSMutableData dataWithBytes:&generation length:sizeof(generation)];
+    [checkpoint appendData:[self.keyFilter dataRepresentation]];
+    NSString *journalPath = [self metadataFilePathForName:ACNetCacheKeyJournalFileName];
+    /** 先写日志:检查点写入失败时,旧检查点与新日志代数不一致,下次启动重建 */
+    if ([self _writeData:[NSData dataWithBytes:&generation length:sizeof(generation)] atomicallyToPath:journalPath] &&
+        [self _writeData:checkpoint atomicallyToPath:[self metadataFilePathForName:ACNetCacheKeyFilterFileName]]) {
+        int fd = open(journalPath.fileSystemRepresentation, O_RDWR | O_APPEND);
+        if (fd >= 0) {
+            self.keyJournalGeneration = generation;
+            self.keyJournalDescriptor = fd;
+            self.keyJournalOffset = sizeof(generation);
+        }
+    }
+    [self _unlockSharedState];
 }
 
 /**
- 检查内存缓存中是否存在对应的response缓存
- 
- @param url URL
- @param param 请求参数
- @param generator 缓存Key生成器
- @return 是否有缓存
+ 内部方法,关闭变更日志,之后的变更在写入检查点前不记录.需确保此方法在self.ioQueue中调用
  */
-- (BOOL)memoryCacheExistsForUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(ACNetCacheKeyGenerator)generator {
-    return [self memoryCacheExistsForKey:[self fetchCacheKeyWithUrl:url param:param keyGenerator:generator]];
+- (void)_closeKeyJournal {
+    if (self.keyJournalDescriptor >= 0) close(self.keyJournalDescriptor);
+    self.keyJournalDescriptor = -1;
+    self.keyJournalRecordCount = 0;
+    self.keyJournalOffset = 0;
 }
 
 /**
- 检查内存缓存中是否存在对应的response缓存
- 
- @param url URL
- @param param 请求参数
- @param expire 过期时间
- @return 是否有缓存
+ 内部方法,在变更日志中追加一条记录,日志未打开时先写入检查点,记录数达到上限时写入新的检查点.
+ 共享模式下在文件锁内追加并增加修改序号.需确保此方法在self.ioQueue中调用,且在修改keyFilter之前调用
+
+ @param op 操作
+ @param storeKey 缓存的Key
  */
-- (BOOL)memoryCacheExistsForUrl:(NSString *)url param:(NSDictionary *)param expires:(Expire_Time)expire {
-    return [self memoryCacheExistsForUrl:url param:param keyGenerator:nil expires:expire];
+- (void)_appendKeyJournalRecord:(uint8_t)op forKey:(NSString *)storeKey {
+    [self _lockSharedState];
+    if (self.keyJournalDescriptor < 0 || self.keyJournalRecordCount >= ACNetCacheKeyJournalCheckpointInterval) [self _checkpointKeyFilter];
+    NSData *keyData = [storeKey dataUsingEncoding:NSUTF8StringEncoding];
+    if (self.keyJournalDescriptor < 0 || keyData.length > UINT16_MAX) {
+        [self _discardKeyJournal];
+        return [self _unlockSharedState];
+    }
+    uint16_t length = (uint16_t)keyData.length;
+    NSMutableData *record = [NSMutableData dataWithBytes:&op length:1];
+    [record appendBytes:&length length:sizeof(length)];
+    [record appendData:keyData];
+    uint32_t crc = ACNetCacheCRC32C(record.bytes, record.length);
+    [record appendBytes:&crc length:sizeof(crc)];
+    if (write(self.keyJournalDescriptor, record.bytes, record.length) != (ssize_t)record.length) {
+        [self _discardKeyJournal];
+        return [self _unlockSharedState];
+    }
+    self.keyJournalOffset += record.length;
+    self.keyJournalRecordCount++;
+    if (_sharedState) atomic_store(&_observedSequence, atomic_fetch_add(&_sharedState->sequence, 1) + 1);
+    [self _unlockSharedState];
 }
 
 /**
- 检查内存缓存中是否存在对应的response缓存
- 
- @param url URL
- @param param 请求参数
- @param expire 过期时间
- @param generator 缓存Key生成器
- @return 是否有缓存
+ 内部方法,遍历缓存文件重建keyFilter,容量为缓存文件数的2倍,并写入检查点.共享模式下全程持有文件锁,
+ 期间其他进程的修改不会遗漏.需确保此方法在self.ioQueue中调用
+ */
+- (void)_rebuildKeyFilter {
+    [self _lockSharedState];
+    NSMutableArray<NSString *> *keys = [NSMutableArray array];
+    [self _enumerateEntriesUsingBlock:^(NSString *key, NSString *filePath) {
+        [keys addObject:key];
+    }];
+    ACNetCacheKeyFilter *filter = [[ACNetCacheKeyFilter alloc] initWithCapacity:keys.count * 2];
+    for (NSString *key in keys) [filter addKey:key];
+    self.keyFilter = filter;
+    [self _checkpointKeyFilter];
+    [self _unlockSharedState];
+}
+
+/**
+ 内部方法,即将在filePath写入缓存文件时调用:文件不存在则先加入keyFilter,保证文件存在时keyFilter一定包含其Key.
+ 需确保此方法在self.ioQueue中调用
+
+ @param filePath 缓存文件路径
+ @param storeKey 缓存的Key
+ @return 是否新加入
+ */
+- (BOOL)_willCreateEntryAtPath:(NSString *)filePath forKey:(NSString *)storeKey {
+    if (!self.keyFilter || [self.fileManager fileExistsAtPath:filePath]) return NO;
+    if (self.keyFilter.count >= self.keyFilter.capacity) [self _rebuildKeyFilter];
+    [self _appendKeyJournalRecord:ACNetCacheKeyJournalAdd forKey:storeKey];
+    [self.keyFilter addKey:storeKey];
+    return YES;
+}
+
+/**
+ 内部方法,写入结束后调用:新建的文件写入失败则从keyFilter移除,没有更新的写入时一并移出二级索引;共享模式下覆盖已有文件时记入变更日志,
+ 使其他进程内存中的结果失效.需确保此方法在self.ioQueue中调用
+
+ @param filePath 缓存文件路径
+ @param storeKey 缓存的Key
+ @param created 是否为新建(_willCreateEntryAtPath:forKey:的返回值)
+ */
+- (void)_didWriteEntryAtPath:(NSString *)filePath forKey:(NSString *)storeKey created:(BOOL)created {
+    if (created) {
+        if ([self.fileManager fileExistsAtPath:filePath]) return;
+        if (!self.pendingEntryWrites[filePath]) return [self _didRemoveEntryForKey:storeKey];
+        /** 被更新的写入取代,该写入即将创建文件:只撤销本次加入keyFilter的计数,保留二级索引 */
+        if (!self.keyFilter) return;
+        [self _appendKeyJournalRecord:ACNetCacheKeyJournalRemove forKey:storeKey];
+        [self.keyFilter removeKey:storeKey];
+    } else if (self.shared && self.keyFilter) {
+        [self _appendKeyJournalRecord:ACNetCacheKeyJournalUpdate forKey:storeKey];
+    }
+}
+
+/**
+ 内部方法,缓存文件删除后从keyFilter移除.需确保此方法在self.ioQueue中调用
+
+ @param storeKey 缓存的Key
+ */
+- (void)_didRemoveEntryForKey:(NSString *)storeKey {
+    if ([self.secondaryIndex removeKey:storeKey]) [self _appendIndexJournalRecords:ACNetCacheIndexJournalRemovals([NSSet setWithObject:storeKey]) count:1];
+    if (!self.keyFilter) return;
+    [self _appendKeyJournalRecord:ACNetCacheKeyJournalRemove forKey:storeKey];
+    [self.keyFilter removeKey:storeKey];
+}
+
+#pragma mark - Shared
+
+/**
+ 创建或打开共享状态文件并映射,失败时保持非共享模式
+ */
+- (void)setupSharedState {
+    NSString *filePath = [self.diskDirectory stringByAppendingString:ACNetCacheSharedStateFileSuffix];
+    [[NSFileManager defaultManager] createDirectoryAtPath:filePath.stringByDeletingLastPathComponent withIntermediateDirectories:YES attributes:nil error:NULL];
+    int fd = open(filePath.fileSystemRepresentation, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return;
+    ACNetCacheSharedState *state = MAP_FAILED;
+    struct stat fileStat;
+    flock(fd, LOCK_EX);
+    if (fstat(fd, &fileStat) == 0 && (fileStat.st_size >= (off_t)sizeof(ACNetCacheSharedState) || ftruncate(fd, sizeof(ACNetCacheSharedState)) == 0)) {
+        state = mmap(NULL, sizeof(ACNetCacheSharedState), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    /** 新文件由ftruncate填0,计数从0开始 */
+    if (state != MAP_FAILED && state->magic != ACNetCacheSharedStateMagic) state->magic = ACNetCacheSharedStateMagic;
+    flock(fd, LOCK_UN);
+    if (state == MAP_FAILED) {
+        close(fd);
+        return;
+    }
+    _sharedState = state;
+    _sharedStateDescriptor = fd;
+    _observedGeneration = atomic_load(&state->generation);
+    atomic_store(&_observedSequence, atomic_load(&state->sequence));
+    _shared = YES;
+}
+
+/**
+ 共享模式下,本进程是否已同步其他进程的最新修改.未同步时安排在self.ioQueue中同步并返回NO,
+ 此时内存缓存可能已过时,keyFilter可能漏掉其他进程新增的Key.非共享模式总是YES.可在任意线程调用
+
+ @return 是否已同步
+ */
+- (BOOL)sharedViewIsCurrent {
+    if (!_sharedState || atomic_load(&_sharedState->sequence) == atomic_load(&_observedSequence)) return YES;
+    if (!atomic_exchange(&_synchronizationScheduled, true)) {
+        dispatch_async(self.ioQueue, ^{
+            atomic_store(&self->_synchronizationScheduled, false);
+            [self _synchronizeSharedState];
+        });
+    }
+    return NO;
+}
+
+/**
+ 内部方法,其他进程有修改时加锁同步.需确保此方法在self.ioQueue中调用
  */
-- (BOOL)memoryCacheExistsForUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(ACNetCacheKeyGenerator)generator expires:(Expire_Time)expire {
-    return [self memoryCacheExistsForKey:[self fetchCacheKeyWithUrl:url  param:param keyGenerator:generator] expires:expire];
+- (void)_synchronizeSharedState {
+    if (!_sharedState || atomic_load(&_sharedState->sequence) == atomic_load(&_observedSequence)) return;
+    [self _lockSharedState];
+    [self _unlockSharedState];
 }
 
 /**
- 检查内存缓存中是否存在对应的response缓存
- 
- @param key Key
- @return 是否有缓存
+ 内部方法,共享模式下获取文件锁(可重入),首次获取时同步其他进程的修改.非共享模式不处理.需确保此方法在self.ioQueue中调用
  */
-- (BOOL)memoryCacheExistsForKey:(NSString *)key {
-    return [self.memoryCache objectForKey:key] != nil;
+- (void)_lockSharedState {
+    if (!self.shared || self.sharedLockDepth++ > 0) return;
+    while (flock(self.sharedStateDescriptor, LOCK_EX) != 0 && errno == EINTR);
+    [self _catchUpSharedState];
 }
 
 /**
- 检查内存缓存中是否存在对应的response缓存
- 
- @param key Key
- @param expire 过期时间
- @return 是否有缓存
+ 内部方法,释放_lockSharedState获取的文件锁.需确保此方法在self.ioQueue中调用
  */
-- (BOOL)memoryCacheExistsForKey:(NSString *)key expires:(Expire_Time)expire {
-    return [self.memoryCache objectForKey:key expires:expire] != nil;
+- (void)_unlockSharedState {
+    if (!self.shared || --self.sharedLockDepth > 0) return;
+    flock(self.sharedStateDescriptor, LOCK_UN);
 }
 
 /**
- 检查磁盘缓存中是否存在对应的response缓存
- 
- @param url URL
- @param param 请求参数
- @return 是否有缓存
+ 内部方法,同步其他进程的修改:代数变化(其他进程清空了缓存)时丢弃内存缓存及磁盘状态;否则重放变更日志的新记录,
+ 使对应Key在内存中的结果失效.日志被其他进程替换(写入检查点或清空缓存)时读取新的检查点,新日志的记录同样视为其他进程的修改.
+ 二级索引的变更日志同样重放其他进程追加的记录.
+ 需确保此方法在self.ioQueue中持有文件锁时调用
  */
-- (BOOL)diskCacheExistsForUrl:(NSString *)url param:(NSDictionary *)param {
-    return [self diskCacheExistsForUrl:url param:param keyGenerator:nil];
+- (void)_catchUpSharedState {
+    uint64_t generation = atomic_load(&_sharedState->generation);
+    if (generation != self.observedGeneration) {
+        self.observedGeneration = generation;
+        [self resetMemoryCaches];
+        [self _resetDiskState];
+        [self _createStreamingDirectory];
+    } else if (self.keyFilter && self.keyJournalDescriptor >= 0 && ![self _replayKeyJournalIntoFilter:self.keyFilter invalidating:YES]) {
+        /** 其他进程写入中途退出留下的残缺记录,截掉后追加的记录才能被读到 */
+        ftruncate(self.keyJournalDescriptor, self.keyJournalOffset);
+    }
+    if (self.keyFilter && [self _keyJournalReplaced] && ![self _loadKeyFilterCheckpointInvalidating:YES]) [self _rebuildKeyFilter];
+    /** 二级索引:应用其他进程追加的记录,日志被其他进程整理过时重新读取快照 */
+    if (self.indexJournalDescriptor >= 0) {
+        if ([self _indexJournalReplaced]) {
+            [self _reloadSecondaryIndex];
+        } else if (![self _replayIndexJournalIntoIndex:self.secondaryIndex]) {
+            ftruncate(self.indexJournalDescriptor, self.indexJournalOffset);
+        }
+    }
+    atomic_store(&_observedSequence, atomic_load(&_sharedState->sequence));
 }
 
 /**
- 检查磁盘缓存中是否存在对应的response缓存
- 
- @param url URL
- @param param 请求参数
- @param expire 过期时间
- @return 是否有缓存
+ 内部方法,磁盘上的变更日志是否已不是本进程打开的文件.需确保此方法在self.ioQueue中调用
+
+ @return 是否已替换
  */
-- (BOOL)diskCacheExistsForUrl:(NSString *)url param:(NSDictionary *)param expires:(Expire_Time)expire {
-    return [self diskCacheExistsForUrl:url param:param keyGenerator:nil expires:expire];
+- (BOOL)_keyJournalReplaced {
+    struct stat pathStat, fileStat;
+    if (stat([self metadataPathForName:ACNetCacheKeyJournalFileName].fileSystemRepresentation, &pathStat) != 0) return NO;
+    if (self.keyJournalDescriptor < 0 || fstat(self.keyJournalDescriptor, &fileStat) != 0) return YES;
+    return pathStat.st_ino != fileStat.st_ino || pathStat.st_dev != fileStat.st_dev;
 }
 
 /**
- 检查磁盘缓存中是否存在对应的response缓存
- 
- @param url URL
- @param param 请求参数
- @param generator 缓存Key生成器
- @return 是否有缓存
+ 内部方法,磁盘上的二级索引变更日志是否已不是本进程打开的文件(其他进程整理过).需确保此方法在self.ioQueue中调用
+
+ @return 是否已替换
  */
-- (BOOL)diskCacheExistsForUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(ACNetCacheKeyGenerator)generator {
-    return [self diskCacheExistsForKey:[self fetchCacheKeyWithUrl:url  param:param keyGenerator:generator] expires:Expire_Time_Never];
+- (BOOL)_indexJournalReplaced {
+    struct stat pathStat, fileStat;
+    if (stat([self metadataPathForName:ACNetCacheIndexJournalFileName].fileSystemRepresentation, &pathStat) != 0) return NO;
+    if (self.indexJournalDescriptor < 0 || fstat(self.indexJournalDescriptor, &fileStat) != 0) return YES;
+    return pathStat.st_ino != fileStat.st_ino || pathStat.st_dev != fileStat.st_dev;
 }
 
+#pragma mark - Index
+
 /**
- 检查磁盘缓存中是否存在对应的response缓存
- 
+ 在二级索引中记录Key的URL路径及标签,有变化时在self.ioQueue中追加到变更日志
+
+ @param storeKey 缓存的Key
  @param url URL
  @param param 请求参数
- @param expire 过期时间
- @param generator 缓存Key生成器
- @return 是否有缓存
+ @param tags 标签,nil时使用tagGenerator
  */
-- (BOOL)diskCacheExistsForUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(ACNetCacheKeyGenerator)generator expires:(Expire_Time)expire {
-    return [self diskCacheExistsForKey:[self fetchCacheKeyWithUrl:url  param:param keyGenerator:generator] expires:expire];
+- (void)indexKey:(NSString *)storeKey url:(NSString *)url param:(NSDictionary *)param tags:(NSArray<NSString *> *)tags {
+    if (!url || !storeKey) return;
+    if (!tags && self.tagGenerator) tags = self.tagGenerator(url, param);
+    NSString *path = ACNetCacheURLPath(url);
+    /** 路径及标签未变化(如轮询同一接口)时不追加日志 */
+    if (![self.secondaryIndex setPath:path tags:tags forKey:storeKey]) return;
+    NSMutableArray *fields = [NSMutableArray arrayWithObjects:storeKey, path, nil];
+    for (NSString *tag in tags) {
+        if ([tag isKindOfClass:NSString.class]) [fields addObject:tag];
+    }
+    NSMutableData *records = [NSMutableData data];
+    ACNetCacheAppendIndexJournalRecord(records, ACNetCacheIndexJournalSet, fields);
+    dispatch_async(self.ioQueue, ^{
+        [self _appendIndexJournalRecords:records count:1];
+    });
 }
 
 /**
- 检查磁盘缓存中是否存在对应的response缓存
- 
- @param key Key
- @return 是否有缓存
+ 在self.ioQueue中记录Key已从二级索引移除
+
+ @param keys 缓存Key
  */
-- (BOOL)diskCacheExistsForKey:(NSString *)key expires:(Expire_Time)expire {
-    if (!key) return NO;
-    __block BOOL exists = NO;
-    dispatch_sync(self.ioQueue, ^{
-        exists = [self _diskCacheExistsForKey:key expires:expire];
+- (void)journalIndexRemovalForKeys:(NSSet<NSString *> *)keys {
+    if (keys.count == 0) return;
+    NSData *records = ACNetCacheIndexJournalRemovals(keys);
+    dispatch_async(self.ioQueue, ^{
+        [self _appendIndexJournalRecords:records count:keys.count];
     });
-    return exists;
 }
 
 /**
- 内部方法,检查磁盘缓存中是否存在对应的response缓存,需确保此方法在self.ioQueue中调用
-
- @param key Key
- @param expire 过期时间
- @return 是否有缓存
+ 创建空的二级索引,在self.ioQueue中读取快照并重放变更日志,之后合并到当前索引,读取期间新记录的Key以新记录为准
  */
-- (BOOL)_diskCacheExistsForKey:(NSString *)key expires:(Expire_Time)expire {
-    if (!key) return NO;
-    NSString *filePath = [self filePathForStoreKey:key];
-    BOOL exists = [self.fileManager fileExistsAtPath:filePath];
-    if (exists) exists = ![self fileExpiredAtPath:[self filePathForStoreKey:key] expires:expire];
-    return exists;
+- (void)setupSecondaryIndex {
+    ACNetCacheIndex *index = [ACNetCacheIndex new];
+    self.secondaryIndex = index;
+    self.indexLoadGroup = dispatch_group_create();
+    dispatch_group_async(self.indexLoadGroup, self.ioQueue, ^{
+        [self _lockSharedState];
+        ACNetCacheIndex *saved = [[ACNetCacheIndex alloc] initWithContentsOfFile:[self metadataPathForName:ACNetCacheIndexFileName]];
+        [self _openIndexJournalReplayingIntoIndex:saved];
+        /** 读取期间删除了所有缓存时,磁盘中的记录随目录失效 */
+        if (self.secondaryIndex == index) [index mergeEntriesFromIndex:saved];
+        [self _unlockSharedState];
+    });
 }
 
-#pragma mark - Store
-
 /**
- 缓存response
- 
- @param response 要缓存的结果
- @param url URL
- @param param 请求参数
+ 内部方法,等待磁盘中的二级索引合并完成后返回,用于按标签或路径查找Key.共享模式下先同步其他进程记录的变更.不可在self.ioQueue中调用
+
+ @return 二级索引
  */
-- (void)storeResponse:(id)response forUrl:(nonnull NSString *)url param:(NSDictionary *)param {
-    [self storeResponse:response forUrl:url param:param toMemory:YES toDisk:YES];
+- (ACNetCacheIndex *)_loadedSecondaryIndex {
+    dispatch_group_wait(self.indexLoadGroup, DISPATCH_TIME_FOREVER);
+    if (self.shared) {
+        dispatch_sync(self.ioQueue, ^{
+            [self _synchronizeSharedState];
+        });
+    }
+    return self.secondaryIndex;
 }
 
 /**
- 缓存response
- 
- @param response 要缓存的结果
- @param url URL
- @param param 请求参数
- @param generator 缓存Key生成器
+ 内部方法,其他进程整理过二级索引的变更日志后,重新读取快照并重放新日志,替换当前索引.
+ 本进程尚未写入日志的变更在追加时重新应用.需确保此方法在self.ioQueue中持有文件锁时调用
  */
-- (void)storeResponse:(id)response forUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(ACNetCacheKeyGenerator)generator {
-    [self storeResponse:response forUrl:url param:param keyGenerator:generator toMemory:YES toDisk:YES];
+- (void)_reloadSecondaryIndex {
+    ACNetCacheIndex *index = [[ACNetCacheIndex alloc] initWithContentsOfFile:[self metadataPathForName:ACNetCacheIndexFileName]];
+    [self _openIndexJournalReplayingIntoIndex:index];
+    self.secondaryIndex = index;
 }
 
 /**
- 缓存response
+ 内部方法,打开二级索引的变更日志并将其中的记录应用到index,截掉末尾损坏或未写完的记录.需确保此方法在self.ioQueue中持有文件锁时调用
 
- @param response 要缓存的结果
- @param url URL
- @param param 请求参数
- @param toMemory 是否缓存到内存
- @param generator 缓存Key生成器
- @param toDisk 是否缓存到磁盘
+ @param index 索引,为nil时只统计记录数
  */
-- (void)storeResponse:(id)response forUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(ACNetCacheKeyGenerator)generator toMemory:(BOOL)toMemory toDisk:(BOOL)toDisk {
-    if (!toMemory && !toDisk) return;
-    NSString *storeKey = [self fetchCacheKeyWithUrl:url param:param keyGenerator:generator];
-    if (toMemory) [self.memoryCache setObject:response forKey:storeKey];
-    if (toDisk) [self storeResponseToDisk:response forKey:storeKey];
+- (void)_openIndexJournalReplayingIntoIndex:(ACNetCacheIndex *)index {
+    [self _closeIndexJournal];
+    int fd = open([self metadataFilePathForName:ACNetCacheIndexJournalFileName].fileSystemRepresentation, O_RDWR | O_APPEND | O_CREAT, 0644);
+    if (fd < 0) return;
+    self.indexJournalDescriptor = fd;
+    if (![self _replayIndexJournalIntoIndex:index] && ftruncate(fd, self.indexJournalOffset) != 0) [self _closeIndexJournal];
 }
 
 /**
- 缓存response
- 
- @param response 要缓存的结果
- @param url URL
- @param param 请求参数
- @param toDisk 是否缓存到磁盘
+ 内部方法,从indexJournalOffset读取二级索引的变更日志到末尾并应用到index,遇到损坏的记录时停止.需确保此方法在self.ioQueue中调用
+
+ @param index 索引,为nil时只统计记录数
+ @return 是否读到末尾,NO表示末尾有损坏或未写完的记录
  */
-- (void)storeResponse:(id)response forUrl:(NSString *)url param:(NSDictionary *)param toMemory:(BOOL)toMemory toDisk:(BOOL)toDisk {
-    [self storeResponse:response forUrl:url param:param keyGenerator:nil toMemory:toMemory toDisk:toDisk];
+- (BOOL)_replayIndexJournalIntoIndex:(ACNetCacheIndex *)index {
+    int fd = self.indexJournalDescriptor;
+    struct stat fileStat;
+    if (fd < 0 || fstat(fd, &fileStat) != 0) return NO;
+    off_t offset = self.indexJournalOffset;
+    if (fileStat.st_size <= offset) return fileStat.st_size == offset;
+    NSMutableData *journal = [NSMutableData dataWithLength:(NSUInteger)(fileStat.st_size - offset)];
+    if (pread(fd, journal.mutableBytes, journal.length, offset) != (ssize_t)journal.length) return NO;
+    NSUInteger count = 0;
+    NSUInteger length = ACNetCacheApplyIndexJournal(journal, index, &count);
+    self.indexJournalOffset = offset + (off_t)length;
+    self.indexJournalRecordCount += count;
+    return length == journal.length;
 }
 
 /**
- 缓存response到磁盘
+ 内部方法,追加二级索引的变更记录,日志不可用或记录数达到上限时写入快照并清空日志.
+ 共享模式下在文件锁内追加并增加修改序号,追加前重新应用本批记录,其间重新读取过索引时不会丢失.需确保此方法在self.ioQueue中调用
 
- @param response 要缓存的结果
- @param storeKey 缓存的Key
+ @param records 记录
+ @param count 记录数
  */
-- (void)storeResponseToDisk:(id)response forKey:(NSString *)storeKey {
-    if (!storeKey || !response) return;
-    dispatch_async(self.ioQueue, ^{
-        [[NSKeyedArchiver archivedDataWithRootObject:response] writeToFile:[self filePathForStoreKey:storeKey] atomically:YES];
-    });
+- (void)_appendIndexJournalRecords:(NSData *)records count:(NSUInteger)count {
+    if (records.length == 0) return;
+    [self _lockSharedState];
+    if (self.indexJournalDescriptor < 0) [self _openIndexJournalReplayingIntoIndex:self.shared ? self.secondaryIndex : nil];
+    if (self.shared) ACNetCacheApplyIndexJournal(records, self.secondaryIndex, NULL);
+    if (self.indexJournalDescriptor < 0 || write(self.indexJournalDescriptor, records.bytes, records.length) != (ssize_t)records.length) {
+        [self _compactIndexJournal];
+        return [self _unlockSharedState];
+    }
+    self.indexJournalOffset += (off_t)records.length;
+    self.indexJournalRecordCount += count;
+    if (_sharedState) atomic_store(&_observedSequence, atomic_fetch_add(&_sharedState->sequence, 1) + 1);
+    if (self.indexJournalRecordCount >= MAX(ACNetCacheIndexJournalCompactionInterval, self.secondaryIndex.count)) [self _compactIndexJournal];
+    [self _unlockSharedState];
 }
 
-#pragma mark - Fetch
-
 /**
- 异步获取本地缓存的response,不过期
- 
- @param url URL
- @param param 请求参数
- @param completion 回调
+ 内部方法,原子写入二级索引的快照后以空文件替换变更日志,两步之间中断时在新快照上重放日志结果不变.
+ 共享模式下在文件锁内进行,快照包含所有进程的变更,其他进程发现日志被替换后重新读取快照.需确保此方法在self.ioQueue中调用
  */
-- (void)fetchResponseForUrl:(NSString *)url param:(NSDictionary *)param completion:(ACNetCacheFetchCompletion)completion {
-    [self fetchResponseForUrl:url param:param expires:Expire_Time_Never completion:completion];
+- (void)_compactIndexJournal {
+    [self _lockSharedState];
+    if ([self.secondaryIndex writeToFile:[self metadataFilePathForName:ACNetCacheIndexFileName]]) {
+        self.indexJournalRecordCount = 0;
+        if ([self _writeData:[NSData data] atomicallyToPath:[self metadataFilePathForName:ACNetCacheIndexJournalFileName]]) {
+            [self _openIndexJournalReplayingIntoIndex:nil];
+            if (_sharedState) atomic_store(&_observedSequence, atomic_fetch_add(&_sharedState->sequence, 1) + 1);
+        }
+    }
+    [self _unlockSharedState];
 }
 
 /**
- 异步获取本地缓存的response
-
- @param url URL
- @param param 请求参数
- @param expire 过期时间
- @param completion 回调
+ 内部方法,关闭二级索引的变更日志,下次追加时重新打开.需确保此方法在self.ioQueue中调用
  */
-- (void)fetchResponseForUrl:(NSString *)url param:(NSDictionary *)param expires:(Expire_Time)expire completion:(ACNetCacheFetchCompletion)completion {
-    [self fetchResponseForUrl:url param:param expires:expire  async:YES completion:completion];
+- (void)_closeIndexJournal {
+    if (self.indexJournalDescriptor >= 0) close(self.indexJournalDescriptor);
+    self.indexJournalDescriptor = -1;
+    self.indexJournalRecordCount = 0;
+    self.indexJournalOffset = 0;
 }
 
+#pragma mark - Helper
 /**
- 获取本地缓存的response
- 
- @param url URL
- @param param 请求参数
- @param expire 过期时间
- @param completion 回调
- @param generator 缓存Key生成器
- @param async 是否异步
+ 根据key获取文件存储路径,分片目录不存在时创建(每个目录只检查一次),仍有未迁移的旧版文件时先迁移该key.需确保此方法在self.ioQueue中调用
+
+ @param storeKey key
+ @return 存储路径
  */
-- (void)fetchResponseForUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(ACNetCacheKeyGenerator)generator expires:(Expire_Time)expire async:(BOOL)async completion:(ACNetCacheFetchCompletion)completion {
-    if (!completion) return;
-    if (!url) return completion(ACNetCacheTypeNone, nil, nil);
-    NSString *storeKey = [self fetchCacheKeyWithUrl:url param:param keyGenerator:generator];
-    __block id result = [self.memoryCache objectForKey:storeKey expires:expire];
-    if (result) return completion(ACNetCacheTypeMemroy, result, [self.memoryCache updateDateForKey:storeKey]);
-    NSString *filePath = [self filePathForStoreKey:storeKey];
-    if (async) {
-        dispatch_async(self.ioQueue, ^{
-            if (!filePath) {
-                dispatch_async(dispatch_get_main_queue(), ^{
-                    completion(ACNetCacheTypeNone, nil, nil);
-                });
-            }
-            if ([self fileExpiredAtPath:filePath expires:expire]) {
-                dispatch_async(dispatch_get_main_queue(), ^{
-                    completion(ACNetCacheTypeNone, nil, nil);
-                });
-            } else {
-                result = [NSKeyedUnarchiver unarchiveObjectWithFile:filePath];
-                dispatch_async(dispatch_get_main_queue(), ^{
-                    completion(ACNetCacheTypeDisk, result, [self fileModificationDateAtPath:filePath]);
-                });
-            }
-        });
-    } else {
-        __block ACNetCacheType type = ACNetCacheTypeNone;
-        __block NSDate *date = nil;
-        dispatch_sync(self.ioQueue, ^{
-            if (filePath && ![self fileExpiredAtPath:filePath expires:expire]) {
-                result = [NSKeyedUnarchiver unarchiveObjectWithFile:filePath];
-                date = [self fileModificationDateAtPath:filePath];
-                type = ACNetCacheTypeDisk;
-            }
-        });
-        completion(type, result, date);
+- (NSString *)filePathForStoreKey:(NSString *)storeKey {
+    NSString *shard = ACNetCacheShardForKey(storeKey);
+    if (![self.shardDirectories containsObject:shard]) {
+        [self.fileManager createDirectoryAtPath:[self.diskDirectory stringByAppendingPathComponent:shard] withIntermediateDirectories:YES attributes:nil error:NULL];
+        [self.shardDirectories addObject:shard];
     }
+    NSString *filePath = [[self.diskDirectory stringByAppendingPathComponent:shard] stringByAppendingPathComponent:storeKey];
+    if (self.migratingFlatEntries) [self _migrateFlatEntryForKey:storeKey toPath:filePath];
+    return filePath;
 }
 
 /**
- 获取本地缓存的response
- 
- @param url URL
- @param param 请求参数
- @param expire 过期时间
- @param completion 回调
- @param async 是否异步
+ 根据key获取已有缓存文件的路径,尚未迁移的旧版文件返回其平铺路径.不创建目录也不迁移,可在任意线程调用
+
+ @param storeKey key
+ @return 存储路径,两处都不存在时为分片目录中的路径
  */
-- (void)fetchResponseForUrl:(NSString *)url param:(NSDictionary *)param expires:(Expire_Time)expire async:(BOOL)async completion:(ACNetCacheFetchCompletion)completion {
-    [self fetchResponseForUrl:url param:param keyGenerator:nil expires:expire async:async completion:completion];
+- (NSString *)diskPathForStoreKey:(NSString *)storeKey {
+    NSString *filePath = [[self.diskDirectory stringByAppendingPathComponent:ACNetCacheShardForKey(storeKey)] stringByAppendingPathComponent:storeKey];
+    if (access(filePath.fileSystemRepresentation, F_OK) == 0) return filePath;
+    NSString *flatPath = [self.diskDirectory stringByAppendingPathComponent:storeKey];
+    /** 迁移先link到分片目录再unlink平铺文件,平铺文件也不存在时说明刚刚迁移完成 */
+    return access(flatPath.fileSystemRepresentation, F_OK) == 0 ? flatPath : filePath;
 }
 
-#pragma mark - Delete
-
 /**
- 删除本地内存缓存和磁盘缓存的response
- 
- @param url URL
- @param param 请求参数
+ 热点清单、索引等元数据文件的路径,位于磁盘缓存目录下,目录不存在时创建.需确保此方法在self.ioQueue中调用
+
+ @param name 文件名
+ @return 路径
  */
-- (void)deleteResponseForUrl:(NSString *)url param:(NSDictionary *)param {
-    [self deleteResponseForUrl:url param:param fromMemory:YES fromDisk:YES];
+- (NSString *)metadataFilePathForName:(NSString *)name {
+    if (![self.shardDirectories containsObject:@""]) {
+        [self.fileManager createDirectoryAtPath:self.diskDirectory withIntermediateDirectories:YES attributes:nil error:NULL];
+        [self.shardDirectories addObject:@""];
+    }
+    return [self metadataPathForName:name];
 }
 
 /**
- 删除本地内存缓存和磁盘缓存的response
- 
- @param url URL
- @param param 请求参数
- @param generator 缓存Key生成器
+ 元数据文件的路径,不检查目录,可在任意线程调用
+
+ @param name 文件名
+ @return 路径
  */
-- (void)deleteResponseForUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(nullable ACNetCacheKeyGenerator)generator {
-    [self deleteResponseForUrl:url param:param keyGenerator:generator fromMemory:YES fromDisk:YES];
+- (NSString *)metadataPathForName:(NSString *)name {
+    return [self.diskDirectory stringByAppendingPathComponent:name];
 }
 
 /**
- 删除本地response缓存
- 
- @param url URL
- @param param 请求参数
- @param generator 缓存Key生成器
- @param fromMemory 是否删除内存缓存
- @param fromDisk 是否删除磁盘缓存
+ 内部方法,遍历所有缓存文件,包括尚未迁移的旧版文件.需确保此方法在self.ioQueue中调用
+
+ @param block 回调,参数为Key及文件路径
  */
-- (void)deleteResponseForUrl:(NSString *)url param:(NSDictionary *)param keyGenerator:(ACNetCacheKeyGenerator)generator fromMemory:(BOOL)fromMemory fromDisk:(BOOL)fromDisk {
-    NSString *storeKey = [self fetchCacheKeyWithUrl:url  param:param keyGenerator:generator];
-    if (fromMemory && [self memoryCacheExistsForKey:storeKey]) [self.memoryCache removeObjectForKey:storeKey];
-    if (fromDisk && [self diskCacheExistsForKey:storeKey expires:Expire_Time_Never]) {
-        dispatch_async(self.ioQueue, ^{
-            NSString *filePath = [self filePathForStoreKey:storeKey];
-            if ([self.fileManager fileExistsAtPath:filePath]) [self.fileManager removeItemAtPath:filePath error:nil];
+- (void)_enumerateEntriesUsingBlock:(void (^)(NSString *key, NSString *filePath))block {
+    NSString *directory = self.diskDirectory;
+    ACNetCacheEnumerateDirectory(directory, ^(NSString *name, unsigned char type) {
+        NSString *path = [directory stringByAppendingPathComponent:name];
+        if (type == DT_REG) return block(name, path);
+        if (type != DT_DIR || name.length != 2) return;
+        ACNetCacheEnumerateDirectory(path, ^(NSString *shard, unsigned char shardType) {
+            if (shardType != DT_DIR) return;
+            NSString *shardPath = [path stringByAppendingPathComponent:shard];
+            ACNetCacheEnumerateDirectory(shardPath, ^(NSString *key, unsigned char keyType) {
+                if (keyType == DT_REG) block(key, [shardPath stringByAppendingPathComponent:key]);
+            });
         });
-    }
+    });
 }
 
 /**
- 删除本地response缓存
- 
- @param url URL
- @param param 请求参数
- @param fromMemory 是否删除内存缓存
- @param fromDisk 是否删除磁盘缓存
+ 内部方法,找出旧版平铺在磁盘缓存目录下的缓存文件,分批迁移到分片目录,每批之间让出self.ioQueue.
+ 迁移完成前,filePathForStoreKey:会先迁移所访问的key.需确保此方法在self.ioQueue中调用
  */
-- (void)deleteResponseForUrl:(NSString *)url param:(NSDictionary *)param fromMemory:(BOOL)fromMemory fromDisk:(BOOL)fromDisk {
-    [self deleteResponseForUrl:url param:param keyGenerator:nil fromMemory:fromMemory fromDisk:fromDisk];
+- (void)_migrateFlatEntries {
+    NSMutableArray<NSString *> *keys = [NSMutableArray array];
+    ACNetCacheEnumerateDirectory(self.diskDirectory, ^(NSString *name, unsigned char type) {
+        if (type == DT_REG) [keys addObject:name];
+    });
+    if (keys.count == 0) return;
+    self.migratingFlatEntries = YES;
+    [self _migrateFlatEntries:keys fromIndex:0];
 }
 
+/**
+ 内部方法,迁移一批旧版缓存文件,之后异步迁移下一批.需确保此方法在self.ioQueue中调用
+
+ @param keys 待迁移的Key
+ @param index 本批起始位置
+ */
+- (void)_migrateFlatEntries:(NSArray<NSString *> *)keys fromIndex:(NSUInteger)index {
+    if (!self.migratingFlatEntries) return;
+    NSUInteger end = MIN(index + 256, keys.count);
+    for (NSUInteger i = index; i < end; i++) {
+        @autoreleasepool {
+            [self filePathForStoreKey:keys[i]];
+        }
+    }
+    if (end == keys.count) {
+        self.migratingFlatEntries = NO;
+        return;
+    }
+    dispatch_async(self.ioQueue, ^{
+        [self _migrateFlatEntries:keys fromIndex:end];
+    });
+}
 
-#pragma mark - Helper
 /**
- 根据key获取文件存储路径
+ 内部方法,将key的旧版缓存文件移动到分片目录,分片目录中已有较新的文件时删除旧文件.需确保此方法在self.ioQueue中调用
 
  @param storeKey key
- @return 存储路径
+ @param filePath 分片目录中的路径
  */
-- (NSString *)filePathForStoreKey:(NSString *)storeKey {
-    if (![self.fileManager fileExistsAtPath:self.diskDirectory]) {
-        [self.fileManager createDirectoryAtPath:self.diskDirectory withIntermediateDirectories:YES attributes:nil error:NULL];
-    }
-    return [self.diskDirectory stringByAppendingPathComponent:storeKey];
+- (void)_migrateFlatEntryForKey:(NSString *)storeKey toPath:(NSString *)filePath {
+    const char *flatPath = [self.diskDirectory stringByAppendingPathComponent:storeKey].fileSystemRepresentation;
+    /** link在目标已存在时失败,不会覆盖较新的文件;扩展属性随文件保留 */
+    if (link(flatPath, filePath.fileSystemRepresentation) == 0 || errno == EEXIST) unlink(flatPath);
 }
 
 /**
@@ -678,11 +4525,13 @@
  */
 - (BOOL)fileExpiredAtPath:(NSString *)filePath expires:(Expire_Time)expire {
     if (expire <= 0 || !filePath) return YES;
-    NSDate *modicationDate = [self fileModificationDateAtPath:filePath];
-    if (!modicationDate) return YES;
-    NSTimeInterval modificationTime = [modicationDate timeIntervalSince1970];
-    NSTimeInterval now = [[NSDate date] timeIntervalSince1970];
-    return modificationTime + expire <= now;
+    /** 修改时间随文件持久化,只能与墙上时间比较;直接stat,不创建NSDate及属性字典 */
+    struct stat fileStat;
+    if (stat(filePath.fileSystemRepresentation, &fileStat) != 0) return YES;
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    NSTimeInterval modificationTime = fileStat.st_mtimespec.tv_sec + fileStat.st_mtimespec.tv_nsec / (double)NSEC_PER_SEC;
+    return modificationTime + expire <= now.tv_sec + now.tv_usec / (double)USEC_PER_SEC;
 }
 
 /**
@@ -720,6 +4569,37 @@
     return _keyGenerator ?: DefaultKeyGenerator;
 }
 
+- (dispatch_queue_t)completionQueue {
+    return _completionQueue ?: dispatch_get_main_queue();
+}
+
+- (void)setMemoryCacheMaximumAge:(Expire_Time)memoryCacheMaximumAge {
+    _memoryCacheMaximumAge = memoryCacheMaximumAge;
+    self.memoryCache.maximumAge = memoryCacheMaximumAge < Expire_Time_Never ? MAX(memoryCacheMaximumAge, 0) : 0;
+}
+
+- (NSString *)trashDirectory {
+    return [self.diskDirectory stringByAppendingString:ACNetCacheTrashDirectorySuffix];
+}
+
+- (void)setMemoryCacheByteBudget:(NSUInteger)memoryCacheByteBudget {
+    _memoryCacheByteBudget = memoryCacheByteBudget;
+    self.memoryCache.byteLimit = memoryCacheByteBudget;
+}
+
+- (void)setSharedMemoryByteBudget:(NSUInteger)sharedMemoryByteBudget {
+    _sharedMemoryByteBudget = sharedMemoryByteBudget;
+    NSString *filePath = [self.diskDirectory stringByAppendingString:ACNetCacheSharedArenaFileSuffix];
+    self.sharedArena = sharedMemoryByteBudget ? [[ACNetCacheSharedArena alloc] initWithPath:filePath byteSize:sharedMemoryByteBudget] : nil;
+}
+
+- (ACNetCacheDataDecoder)streamedResponseDecoder {
+    if (_streamedResponseDecoder) return _streamedResponseDecoder;
+    return ^id(NSData *data) {
+        return [ACJSONParser JSONObjectWithData:data options:NSJSONReadingAllowFragments error:NULL];
+    };
+}
+
 @end
 
 
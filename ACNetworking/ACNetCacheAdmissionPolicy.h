@@ -0,0 +1,63 @@
+//
+//  ACNetCacheAdmissionPolicy.h
+//  ACNetworkingDemo
+//
+//  Created by Allen on 2019/3/14.
+//  Copyright © 2019 Allen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** 内存缓存的准入策略,决定结果是否写入内存.未准入的结果只写磁盘,只写内存的结果未准入时丢弃 */
+@protocol ACNetCacheAdmissionPolicy <NSObject>
+
+/**
+ 记录一次访问,每次读取缓存时调用一次;读取未命中后写入同一结果属于同一次访问,写入时不再调用.可在任意线程调用
+
+ @param key 缓存Key
+ */
+- (void)recordAccessForKey:(NSString *)key;
+
+/**
+ 是否将结果写入内存.可在任意线程调用
+
+ @param key 缓存Key
+ @param cost 结果的估算大小
+ @param victimKey 写入后内存缓存超出预算时将被淘汰的Key,未超出时为nil
+ @return 是否写入
+ */
+- (BOOL)shouldAdmitKey:(NSString *)key cost:(NSUInteger)cost victimKey:(nullable NSString *)victimKey;
+
+@end
+
+/**
+ TinyLFU准入策略:以4位计数的Count-Min Sketch估算各Key的近期访问频率,访问次数达到样本量时计数减半,使频率随时间衰减;
+ 首次访问只记入doorkeeper位图,避免只访问一次的Key占用计数.
+ 内存缓存有空间时直接准入,需要淘汰时只有频率高于被淘汰者的结果才写入内存,只访问一次的结果不会挤掉热点
+ */
+@interface ACNetCacheTinyLFUPolicy : NSObject <ACNetCacheAdmissionPolicy>
+
+/**
+ 实例化
+
+ @param expectedEntries 预计同时统计的Key数量,决定sketch的大小
+ @return 策略
+ */
+- (instancetype)initWithExpectedEntries:(NSUInteger)expectedEntries NS_DESIGNATED_INITIALIZER;
+
+/** 以预计4096个Key实例化 */
+- (instancetype)init;
+
+/**
+ 估算Key的近期访问频率
+
+ @param key 缓存Key
+ @return 频率,最大为16
+ */
+- (NSUInteger)frequencyForKey:(NSString *)key;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,172 @@
+//
+//  ACNetCacheAdmissionPolicy.m
+//  ACNetworkingDemo
+//
+//  Created by Allen on 2019/3/14.
+//  Copyright © 2019 Allen. All rights reserved.
+//
+
+#import "ACNetCacheAdmissionPolicy.h"
+
+/** sketch行数,每行使用独立的hash */
+static NSUInteger const ACTinyLFUDepth = 4;
+
+/** 计数上限 */
+static uint8_t const ACTinyLFUMaximumCount = 15;
+
+static const uint64_t ACTinyLFUSeeds[ACTinyLFUDepth] = {0xc3a5c85c97cb3127ULL, 0xb492b66fbe98f273ULL, 0x9ae16a3b2f90404fULL, 0xcbf29ce484222325ULL};
+
+/**
+ 混合64位hash(SplitMix64)
+
+ @param x 输入
+ @return hash
+ */
+static inline uint64_t ACTinyLFUMix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+/**
+ 计算Key的64位hash(FNV-1a),NSString的hash只取部分字符,不适合用作sketch
+
+ @param key Key
+ @return hash
+ */
+static uint64_t ACTinyLFUHash(NSString *key) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    const char *bytes = key.UTF8String;
+    for (const char *p = bytes; p && *p; p++) {
+        hash = (hash ^ (uint8_t)*p) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+@interface ACNetCacheTinyLFUPolicy ()
+
+/** 每行的计数个数,为2的幂 */
+@property (nonatomic, assign) NSUInteger width;
+
+/** 达到该访问次数后计数减半 */
+@property (nonatomic, assign) NSUInteger sampleSize;
+
+/** 自上次减半后的访问次数 */
+@property (nonatomic, assign) NSUInteger additions;
+
+/** 保护sketch和doorkeeper */
+@property (nonatomic, strong) dispatch_semaphore_t lock;
+
+@end
+
+@implementation ACNetCacheTinyLFUPolicy {
+    /** ACTinyLFUDepth行,每行width个计数 */
+    uint8_t *_counters;
+    /** doorkeeper位图,width位 */
+    uint64_t *_doorkeeper;
+}
+
+- (instancetype)initWithExpectedEntries:(NSUInteger)expectedEntries {
+    if (self = [super init]) {
+        NSUInteger width = 64;
+        while (width < MAX(expectedEntries, 1) && width < (1UL << 24)) width <<= 1;
+        _width = width;
+        _sampleSize = width * 10;
+        _counters = calloc(ACTinyLFUDepth * width, sizeof(uint8_t));
+        _doorkeeper = calloc(width / 64, sizeof(uint64_t));
+        _lock = dispatch_semaphore_create(1);
+    }
+    return self;
+}
+
+- (instancetype)init {
+    return [self initWithExpectedEntries:4096];
+}
+
+- (void)dealloc {
+    free(_counters);
+    free(_doorkeeper);
+}
+
+#pragma mark - ACNetCacheAdmissionPolicy
+
+- (void)recordAccessForKey:(NSString *)key {
+    if (!key) return;
+    uint64_t hash = ACTinyLFUHash(key);
+    dispatch_semaphore_wait(self.lock, DISPATCH_TIME_FOREVER);
+    [self _incrementHash:hash];
+    dispatch_semaphore_signal(self.lock);
+}
+
+- (BOOL)shouldAdmitKey:(NSString *)key cost:(NSUInteger)cost victimKey:(NSString *)victimKey {
+    if (!victimKey) return YES;
+    return [self frequencyForKey:key] > [self frequencyForKey:victimKey];
+}
+
+#pragma mark - Frequency
+
+- (NSUInteger)frequencyForKey:(NSString *)key {
+    if (!key) return 0;
+    uint64_t hash = ACTinyLFUHash(key);
+    dispatch_semaphore_wait(self.lock, DISPATCH_TIME_FOREVER);
+    NSUInteger frequency = [self _frequencyOfHash:hash];
+    dispatch_semaphore_signal(self.lock);
+    return frequency;
+}
+
+/**
+ 内部方法,sketch中各行的最小计数,doorkeeper中有该Key时再加1.doorkeeper在衰减时清空,sketch中减半的计数仍然计入.需确保此方法在self.lock内调用
+
+ @param hash Key的hash
+ @return 频率
+ */
+- (NSUInteger)_frequencyOfHash:(uint64_t)hash {
+    NSUInteger mask = self.width - 1;
+    BOOL seen = (_doorkeeper[(hash & mask) / 64] & (1ULL << (hash & 63))) != 0;
+    uint8_t frequency = ACTinyLFUMaximumCount;
+    for (NSUInteger i = 0; i < ACTinyLFUDepth; i++) {
+        frequency = MIN(frequency, _counters[i * self.width + (ACTinyLFUMix(hash ^ ACTinyLFUSeeds[i]) & mask)]);
+    }
+    return frequency + (seen ? 1 : 0);
+}
+
+/**
+ 内部方法,记录一次访问:首次只记入doorkeeper,之后各行计数加1(只增加最小的计数,减少冲突带来的高估).需确保此方法在self.lock内调用
+
+ @param hash Key的hash
+ */
+- (void)_incrementHash:(uint64_t)hash {
+    NSUInteger mask = self.width - 1;
+    uint64_t *word = &_doorkeeper[(hash & mask) / 64];
+    uint64_t bit = 1ULL << (hash & 63);
+    if (!(*word & bit)) {
+        *word |= bit;
+    } else {
+        NSUInteger indexes[ACTinyLFUDepth];
+        uint8_t minimum = ACTinyLFUMaximumCount;
+        for (NSUInteger i = 0; i < ACTinyLFUDepth; i++) {
+            indexes[i] = i * self.width + (ACTinyLFUMix(hash ^ ACTinyLFUSeeds[i]) & mask);
+            minimum = MIN(minimum, _counters[indexes[i]]);
+        }
+        if (minimum < ACTinyLFUMaximumCount) {
+            for (NSUInteger i = 0; i < ACTinyLFUDepth; i++) {
+                if (_counters[indexes[i]] == minimum) _counters[indexes[i]]++;
+            }
+        }
+    }
+    if (++self.additions >= self.sampleSize) [self _reset];
+}
+
+/**
+ 内部方法,所有计数减半并清空doorkeeper,使频率随时间衰减.需确保此方法在self.lock内调用
+ */
+- (void)_reset {
+    for (NSUInteger i = 0; i < ACTinyLFUDepth * self.width; i++) _counters[i] >>= 1;
+    memset(_doorkeeper, 0, self.width / 64 * sizeof(uint64_t));
+    self.additions = 0;
+}
+
+@end
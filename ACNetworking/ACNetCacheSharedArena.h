@@ -0,0 +1,76 @@
+//
+//  ACNetCacheSharedArena.h
+//  ACNetworkingDemo
+//
+//  Created by Allen on 2019/3/18.
+//  Copyright © 2019 Allen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ 跨进程共享的内存区域:映射同一文件的进程共用一份数据,页面只在系统页缓存中存在一份.
+ 文件头之后是开放寻址的hash表,槽位以原子操作认领和发布,读写都不加锁;之后是分为两段、轮流按序分配的数据区,记录写入后不再修改.
+ 正在写入的段写满时回收另一段(其中是最旧的记录,该段代数加1),只有该段的记录失效,其槽位可被其他Key复用;跨越回收的读取视为未命中.
+ 每条记录带校验值,读到未写完或已被覆盖的记录时同样视为未命中
+ */
+@interface ACNetCacheSharedArena : NSObject
+
+/** 映射的文件大小(字节),文件已存在时以文件为准 */
+@property (nonatomic, assign, readonly) NSUInteger byteSize;
+
+/**
+ 映射文件,文件不存在或格式不符时按byteSize创建
+
+ @param path 文件路径
+ @param byteSize 文件大小
+ @return 区域,文件无法创建或映射时返回nil
+ */
+- (nullable instancetype)initWithPath:(NSString *)path byteSize:(NSUInteger)byteSize NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/**
+ 读取数据,返回的数据为拷贝,不受之后的清空影响.可在任意线程调用
+
+ @param key Key
+ @param timestamp 写入时间(距1970年的秒数)
+ @return 数据,未命中返回nil
+ */
+- (nullable NSData *)dataForKey:(NSString *)key timestamp:(nullable NSTimeInterval *)timestamp;
+
+/**
+ 读取数据的写入时间,不拷贝数据.可在任意线程调用
+
+ @param key Key
+ @return 写入时间(距1970年的秒数),未命中返回0
+ */
+- (NSTimeInterval)timestampForKey:(NSString *)key;
+
+/**
+ 写入数据,替换该Key原有的数据.探测范围内没有可用的槽位或正在回收时只放弃本次写入并返回NO,由调用方改存他处,不影响其他数据.可在任意线程调用
+
+ @param data 数据
+ @param key Key
+ @param timestamp 写入时间(距1970年的秒数)
+ @return 是否写入
+ */
+- (BOOL)setData:(NSData *)data forKey:(NSString *)key timestamp:(NSTimeInterval)timestamp;
+
+/**
+ 移除数据.可在任意线程调用
+
+ @param key Key
+ */
+- (void)removeDataForKey:(NSString *)key;
+
+/**
+ 清空区域,对所有映射该文件的进程生效.可在任意线程调用
+ */
+- (void)removeAllData;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,454 @@
+//
+//  ACNetCacheSharedArena.m
+//  ACNetworkingDemo
+//
+//  Created by Allen on 2019/3/18.
+//  Copyright © 2019 Allen. All rights reserved.
+//
+
+#import "ACNetCacheSharedArena.h"
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
+
+static uint32_t const ACSharedArenaMagic = 0x41435341;
+
+static uint32_t const ACSharedArenaVersion = 2;
+
+/** 文件的最小大小 */
+static NSUInteger const ACSharedArenaMinimumByteSize = 1024 * 1024;
+
+/** 每个槽位对应的数据区字节数,决定hash表的大小 */
+static NSUInteger const ACSharedArenaBytesPerSlot = 256;
+
+/** 查找及认领槽位时最多探测的槽位数,范围内没有可用的槽位时放弃本次写入 */
+static NSUInteger const ACSharedArenaMaximumProbes = 32;
+
+/** 数据区的段数,轮流写入,写满一段时回收另一段 */
+static NSUInteger const ACSharedArenaSegmentCount = 2;
+
+/** 每段的记录数上限为槽位数的1/8,写满记录数同样回收另一段,使有效记录不超过槽位数的1/4,探测范围几乎不会被占满 */
+static NSUInteger const ACSharedArenaSlotsPerSegmentRecord = 8;
+
+/** 槽位值中代数标记的位置,低位为记录的偏移 */
+static int const ACSharedArenaTagShift = 40;
+
+static uint64_t const ACSharedArenaOffsetMask = (1ULL << ACSharedArenaTagShift) - 1;
+
+static uint64_t const ACSharedArenaTagMask = (1ULL << (64 - ACSharedArenaTagShift)) - 1;
+
+/** 文件头,大小为104字节 */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t fileSize;
+    uint64_t slotCount;
+    uint64_t dataOffset;
+    /** 每段的字节数,8字节对齐 */
+    uint64_t segmentSize;
+    /** 代数,每次整体清空加2,奇数表示正在清空 */
+    _Atomic uint64_t epoch;
+    /** 正在写入的段的序号,只增加,对段数取余为段的下标 */
+    _Atomic uint64_t segment;
+    /** 每段已分配的字节数 */
+    _Atomic uint64_t allocated[2];
+    /** 每段已分配的记录数 */
+    _Atomic uint64_t recordCounts[2];
+    /** 每段的代数,每次回收加2,奇数表示正在回收 */
+    _Atomic uint64_t segmentEpochs[2];
+} ACSharedArenaHeader;
+
+typedef struct {
+    /** Key的hash,0表示空槽位.认领后只在记录失效时被其他Key复用 */
+    _Atomic uint64_t hash;
+    /** 高位为发布时所在段代数的低位,低位为记录在数据区中的偏移/8+1,0表示无数据 */
+    _Atomic uint64_t value;
+} ACSharedArenaSlot;
+
+/** 数据区中的记录头,之后依次为Key及数据,整条记录按8字节对齐 */
+typedef struct {
+    uint64_t hash;
+    /** 覆盖时间、长度、Key及数据的校验值 */
+    uint64_t checksum;
+    double timestamp;
+    uint32_t keyLength;
+    uint32_t dataLength;
+} ACSharedArenaRecord;
+
+/**
+ 混合64位hash(SplitMix64)
+
+ @param x 输入
+ @return hash
+ */
+static inline uint64_t ACSharedArenaMix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+/**
+ 按8字节分块计算的64位hash,用于Key及记录校验,只需发现并发覆盖造成的不一致,不要求抗碰撞
+
+ @param bytes 数据
+ @param length 长度
+ @param seed 种子
+ @return hash
+ */
+static uint64_t ACSharedArenaHash(const void *bytes, size_t length, uint64_t seed) {
+    const uint8_t *p = bytes;
+    uint64_t hash = seed ^ (length * 0x9e3779b97f4a7c15ULL);
+    for (; length >= 8; p += 8, length -= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        hash ^= word;
+        hash = ((hash << 31) | (hash >> 33)) * 0x9e3779b97f4a7c15ULL;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, p, length);
+    return ACSharedArenaMix(hash ^ tail ^ ((uint64_t)length << 56));
+}
+
+/**
+ 记录的校验值
+
+ @param record 记录头
+ @param key Key
+ @param data 数据
+ @return 校验值
+ */
+static uint64_t ACSharedArenaChecksum(const ACSharedArenaRecord *record, const void *key, const void *data) {
+    uint64_t timestamp;
+    memcpy(&timestamp, &record->timestamp, sizeof(timestamp));
+    uint64_t seed = record->hash ^ ACSharedArenaMix(timestamp) ^ ((uint64_t)record->keyLength << 32 | record->dataLength);
+    return ACSharedArenaHash(data, record->dataLength, ACSharedArenaHash(key, record->keyLength, seed));
+}
+
+static inline uint64_t ACSharedArenaAlign(uint64_t length) {
+    return (length + 7) & ~7ULL;
+}
+
+@implementation ACNetCacheSharedArena {
+    int _fd;
+    uint8_t *_base;
+    ACSharedArenaHeader *_header;
+    ACSharedArenaSlot *_slots;
+    /** 槽位数-1 */
+    uint64_t _mask;
+    /** 清空及回收时进程内的互斥,文件锁只在进程间互斥 */
+    dispatch_semaphore_t _resetLock;
+}
+
+- (instancetype)initWithPath:(NSString *)path byteSize:(NSUInteger)byteSize {
+    if (self = [super init]) {
+        _fd = -1;
+        _resetLock = dispatch_semaphore_create(1);
+        [[NSFileManager defaultManager] createDirectoryAtPath:path.stringByDeletingLastPathComponent withIntermediateDirectories:YES attributes:nil error:NULL];
+        _fd = open(path.fileSystemRepresentation, O_RDWR | O_CREAT, 0644);
+        if (_fd < 0) return nil;
+        flock(_fd, LOCK_EX);
+        BOOL mapped = [self _mapWithByteSize:MAX(byteSize, ACSharedArenaMinimumByteSize)];
+        /** 持有文件锁时代数为奇数,说明上次清空或回收的进程中途退出,在此完成清空 */
+        if (mapped && ((atomic_load(&_header->epoch) | atomic_load(&_header->segmentEpochs[0]) | atomic_load(&_header->segmentEpochs[1])) & 1)) [self _reset];
+        flock(_fd, LOCK_UN);
+        if (!mapped) return nil;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    if (_base) munmap(_base, _byteSize);
+    if (_fd >= 0) close(_fd);
+}
+
+/**
+ 内部方法,映射文件,文件头无效时按byteSize重新创建.需确保此方法在文件锁内调用
+
+ @param byteSize 文件大小
+ @return 是否成功
+ */
+- (BOOL)_mapWithByteSize:(NSUInteger)byteSize {
+    struct stat fileStat;
+    if (fstat(_fd, &fileStat) != 0) return NO;
+    ACSharedArenaHeader existing;
+    BOOL valid = fileStat.st_size >= (off_t)sizeof(existing) && pread(_fd, &existing, sizeof(existing), 0) == sizeof(existing);
+    valid = valid && existing.magic == ACSharedArenaMagic && existing.version == ACSharedArenaVersion && existing.fileSize == (uint64_t)fileStat.st_size;
+    valid = valid && existing.slotCount && !(existing.slotCount & (existing.slotCount - 1));
+    valid = valid && existing.dataOffset == sizeof(ACSharedArenaHeader) + existing.slotCount * sizeof(ACSharedArenaSlot);
+    valid = valid && existing.segmentSize && !(existing.segmentSize & 7) && existing.dataOffset + existing.segmentSize * ACSharedArenaSegmentCount <= existing.fileSize;
+    uint64_t slotCount = 1024;
+    if (valid) {
+        byteSize = (NSUInteger)fileStat.st_size;
+    } else {
+        while (slotCount < byteSize / ACSharedArenaBytesPerSlot) slotCount <<= 1;
+        if (sizeof(ACSharedArenaHeader) + slotCount * sizeof(ACSharedArenaSlot) >= byteSize) return NO;
+        /** 先截为0再扩展,新文件内容全部为0 */
+        if (ftruncate(_fd, 0) != 0 || ftruncate(_fd, (off_t)byteSize) != 0) return NO;
+    }
+    void *base = mmap(NULL, byteSize, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+    if (base == MAP_FAILED) return NO;
+    _base = base;
+    _byteSize = byteSize;
+    _header = base;
+    if (!valid) {
+        _header->version = ACSharedArenaVersion;
+        _header->fileSize = byteSize;
+        _header->slotCount = slotCount;
+        _header->dataOffset = sizeof(ACSharedArenaHeader) + slotCount * sizeof(ACSharedArenaSlot);
+        _header->segmentSize = ((byteSize - _header->dataOffset) / ACSharedArenaSegmentCount) & ~7ULL;
+        atomic_thread_fence(memory_order_release);
+        _header->magic = ACSharedArenaMagic;
+    }
+    _slots = (ACSharedArenaSlot *)(_base + sizeof(ACSharedArenaHeader));
+    _mask = _header->slotCount - 1;
+    return YES;
+}
+
+#pragma mark - Access
+
+- (NSData *)dataForKey:(NSString *)key timestamp:(NSTimeInterval *)timestamp {
+    NSData *keyData = [key dataUsingEncoding:NSUTF8StringEncoding];
+    NSData *data = nil;
+    return keyData && [self _readRecordForKeyData:keyData data:&data timestamp:timestamp] ? data : nil;
+}
+
+- (NSTimeInterval)timestampForKey:(NSString *)key {
+    NSData *keyData = [key dataUsingEncoding:NSUTF8StringEncoding];
+    NSTimeInterval timestamp = 0;
+    return keyData && [self _readRecordForKeyData:keyData data:NULL timestamp:&timestamp] ? timestamp : 0;
+}
+
+- (BOOL)setData:(NSData *)data forKey:(NSString *)key timestamp:(NSTimeInterval)timestamp {
+    NSData *keyData = [key dataUsingEncoding:NSUTF8StringEncoding];
+    if (!keyData || !data) return NO;
+    uint64_t epoch = atomic_load_explicit(&_header->epoch, memory_order_acquire);
+    uint64_t length = ACSharedArenaAlign(sizeof(ACSharedArenaRecord) + keyData.length + data.length);
+    /** 单条数据不超过一段的1/4,避免一条数据导致频繁回收 */
+    if ((epoch & 1) || length > _header->segmentSize / 4 || keyData.length > UINT32_MAX) {
+        [self removeDataForKey:key];
+        return NO;
+    }
+    uint64_t hash = [self _hashOfKeyData:keyData];
+    /** 探测范围内没有该Key,也没有可用的槽位,只放弃本次写入 */
+    ACSharedArenaSlot *slot = [self _slotForHash:hash claim:YES];
+    if (!slot) return NO;
+    uint64_t offset = 0, segmentEpoch = 0;
+    if (![self _allocateLength:length offset:&offset segmentEpoch:&segmentEpoch]) {
+        atomic_store_explicit(&slot->value, 0, memory_order_release);
+        return NO;
+    }
+    uint8_t *bytes = _base + _header->dataOffset + offset;
+    ACSharedArenaRecord record = {hash, 0, timestamp, (uint32_t)keyData.length, (uint32_t)data.length};
+    record.checksum = ACSharedArenaChecksum(&record, keyData.bytes, data.bytes);
+    memcpy(bytes, &record, sizeof(record));
+    memcpy(bytes + sizeof(record), keyData.bytes, keyData.length);
+    memcpy(bytes + sizeof(record) + keyData.length, data.bytes, data.length);
+    /** 发布时所在段已被回收的记录带有旧代数,读取时忽略 */
+    uint64_t value = ((segmentEpoch & ACSharedArenaTagMask) << ACSharedArenaTagShift) | (offset / 8 + 1);
+    atomic_store_explicit(&slot->value, value, memory_order_release);
+    return YES;
+}
+
+- (void)removeDataForKey:(NSString *)key {
+    NSData *keyData = [key dataUsingEncoding:NSUTF8StringEncoding];
+    if (!keyData) return;
+    ACSharedArenaSlot *slot = [self _slotForHash:[self _hashOfKeyData:keyData] claim:NO];
+    if (slot) atomic_store_explicit(&slot->value, 0, memory_order_release);
+}
+
+- (void)removeAllData {
+    dispatch_semaphore_wait(_resetLock, DISPATCH_TIME_FOREVER);
+    while (flock(_fd, LOCK_EX) != 0 && errno == EINTR);
+    [self _reset];
+    flock(_fd, LOCK_UN);
+    dispatch_semaphore_signal(_resetLock);
+}
+
+#pragma mark - Private
+
+/**
+ 内部方法,Key的hash,不为0
+
+ @param keyData Key的UTF8数据
+ @return hash
+ */
+- (uint64_t)_hashOfKeyData:(NSData *)keyData {
+    uint64_t hash = ACSharedArenaHash(keyData.bytes, keyData.length, 0xcbf29ce484222325ULL);
+    return hash ?: 1;
+}
+
+/**
+ 内部方法,查找Key的记录并校验
+
+ @param keyData Key的UTF8数据
+ @param data 数据的拷贝,为NULL时不拷贝,直接在区域中校验
+ @param timestamp 写入时间
+ @return 是否命中
+ */
+- (BOOL)_readRecordForKeyData:(NSData *)keyData data:(NSData **)data timestamp:(NSTimeInterval *)timestamp {
+    uint64_t hash = [self _hashOfKeyData:keyData];
+    uint64_t epoch = atomic_load_explicit(&_header->epoch, memory_order_acquire);
+    if (epoch & 1) return NO;
+    ACSharedArenaSlot *slot = [self _slotForHash:hash claim:NO];
+    if (!slot) return NO;
+    uint64_t value = atomic_load_explicit(&slot->value, memory_order_acquire);
+    uint64_t segmentSize = _header->segmentSize;
+    uint64_t offset = ((value & ACSharedArenaOffsetMask) - 1) * 8;
+    uint64_t index = offset / segmentSize;
+    if (!(value & ACSharedArenaOffsetMask) || index >= ACSharedArenaSegmentCount) return NO;
+    uint64_t segmentEpoch = atomic_load_explicit(&_header->segmentEpochs[index], memory_order_acquire);
+    if ((segmentEpoch & 1) || (value >> ACSharedArenaTagShift) != (segmentEpoch & ACSharedArenaTagMask)) return NO;
+    uint64_t end = (index + 1) * segmentSize;
+    if (offset + sizeof(ACSharedArenaRecord) > end) return NO;
+    const uint8_t *bytes = _base + _header->dataOffset + offset;
+    ACSharedArenaRecord record;
+    memcpy(&record, bytes, sizeof(record));
+    if (record.hash != hash || record.keyLength != keyData.length || offset + sizeof(record) + record.keyLength + record.dataLength > end) return NO;
+    const void *recordData = bytes + sizeof(record) + record.keyLength;
+    NSMutableData *copy = nil;
+    if (data) {
+        copy = [NSMutableData dataWithLength:record.dataLength];
+        memcpy(copy.mutableBytes, recordData, record.dataLength);
+        recordData = copy.bytes;
+    }
+    /** 以调用方的Key计算校验值,同时确认记录属于该Key */
+    BOOL valid = ACSharedArenaChecksum(&record, keyData.bytes, recordData) == record.checksum;
+    /** 读取期间所在的段被回收或区域被清空时,记录可能已被覆盖 */
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&_header->segmentEpochs[index], memory_order_relaxed) != segmentEpoch || atomic_load_explicit(&_header->epoch, memory_order_relaxed) != epoch) return NO;
+    if (!valid) return NO;
+    if (data) *data = copy;
+    if (timestamp) *timestamp = record.timestamp;
+    return YES;
+}
+
+/**
+ 内部方法,槽位的记录是否已失效:已移除、尚未发布,或所在的段已被回收
+
+ @param value 槽位值
+ @return 是否失效
+ */
+- (BOOL)_isStaleValue:(uint64_t)value {
+    if (!(value & ACSharedArenaOffsetMask)) return YES;
+    uint64_t index = ((value & ACSharedArenaOffsetMask) - 1) * 8 / _header->segmentSize;
+    if (index >= ACSharedArenaSegmentCount) return YES;
+    uint64_t segmentEpoch = atomic_load_explicit(&_header->segmentEpochs[index], memory_order_acquire);
+    return (value >> ACSharedArenaTagShift) != (segmentEpoch & ACSharedArenaTagMask);
+}
+
+/**
+ 内部方法,按线性探测查找hash所在的槽位.claim为YES且范围内没有该hash时认领一个槽位:
+ 优先复用靠前的记录已失效的槽位,其次认领空槽位
+
+ @param hash Key的hash
+ @param claim 是否认领槽位
+ @return 槽位,未找到或没有可用的槽位时返回NULL
+ */
+- (ACSharedArenaSlot *)_slotForHash:(uint64_t)hash claim:(BOOL)claim {
+    ACSharedArenaSlot *reusable = NULL;
+    uint64_t reusableHash = 0;
+    for (NSUInteger i = 0; i < ACSharedArenaMaximumProbes; i++) {
+        ACSharedArenaSlot *slot = &_slots[(hash + i) & _mask];
+        uint64_t slotHash = atomic_load_explicit(&slot->hash, memory_order_acquire);
+        if (slotHash == hash) return slot;
+        if (slotHash == 0) {
+            if (!claim) return NULL;
+            /** 槽位只在清空时变空,空槽位之后不会有该hash */
+            break;
+        }
+        if (claim && !reusable && [self _isStaleValue:atomic_load_explicit(&slot->value, memory_order_acquire)]) {
+            reusable = slot;
+            reusableHash = slotHash;
+        }
+    }
+    if (!claim) return NULL;
+    /** 复用失效槽位:其他线程同时复用同一槽位时,CAS失败后读到的hash相同即为同一Key */
+    if (reusable && (atomic_compare_exchange_strong(&reusable->hash, &reusableHash, hash) || reusableHash == hash)) return reusable;
+    for (NSUInteger i = 0; i < ACSharedArenaMaximumProbes; i++) {
+        ACSharedArenaSlot *slot = &_slots[(hash + i) & _mask];
+        uint64_t slotHash = 0;
+        if (atomic_compare_exchange_strong(&slot->hash, &slotHash, hash) || slotHash == hash) return slot;
+    }
+    return NULL;
+}
+
+/**
+ 内部方法,在正在写入的段中分配length字节,该段的字节数或记录数已满时回收另一段并切换过去
+
+ @param length 字节数
+ @param offset 分配的位置,相对数据区
+ @param segmentEpoch 所在段的代数
+ @return 是否分配成功,其他线程或进程正在回收时返回NO
+ */
+- (BOOL)_allocateLength:(uint64_t)length offset:(uint64_t *)offset segmentEpoch:(uint64_t *)segmentEpoch {
+    uint64_t segmentSize = _header->segmentSize;
+    for (NSUInteger attempt = 0; attempt < 2; attempt++) {
+        uint64_t segment = atomic_load_explicit(&_header->segment, memory_order_acquire);
+        uint64_t index = segment % ACSharedArenaSegmentCount;
+        uint64_t epoch = atomic_load_explicit(&_header->segmentEpochs[index], memory_order_acquire);
+        if (epoch & 1) return NO;
+        uint64_t position = atomic_fetch_add(&_header->allocated[index], length);
+        uint64_t count = atomic_fetch_add(&_header->recordCounts[index], 1);
+        if (position + length <= segmentSize && count < _header->slotCount / ACSharedArenaSlotsPerSegmentRecord) {
+            *offset = index * segmentSize + position;
+            *segmentEpoch = epoch;
+            return YES;
+        }
+        [self _recycleAfterSegment:segment];
+    }
+    return NO;
+}
+
+/**
+ 内部方法,正在写入的段仍为segment时回收下一段(其中是最旧的记录)并切换过去,只有该段的记录失效.
+ 其他线程或进程正在回收或清空时直接返回
+
+ @param segment 发现已满的段的序号
+ */
+- (void)_recycleAfterSegment:(uint64_t)segment {
+    if (dispatch_semaphore_wait(_resetLock, DISPATCH_TIME_NOW) != 0) return;
+    if (flock(_fd, LOCK_EX | LOCK_NB) == 0) {
+        if (atomic_load(&_header->segment) == segment) {
+            uint64_t index = (segment + 1) % ACSharedArenaSegmentCount;
+            /** 代数先变为奇数,使该段的记录失效、进行中的读取作废,清零分配位置后再变为偶数 */
+            uint64_t epoch = atomic_load(&_header->segmentEpochs[index]) | 1;
+            atomic_store(&_header->segmentEpochs[index], epoch);
+            atomic_store_explicit(&_header->allocated[index], 0, memory_order_relaxed);
+            atomic_store_explicit(&_header->recordCounts[index], 0, memory_order_relaxed);
+            atomic_store_explicit(&_header->segmentEpochs[index], epoch + 1, memory_order_release);
+            atomic_store_explicit(&_header->segment, segment + 1, memory_order_release);
+        }
+        flock(_fd, LOCK_UN);
+    }
+    dispatch_semaphore_signal(_resetLock);
+}
+
+/**
+ 内部方法,清空hash表及数据区:代数先变为奇数,使进行中的读取失效、新的读写直接返回,清空后再变为偶数.需确保此方法在文件锁内调用
+ */
+- (void)_reset {
+    uint64_t epoch = atomic_load(&_header->epoch) | 1;
+    atomic_store(&_header->epoch, epoch);
+    uint64_t segmentEpochs[ACSharedArenaSegmentCount];
+    for (NSUInteger i = 0; i < ACSharedArenaSegmentCount; i++) {
+        segmentEpochs[i] = atomic_load(&_header->segmentEpochs[i]) | 1;
+        atomic_store(&_header->segmentEpochs[i], segmentEpochs[i]);
+    }
+    for (uint64_t i = 0; i <= _mask; i++) {
+        atomic_store_explicit(&_slots[i].hash, 0, memory_order_relaxed);
+        atomic_store_explicit(&_slots[i].value, 0, memory_order_relaxed);
+    }
+    for (NSUInteger i = 0; i < ACSharedArenaSegmentCount; i++) {
+        atomic_store_explicit(&_header->allocated[i], 0, memory_order_relaxed);
+        atomic_store_explicit(&_header->recordCounts[i], 0, memory_order_relaxed);
+        atomic_store_explicit(&_header->segmentEpochs[i], segmentEpochs[i] + 1, memory_order_release);
+    }
+    atomic_store_explicit(&_header->epoch, epoch + 1, memory_order_release);
+}
+
+@end
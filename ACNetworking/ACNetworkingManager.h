@@ -43,6 +43,19 @@ typedef NS_ENUM(NSUInteger, ACNetworkingFetchOption) {
  */
 typedef void(^ACNetworkingCompletion)(NSURLSessionDataTask * _Nullable task, ACNetCacheType type, id _Nullable responseObject, NSError * _Nullable error, NSDate * _Nullable cacheDate);
 
+/** 结果解析器,通常由模型类实现 */
+@protocol ACNetworkingResponseDecoding <NSObject>
+
+/**
+ 将网络或缓存结果解析为模型,在后台解析队列调用
+
+ @param responseObject 请求返回结果
+ @return 模型,返回nil视为解析失败
+ */
++ (nullable id)ac_modelWithResponse:(id)responseObject;
+
+@end
+
 @interface ACNetworkingManager : NSObject
 
 /** AFHTTPSessionManager,用户可以根据自己的需求自定义响应的manager,默认为[AFHTTPSessionManager manager] */
@@ -51,6 +64,12 @@ typedef void(^ACNetworkingCompletion)(NSURLSessionDataTask * _Nullable task, ACN
 /** 结果缓存类,默认为ACNetCache.sharedCache */
 @property (nonatomic, strong, readonly) ACNetCache *responseCache;
 
+/** 解析队列,串行,带decoder的请求在该队列解析结果 */
+@property (nonatomic, strong, readonly) dispatch_queue_t parsingQueue;
+
+/** 回调队列,默认为主队列.设置时会一并设置sessionManager.completionQueue,网络结果和异步读取的缓存结果均在该队列回调 */
+@property (nonatomic, strong, null_resettable) dispatch_queue_t completionQueue;
+
 #pragma mark - Constructor
 
 + (instancetype)manager;
@@ -121,6 +140,28 @@ typedef void(^ACNetworkingCompletion)(NSURLSessionDataTask * _Nullable task, ACN
                               progress:(nullable void (^)(NSProgress *downloadProgress))downloadProgress
                             completion:(ACNetworkingCompletion)completion;
 
+/**
+ get方法,结果在parsingQueue解析为模型后回调,解析出的模型随结果缓存在内存中,再次命中时直接返回模型
+
+ @param URLString URL
+ @param expire 过期时间
+ @param options options
+ @param parameters 请求参数
+ @param generator 缓存key生成器
+ @param decoder 结果解析器,nil时回调原始结果
+ @param downloadProgress progress
+ @param completion 结果回调
+ @return dataTask
+ */
+- (nullable NSURLSessionDataTask *)get:(NSString *)URLString
+                               expires:(Expire_Time)expire
+                               options:(ACNetworkingFetchOption)options
+                            parameters:(nullable NSDictionary *)parameters
+                          keyGenerator:(nullable ACNetCacheKeyGenerator)generator
+                               decoder:(nullable Class<ACNetworkingResponseDecoding>)decoder
+                              progress:(nullable void (^)(NSProgress *downloadProgress))downloadProgress
+                            completion:(ACNetworkingCompletion)completion;
+
 /**
  post方法
  
@@ -158,6 +199,49 @@ typedef void(^ACNetworkingCompletion)(NSURLSessionDataTask * _Nullable task, ACN
                                progress:(nullable void (^)(NSProgress *uploadProgress))uploadProgress
                              completion:(ACNetworkingCompletion)completion;
 
+/**
+ post方法,结果在parsingQueue解析为模型后回调,解析出的模型随结果缓存在内存中,再次命中时直接返回模型
+ 
+ @param URLString URL
+ @param expire 过期时间
+ @param options options
+ @param parameters 请求参数
+ @param generator 缓存key生成器
+ @param decoder 结果解析器,nil时回调原始结果
+ @param uploadProgress progress
+ @param completion 结果回调
+ @return dataTask
+ */
+- (nullable NSURLSessionDataTask *)post:(NSString *)URLString
+                                expires:(Expire_Time)expire
+                                options:(ACNetworkingFetchOption)options
+                             parameters:(nullable NSDictionary *)parameters
+                           keyGenerator:(nullable ACNetCacheKeyGenerator)generator
+                                decoder:(nullable Class<ACNetworkingResponseDecoding>)decoder
+                               progress:(nullable void (^)(NSProgress *uploadProgress))uploadProgress
+                             completion:(ACNetworkingCompletion)completion;
+
+/**
+ 流式get方法,适用于较大的返回结果.数据边接收边写入临时文件,请求成功后直接提交为磁盘缓存,失败则丢弃,
+ 不会在内存中同时保留原始数据和归档数据.读取本地缓存的逻辑与get方法相同,网络结果回调中的task为nil,可通过返回的downloadTask获取响应信息
+
+ @param URLString URL
+ @param expire 过期时间
+ @param options options
+ @param parameters 请求参数
+ @param generator 缓存key生成器
+ @param downloadProgress progress
+ @param completion 结果回调
+ @return downloadTask
+ */
+- (nullable NSURLSessionDownloadTask *)download:(NSString *)URLString
+                                        expires:(Expire_Time)expire
+                                        options:(ACNetworkingFetchOption)options
+                                     parameters:(nullable NSDictionary *)parameters
+                                   keyGenerator:(nullable ACNetCacheKeyGenerator)generator
+                                       progress:(nullable void (^)(NSProgress *downloadProgress))downloadProgress
+                                     completion:(ACNetworkingCompletion)completion;
+
 /** API说明
  以下封装的便利方法均采用self.responseCache.keyGenerator生成存储key,若需要单独生成key请使用上面的方法.
  1.get/post+Net:只走网络请求,不读取本地缓存
@@ -10,7 +10,9 @@
 
 typedef NS_ENUM(NSUInteger, ACNetworkingMethod) {
     ACNetworkingMethodGet,
-    ACNetworkingMethodPost
+    ACNetworkingMethodPost,
+    /** 流式写入缓存的GET */
+    ACNetworkingMethodDownload
 };
 
 @implementation ACNetworkingManager
@@ -33,6 +35,7 @@ typedef NS_ENUM(NSUInteger, ACNetworkingMethod) {
     if (self = [super init]) {
         _sessionManager = sessionManager;
         _responseCache = responseCache;
+        _parsingQueue = dispatch_queue_create("com.acnetworking.parsing", DISPATCH_QUEUE_SERIAL);
     }
     return self;
 }
@@ -41,6 +44,17 @@ typedef NS_ENUM(NSUInteger, ACNetworkingMethod) {
     return [self initWithSessionManager:[AFHTTPSessionManager manager] responseCache:ACNetCache.sharedCache];
 }
 
+#pragma mark - Accessor
+
+- (void)setCompletionQueue:(dispatch_queue_t)completionQueue {
+    _completionQueue = completionQueue;
+    self.sessionManager.completionQueue = completionQueue;
+}
+
+- (dispatch_queue_t)completionQueue {
+    return _completionQueue ?: dispatch_get_main_queue();
+}
+
 #pragma mark - GET
 
 /**
@@ -70,6 +84,24 @@ typedef NS_ENUM(NSUInteger, ACNetworkingMethod) {
  @return 生成的task
  */
 - (NSURLSessionDataTask *)get:(NSString *)URLString expires:(Expire_Time)expire options:(ACNetworkingFetchOption)options parameters:(NSDictionary *)parameters keyGenerator:(ACNetCacheKeyGenerator)generator progress:(void (^)(NSProgress * _Nonnull))downloadProgress completion:(ACNetworkingCompletion)completion {
+    return [self get:URLString expires:expire options:options parameters:parameters keyGenerator:generator decoder:nil progress:downloadProgress completion:completion];
+}
+
+/**
+ 获取Get数据并解析为模型
+ 
+ @param URLString url
+ @param expire 过期时间
+ @param options option
+ @param parameters 请求参数
+ @param generator 存储key生成器
+ @param decoder 结果解析器
+ @param downloadProgress 下载进度
+ @param completion 回调
+ @return 生成的task
+ */
+- (NSURLSessionDataTask *)get:(NSString *)URLString expires:(Expire_Time)expire options:(ACNetworkingFetchOption)options parameters:(NSDictionary *)parameters keyGenerator:(ACNetCacheKeyGenerator)generator decoder:(Class<ACNetworkingResponseDecoding>)decoder progress:(void (^)(NSProgress * _Nonnull))downloadProgress completion:(ACNetworkingCompletion)completion {
+    completion = [self decodingCompletion:completion decoder:decoder forUrl:URLString param:parameters options:options keyGenerator:generator];
     return [self fetch:URLString method:ACNetworkingMethodGet expires:expire options:options param:parameters keyGenerator:generator progress:downloadProgress completion:completion];
 }
 
@@ -86,10 +118,12 @@ typedef NS_ENUM(NSUInteger, ACNetworkingMethod) {
  */
 - (NSURLSessionDataTask *)getTask:(NSString *)URLString expires:(Expire_Time)expire options:(ACNetworkingFetchOption)options parameters:(NSDictionary *)parameters keyGenerator:(ACNetCacheKeyGenerator)generator progress:(void (^)(NSProgress * _Nonnull))downloadProgress completion:(ACNetworkingCompletion)completion {
     __weak typeof(self) weakSelf = self;
+    /** 请求期间清空过缓存时,结果不再写入缓存 */
+    NSUInteger generation = self.responseCache.generation;
     return [self.sessionManager GET:URLString parameters:parameters progress:downloadProgress success:^(NSURLSessionDataTask * _Nonnull task, id  _Nullable responseObject) {
-        [weakSelf handleHttpSucceessForUrl:URLString parames:parameters task:task responseObject:responseObject expires:expire options:options keyGenerator:generator completion:completion];
+        [weakSelf handleHttpSucceessForUrl:URLString parames:parameters task:task responseObject:responseObject expires:expire options:options keyGenerator:generator generation:generation completion:completion];
     } failure:^(NSURLSessionDataTask * _Nullable task, NSError * _Nonnull error) {
-        [weakSelf handleHttpFailureForUrl:URLString parames:parameters task:task error:error expires:expire options:options keyGenerator:generator completion:completion];
+        [weakSelf handleHttpFailureForUrl:URLString parames:parameters task:task error:error failureType:ACNetCacheTypeNone expires:expire options:options keyGenerator:generator generation:generation completion:completion];
     }];
 }
 
@@ -124,6 +158,24 @@ typedef NS_ENUM(NSUInteger, ACNetworkingMethod) {
  @return 生成的task
  */
 - (NSURLSessionDataTask *)post:(NSString *)URLString expires:(Expire_Time)expire options:(ACNetworkingFetchOption)options parameters:(NSDictionary *)parameters keyGenerator:(ACNetCacheKeyGenerator)generator progress:(void (^)(NSProgress * _Nonnull))uploadProgress completion:(ACNetworkingCompletion)completion {
+    return [self post:URLString expires:expire options:options parameters:parameters keyGenerator:generator decoder:nil progress:uploadProgress completion:completion];
+}
+
+/**
+ 获取POST数据并解析为模型
+ 
+ @param URLString url
+ @param expire 过期时间
+ @param options option
+ @param parameters 请求参数
+ @param generator 存储key生成器
+ @param decoder 结果解析器
+ @param uploadProgress 上传进度
+ @param completion 回调
+ @return 生成的task
+ */
+- (NSURLSessionDataTask *)post:(NSString *)URLString expires:(Expire_Time)expire options:(ACNetworkingFetchOption)options parameters:(NSDictionary *)parameters keyGenerator:(ACNetCacheKeyGenerator)generator decoder:(Class<ACNetworkingResponseDecoding>)decoder progress:(void (^)(NSProgress * _Nonnull))uploadProgress completion:(ACNetworkingCompletion)completion {
+    completion = [self decodingCompletion:completion decoder:decoder forUrl:URLString param:parameters options:options keyGenerator:generator];
     return [self fetch:URLString method:ACNetworkingMethodPost expires:expire options:options param:parameters keyGenerator:generator progress:uploadProgress completion:completion];
 }
 
@@ -140,13 +192,115 @@ typedef NS_ENUM(NSUInteger, ACNetworkingMethod) {
  */
 - (NSURLSessionDataTask *)postTask:(NSString *)URLString expires:(Expire_Time)expire options:(ACNetworkingFetchOption)options parameters:(NSDictionary *)parameters keyGenerator:(ACNetCacheKeyGenerator)generator progress:(void (^)(NSProgress * _Nonnull))uploadProgress completion:(ACNetworkingCompletion)completion {
     __weak typeof(self) weakSelf = self;
+    /** 请求期间清空过缓存时,结果不再写入缓存 */
+    NSUInteger generation = self.responseCache.generation;
     return [self.sessionManager POST:URLString parameters:parameters progress:uploadProgress success:^(NSURLSessionDataTask * _Nonnull task, id  _Nullable responseObject) {
-        [weakSelf handleHttpSucceessForUrl:URLString parames:parameters task:task responseObject:responseObject expires:expire options:options keyGenerator:generator completion:completion];
+        [weakSelf handleHttpSucceessForUrl:URLString parames:parameters task:task responseObject:responseObject expires:expire options:options keyGenerator:generator generation:generation completion:completion];
     } failure:^(NSURLSessionDataTask * _Nullable task, NSError * _Nonnull error) {
-        [weakSelf handleHttpFailureForUrl:URLString parames:parameters task:task error:error expires:expire options:options keyGenerator:generator completion:completion];
+        [weakSelf handleHttpFailureForUrl:URLString parames:parameters task:task error:error failureType:ACNetCacheTypeNone expires:expire options:options keyGenerator:generator generation:generation completion:completion];
     }];
 }
 
+#pragma mark - DOWNLOAD
+
+/**
+ 流式获取Get数据
+
+ @param URLString url
+ @param expire 过期时间
+ @param options option
+ @param parameters 请求参数
+ @param generator 存储key生成器
+ @param downloadProgress 下载进度
+ @param completion 回调
+ @return 生成的task
+ */
+- (NSURLSessionDownloadTask *)download:(NSString *)URLString expires:(Expire_Time)expire options:(ACNetworkingFetchOption)options parameters:(NSDictionary *)parameters keyGenerator:(ACNetCacheKeyGenerator)generator progress:(void (^)(NSProgress * _Nonnull))downloadProgress completion:(ACNetworkingCompletion)completion {
+    return [self fetch:URLString method:ACNetworkingMethodDownload expires:expire options:options param:parameters keyGenerator:generator progress:downloadProgress completion:completion];
+}
+
+/**
+ 发起流式Get请求,数据写入缓存目录下的临时文件
+
+ @param URLString url
+ @param expire 过期时间
+ @param options option
+ @param parameters 请求参数
+ @param generator 存储key生成器
+ @param downloadProgress 下载进度
+ @param completion 回调
+ @return 生成的task
+ */
+- (NSURLSessionDownloadTask *)downloadTask:(NSString *)URLString expires:(Expire_Time)expire options:(ACNetworkingFetchOption)options parameters:(NSDictionary *)parameters keyGenerator:(ACNetCacheKeyGenerator)generator progress:(void (^)(NSProgress * _Nonnull))downloadProgress completion:(ACNetworkingCompletion)completion {
+    NSError *serializationError = nil;
+    NSString *absoluteString = [[NSURL URLWithString:URLString relativeToURL:self.sessionManager.baseURL] absoluteString];
+    NSMutableURLRequest *request = [self.sessionManager.requestSerializer requestWithMethod:@"GET" URLString:absoluteString parameters:parameters error:&serializationError];
+    if (serializationError) {
+        dispatch_async(self.completionQueue, ^{
+            if (completion) completion(nil, ACNetCacheTypeNone, nil, serializationError, nil);
+        });
+        return nil;
+    }
+    NSString *filePath = [self.responseCache temporaryFilePathForStreaming];
+    NSUInteger generation = self.responseCache.generation;
+    __weak typeof(self) weakSelf = self;
+    NSURLSessionDownloadTask *task = [self.sessionManager downloadTaskWithRequest:request progress:downloadProgress destination:^NSURL * _Nonnull(NSURL * _Nonnull targetPath, NSURLResponse * _Nonnull response) {
+        return [NSURL fileURLWithPath:filePath];
+    } completionHandler:^(NSURLResponse * _Nonnull response, NSURL * _Nullable fileURL, NSError * _Nullable error) {
+        __strong typeof(weakSelf) strongSelf = weakSelf;
+        if (!strongSelf) {
+            [[NSFileManager defaultManager] removeItemAtPath:filePath error:NULL];
+            return;
+        }
+        [strongSelf handleStreamedFileAtPath:filePath response:response error:error forUrl:URLString parames:parameters expires:expire options:options keyGenerator:generator generation:generation completion:completion];
+    }];
+    [task resume];
+    return task;
+}
+
+/**
+ 处理流式请求结果:成功则解析文件并提交为磁盘缓存,失败则删除文件并按请求失败处理.
+ 解析在后台队列进行,文件以内存映射方式读取
+
+ @param filePath 临时文件路径
+ @param urlResponse 响应
+ @param error 请求error(含状态码校验失败)
+ @param url url
+ @param parameters 请求参数
+ @param expire 过期时间
+ @param options option
+ @param generator 存储key生成器
+ @param generation 发出请求时缓存的generation
+ @param completion 回调
+ */
+- (void)handleStreamedFileAtPath:(NSString *)filePath response:(NSURLResponse *)urlResponse error:(NSError *)error forUrl:(NSString *)url parames:(NSDictionary *)parameters expires:(Expire_Time)expire options:(ACNetworkingFetchOption)options keyGenerator:(ACNetCacheKeyGenerator)generator generation:(NSUInteger)generation completion:(ACNetworkingCompletion)completion {
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        NSError *responseError = error;
+        id responseObject = nil;
+        if (!responseError) {
+            NSData *data = [NSData dataWithContentsOfFile:filePath options:NSDataReadingMappedIfSafe error:&responseError];
+            if (data) responseObject = [self.sessionManager.responseSerializer responseObjectForResponse:urlResponse data:data error:&responseError];
+        }
+        if (responseError) {
+            [[NSFileManager defaultManager] removeItemAtPath:filePath error:NULL];
+            NSInteger statusCode = [self statusCodeForResponse:urlResponse];
+            if ([self.responseCache.negativeCacheStatusCodes containsIndex:statusCode]) [self.responseCache storeFailure:responseError statusCode:statusCode forUrl:url param:parameters keyGenerator:generator generation:generation];
+            dispatch_async(self.completionQueue, ^{
+                [self handleHttpFailureForUrl:url parames:parameters task:nil error:responseError failureType:ACNetCacheTypeNone expires:expire options:options keyGenerator:generator generation:generation completion:completion];
+            });
+            return;
+        }
+        BOOL updateCache = !(options & ACNetworkingFetchOptionNotUpdateCache) && !(options & ACNetworkingFetchOptionDeleteCache);
+        if (!updateCache || ![self.responseCache storeStreamedFileAtPath:filePath response:responseObject forUrl:url param:parameters keyGenerator:generator generation:generation]) {
+            [[NSFileManager defaultManager] removeItemAtPath:filePath error:NULL];
+        }
+        dispatch_async(self.completionQueue, ^{
+            if (completion) completion(nil, ACNetCacheTypeNet, responseObject, nil, nil);
+            if (options & ACNetworkingFetchOptionDeleteCache) [self.responseCache deleteResponseForUrl:url param:parameters keyGenerator:generator];
+        });
+    });
+}
+
 #pragma mark - Main
 /**
  根据传入的method和options发起(post/get)请求,或获取本地数据
@@ -159,9 +313,9 @@ typedef NS_ENUM(NSUInteger, ACNetworkingMethod) {
  @param generator 缓存key生成器
  @param progress progress
  @param completion 回调
- @return dataTask(未发起请求则返回nil)
+ @return task(未发起请求则返回nil)
  */
-- (NSURLSessionDataTask *)fetch:(NSString *)URLString method:(ACNetworkingMethod)method expires:(Expire_Time)expire options:(ACNetworkingFetchOption)options param:(NSDictionary *)parameters keyGenerator:(ACNetCacheKeyGenerator)generator progress:(void (^)(NSProgress * _Nonnull))progress completion:(ACNetworkingCompletion)completion {
+- (__kindof NSURLSessionTask *)fetch:(NSString *)URLString method:(ACNetworkingMethod)method expires:(Expire_Time)expire options:(ACNetworkingFetchOption)options param:(NSDictionary *)parameters keyGenerator:(ACNetCacheKeyGenerator)generator progress:(void (^)(NSProgress * _Nonnull))progress completion:(ACNetworkingCompletion)completion {
     if ([self shouldFetchLocalResponseForUrl:URLString options:options param:parameters keyGenerator:generator expires:expire]) {
         __weak typeof(self) weakSelf = self;
         /**
@@ -169,7 +323,7 @@ typedef NS_ENUM(NSUInteger, ACNetworkingMethod) {
          2.未传入以上二者,则意味着必然传入了LocalAndNet,需要同步获取本地缓存,并且创建一个新的网络请求,返回对应的task
          */
         BOOL async = options & ACNetworkingFetchOptionLocalOnly || options & ACNetworkingFetchOptionLocalFirst;
-        [self.responseCache fetchResponseForUrl:URLString param:parameters keyGenerator:generator expires:expire async:async completion:^(ACNetCacheType type, id response, NSDate *cacheDate) {
+        [self.responseCache fetchResponseForUrl:URLString param:parameters keyGenerator:generator expires:expire async:async completionQueue:self.completionQueue completion:^(ACNetCacheType type, id response, NSDate *cacheDate) {
             NSError *error = nil;
             if (type == ACNetCacheTypeNone) error = [NSError errorWithDomain:@"com.acnetworking.expire" code:404 userInfo:@{NSLocalizedDescriptionKey: @"本地无缓存或缓存已过期!"}];
             if (completion) completion(nil, type, response, error, cacheDate);
@@ -177,16 +331,42 @@ typedef NS_ENUM(NSUInteger, ACNetworkingMethod) {
         }];
         /** 同步读取本地缓存,意味着未传LocalOnly或者LocalFirst,传了LocalAndNet,需要新建一个网络请求返回. */
         if (!async) {
-            if (method == ACNetworkingMethodGet) {
-                return [self getTask:URLString expires:expire options:options parameters:parameters keyGenerator:generator progress:progress completion:completion];
-            } else {
-                return [self postTask:URLString expires:expire options:options parameters:parameters keyGenerator:generator progress:progress completion:completion];
-            }
+            return [self requestTask:URLString method:method expires:expire options:options param:parameters keyGenerator:generator progress:progress completion:completion];
         } else {
             return nil;
         }
-    } else if (method == ACNetworkingMethodGet) {
+    } else {
+        return [self requestTask:URLString method:method expires:expire options:options param:parameters keyGenerator:generator progress:progress completion:completion];
+    }
+}
+
+/**
+ 发起网络请求,若缓存了该请求的失败结果,则直接按请求失败处理,不再请求网络
+
+ @param URLString URL
+ @param method method(get/post)
+ @param expire 过期时长
+ @param options options
+ @param parameters 请求传参
+ @param generator 缓存key生成器
+ @param progress progress
+ @param completion 回调
+ @return task(命中失败缓存则返回nil)
+ */
+- (__kindof NSURLSessionTask *)requestTask:(NSString *)URLString method:(ACNetworkingMethod)method expires:(Expire_Time)expire options:(ACNetworkingFetchOption)options param:(NSDictionary *)parameters keyGenerator:(ACNetCacheKeyGenerator)generator progress:(void (^)(NSProgress * _Nonnull))progress completion:(ACNetworkingCompletion)completion {
+    NSError *failure = options & ACNetworkingFetchOptionNetOnly ? nil : [self.responseCache failureForUrl:URLString param:parameters keyGenerator:generator];
+    if (failure) {
+        /** 与网络请求一样异步回调,不在调用方的线程中同步执行completion */
+        NSUInteger generation = self.responseCache.generation;
+        dispatch_async(self.completionQueue, ^{
+            [self handleHttpFailureForUrl:URLString parames:parameters task:nil error:failure failureType:ACNetCacheTypeNegative expires:expire options:options keyGenerator:generator generation:generation completion:completion];
+        });
+        return nil;
+    }
+    if (method == ACNetworkingMethodGet) {
         return [self getTask:URLString expires:expire options:options parameters:parameters keyGenerator:generator progress:progress completion:completion];
+    } else if (method == ACNetworkingMethodDownload) {
+        return [self downloadTask:URLString expires:expire options:options parameters:parameters keyGenerator:generator progress:progress completion:completion];
     } else {
         return [self postTask:URLString expires:expire options:options parameters:parameters keyGenerator:generator progress:progress completion:completion];
     }
@@ -201,12 +381,20 @@ typedef NS_ENUM(NSUInteger, ACNetworkingMethod) {
  @param response 返回结果
  @param expire 过期时间
  @param options option
+ @param generation 发出请求时缓存的generation,此后清空过缓存则不写入
  @param completion 回调
  */
-- (void)handleHttpSucceessForUrl:(NSString *)url parames:(NSDictionary *)parameters task:(NSURLSessionDataTask *)task responseObject:(id)response expires:(Expire_Time)expire options:(ACNetworkingFetchOption)options keyGenerator:(ACNetCacheKeyGenerator)generator completion:(ACNetworkingCompletion)completion {
+- (void)handleHttpSucceessForUrl:(NSString *)url parames:(NSDictionary *)parameters task:(NSURLSessionDataTask *)task responseObject:(id)response expires:(Expire_Time)expire options:(ACNetworkingFetchOption)options keyGenerator:(ACNetCacheKeyGenerator)generator generation:(NSUInteger)generation completion:(ACNetworkingCompletion)completion {
     if (completion) completion(task, ACNetCacheTypeNet, response, nil, nil);
     if(options & ACNetworkingFetchOptionDeleteCache) return [self.responseCache deleteResponseForUrl:url param:parameters keyGenerator:generator];
-    if (!(options & ACNetworkingFetchOptionNotUpdateCache)) [self.responseCache storeResponse:response forUrl:url param:parameters keyGenerator:generator];
+    if (options & ACNetworkingFetchOptionNotUpdateCache) return;
+    if (self.responseCache.negativeCacheEnabled && [self isEmptyResponse:response]) {
+        /** 空结果按失败结果缓存,不覆盖已有的正常缓存 */
+        NSError *error = [NSError errorWithDomain:@"com.acnetworking.empty" code:204 userInfo:@{NSLocalizedDescriptionKey: @"返回结果为空!"}];
+        [self.responseCache storeFailure:error statusCode:[self statusCodeForTask:task] forUrl:url param:parameters keyGenerator:generator generation:generation];
+    } else {
+        [self.responseCache storeResponse:response forUrl:url param:parameters keyGenerator:generator generation:generation];
+    }
 }
 
 /**
@@ -216,25 +404,99 @@ typedef NS_ENUM(NSUInteger, ACNetworkingMethod) {
  @param parameters 请求参数
  @param task 请求task
  @param error error
+ @param failureType 失败时回调的缓存类型(网络失败为None,命中失败缓存为Negative)
  @param expire 过期时间
  @param options option
+ @param generation 发出请求时缓存的generation,此后清空过缓存则不缓存失败结果
  @param completion 回调
  */
-- (void)handleHttpFailureForUrl:(NSString *)url parames:(NSDictionary *)parameters task:(NSURLSessionDataTask *)task error:(NSError *)error expires:(Expire_Time)expire options:(ACNetworkingFetchOption)options keyGenerator:(ACNetCacheKeyGenerator)generator completion:(ACNetworkingCompletion)completion {
+- (void)handleHttpFailureForUrl:(NSString *)url parames:(NSDictionary *)parameters task:(NSURLSessionDataTask *)task error:(NSError *)error failureType:(ACNetCacheType)failureType expires:(Expire_Time)expire options:(ACNetworkingFetchOption)options keyGenerator:(ACNetCacheKeyGenerator)generator generation:(NSUInteger)generation completion:(ACNetworkingCompletion)completion {
+    NSInteger statusCode = [self statusCodeForTask:task];
+    if (failureType == ACNetCacheTypeNone && [self.responseCache.negativeCacheStatusCodes containsIndex:statusCode]) [self.responseCache storeFailure:error statusCode:statusCode forUrl:url param:parameters keyGenerator:generator generation:generation];
     if (options & ACNetworkingFetchOptionNetOnly || options & ACNetworkingFetchOptionLocalFirst || options & ACNetworkingFetchOptionLocalAndNet) {
         //只读网络、优先读本地、先读本地再取网络,直接回调(优先读本地或先读本地走到失败意味着本地没有缓存)
-        if(completion) completion(task, ACNetCacheTypeNone, nil, error, nil);
+        if(completion) completion(task, failureType, nil, error, nil);
         if(options & ACNetworkingFetchOptionDeleteCache) [self.responseCache deleteResponseForUrl:url param:parameters keyGenerator:generator];
     } else {
         __weak typeof(self) weakSelf = self;
-        [self.responseCache fetchResponseForUrl:url param:parameters expires:expire completion:^(ACNetCacheType type, id response, NSDate *cacheDate) {
-            if(completion) completion(nil, type, response, type == ACNetCacheTypeNone ? error : nil, cacheDate);
+        [self.responseCache fetchResponseForUrl:url param:parameters keyGenerator:generator expires:expire async:YES completionQueue:self.completionQueue completion:^(ACNetCacheType type, id response, NSDate *cacheDate) {
+            if (type == ACNetCacheTypeNone) type = failureType;
+            if(completion) completion(nil, type, response, type == failureType ? error : nil, cacheDate);
             if(options & ACNetworkingFetchOptionDeleteCache) [weakSelf.responseCache deleteResponseForUrl:url param:parameters keyGenerator:generator];
         }];
     }
 }
 
 
+/**
+ 包装回调,将结果在parsingQueue解析为模型后再回调.
+ 内存命中且已有对应模型时直接回调模型;其余结果解析后缓存模型(DeleteCache及NotUpdateCache的网络结果除外)
+
+ @param completion 原回调
+ @param decoder 结果解析器,nil时直接返回原回调
+ @param url url
+ @param parameters 请求参数
+ @param options option
+ @param generator 存储key生成器
+ @return 包装后的回调
+ */
+- (ACNetworkingCompletion)decodingCompletion:(ACNetworkingCompletion)completion decoder:(Class<ACNetworkingResponseDecoding>)decoder forUrl:(NSString *)url param:(NSDictionary *)parameters options:(ACNetworkingFetchOption)options keyGenerator:(ACNetCacheKeyGenerator)generator {
+    if (!decoder || !completion) return completion;
+    NSString *decoderName = NSStringFromClass(decoder);
+    __weak typeof(self) weakSelf = self;
+    return ^(NSURLSessionDataTask * _Nullable task, ACNetCacheType type, id  _Nullable responseObject, NSError * _Nullable error, NSDate * _Nullable cacheDate) {
+        __strong typeof(weakSelf) strongSelf = weakSelf;
+        if (!strongSelf || !responseObject || error) return completion(task, type, responseObject, error, cacheDate);
+        if (type == ACNetCacheTypeMemroy) {
+            id model = [strongSelf.responseCache modelForUrl:url param:parameters keyGenerator:generator decoder:decoderName expires:Expire_Time_Never cacheDate:NULL];
+            if (model) return completion(task, type, model, nil, cacheDate);
+        }
+        BOOL cacheModel = !(options & ACNetworkingFetchOptionDeleteCache) && !(type == ACNetCacheTypeNet && options & ACNetworkingFetchOptionNotUpdateCache);
+        dispatch_async(strongSelf.parsingQueue, ^{
+            id model = [decoder ac_modelWithResponse:responseObject];
+            if (model && cacheModel) [strongSelf.responseCache storeModel:model decoder:decoderName forResponse:responseObject cacheDate:cacheDate url:url param:parameters keyGenerator:generator];
+            NSError *decodeError = model ? nil : [NSError errorWithDomain:@"com.acnetworking.decode" code:-1 userInfo:@{NSLocalizedDescriptionKey: @"结果解析失败!"}];
+            dispatch_async(strongSelf.completionQueue, ^{
+                completion(task, type, model, decodeError, cacheDate);
+            });
+        });
+    };
+}
+
+/**
+ 获取task对应的HTTP状态码
+
+ @param task 请求task
+ @return 状态码,无HTTP返回则为0
+ */
+- (NSInteger)statusCodeForTask:(NSURLSessionTask *)task {
+    return [self statusCodeForResponse:task.response];
+}
+
+/**
+ 获取响应的HTTP状态码
+
+ @param response 响应
+ @return 状态码,非HTTP响应则为0
+ */
+- (NSInteger)statusCodeForResponse:(NSURLResponse *)response {
+    if (![response isKindOfClass:NSHTTPURLResponse.class]) return 0;
+    return ((NSHTTPURLResponse *)response).statusCode;
+}
+
+/**
+ 判断返回结果是否为空
+
+ @param response 返回结果
+ @return 是否为空
+ */
+- (BOOL)isEmptyResponse:(id)response {
+    if (!response || response == NSNull.null) return YES;
+    if ([response respondsToSelector:@selector(count)]) return [response count] == 0;
+    if ([response respondsToSelector:@selector(length)]) return [response length] == 0;
+    return NO;
+}
+
 /**
  判断请求是否需要读取本地缓存
 
@@ -0,0 +1,30 @@
+//
+//  ACBenchmark.h
+//  ACNetworkingDemo
+//
+//  Created by Allen on 2019/3/11.
+//  Copyright © 2019 Allen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** 基准测试,结果输出到控制台 */
+@interface ACBenchmark : NSObject
+
+/**
+ AFJSONResponseSerializer去除null的耗时,分别对不含null、少量null、大量null的1MB/5MB JSON,
+ 比较不去除null、逐层复制(旧实现)与只复制含null的子树(当前实现)
+ */
++ (void)runNullStrippingBenchmark;
+
+/**
+ ACJSONParser的校验与吞吐:先以边界用例及生成的数据校验结果与NSJSONSerialization(去除null时与AFJSONResponseSerializer)一致,
+ 再比较NSJSONSerialization、逐字节索引与SIMD索引解析1MB/5MB JSON的吞吐
+ */
++ (void)runJSONParserBenchmark;
+
+@end
+
+NS_ASSUME_NONNULL_END
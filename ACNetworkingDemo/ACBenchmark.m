@@ -0,0 +1,223 @@
+//
+//  ACBenchmark.m
+//  ACNetworkingDemo
+//
+//  Created by Allen on 2019/3/11.
+//  Copyright © 2019 Allen. All rights reserved.
+//
+
+#import "ACBenchmark.h"
+#import <AFNetworking.h>
+#import "ACJSONParser.h"
+#import "ACJSONResponseSerializer.h"
+#include <mach/mach_time.h>
+
+/** 每组测试的重复次数,取中位数 */
+static NSUInteger const ACBenchmarkIterations = 9;
+
+/**
+ mach_absolute_time转换为毫秒
+
+ @param ticks mach_absolute_time差值
+ @return 毫秒
+ */
+static double ACMillisecondsFromTicks(uint64_t ticks) {
+    static mach_timebase_info_data_t timebase;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        mach_timebase_info(&timebase);
+    });
+    return (double)ticks * timebase.numer / timebase.denom / NSEC_PER_MSEC;
+}
+
+/**
+ AFNetworking原有的去除null实现,逐层复制所有容器,作为对照
+
+ @param JSONObject JSON对象
+ @return 去除null后的对象
+ */
+static id ACLegacyJSONObjectByRemovingKeysWithNullValues(id JSONObject) {
+    if ([JSONObject isKindOfClass:[NSArray class]]) {
+        NSMutableArray *mutableArray = [NSMutableArray arrayWithCapacity:[(NSArray *)JSONObject count]];
+        for (id value in (NSArray *)JSONObject) {
+            [mutableArray addObject:ACLegacyJSONObjectByRemovingKeysWithNullValues(value)];
+        }
+        return [NSArray arrayWithArray:mutableArray];
+    } else if ([JSONObject isKindOfClass:[NSDictionary class]]) {
+        NSMutableDictionary *mutableDictionary = [NSMutableDictionary dictionaryWithDictionary:JSONObject];
+        for (id <NSCopying> key in [(NSDictionary *)JSONObject allKeys]) {
+            id value = (NSDictionary *)JSONObject[key];
+            if (!value || [value isEqual:[NSNull null]]) {
+                [mutableDictionary removeObjectForKey:key];
+            } else if ([value isKindOfClass:[NSArray class]] || [value isKindOfClass:[NSDictionary class]]) {
+                mutableDictionary[key] = ACLegacyJSONObjectByRemovingKeysWithNullValues(value);
+            }
+        }
+        return [NSDictionary dictionaryWithDictionary:mutableDictionary];
+    }
+    return JSONObject;
+}
+
+@implementation ACBenchmark
+
++ (void)runNullStrippingBenchmark {
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:[NSURL URLWithString:@"http://127.0.0.1/feed"] statusCode:200 HTTPVersion:@"HTTP/1.1" headerFields:@{@"Content-Type": @"application/json"}];
+    AFJSONResponseSerializer *plainSerializer = [AFJSONResponseSerializer serializer];
+    AFJSONResponseSerializer *strippingSerializer = [AFJSONResponseSerializer serializer];
+    strippingSerializer.removesKeysWithNullValues = YES;
+    for (NSNumber *megabytes in @[@1, @5]) {
+        /** 每隔nullInterval条记录有一条含null,0为不含null */
+        for (NSNumber *nullInterval in @[@0, @100, @1]) {
+            NSData *data = [self feedDataOfSize:megabytes.unsignedIntegerValue * 1024 * 1024 nullInterval:nullInterval.unsignedIntegerValue];
+            double parse = [self medianMillisecondsOfBlock:^{
+                [plainSerializer responseObjectForResponse:response data:data error:NULL];
+            }];
+            double legacy = [self medianMillisecondsOfBlock:^{
+                ACLegacyJSONObjectByRemovingKeysWithNullValues([plainSerializer responseObjectForResponse:response data:data error:NULL]);
+            }];
+            double stripping = [self medianMillisecondsOfBlock:^{
+                [strippingSerializer responseObjectForResponse:response data:data error:NULL];
+            }];
+            NSLog(@"NullStripping %@MB null/%@: parse %.2fms, legacy strip %.2fms, strip %.2fms", megabytes, nullInterval.unsignedIntegerValue ? nullInterval : @"none", parse, legacy, stripping);
+        }
+    }
+}
+
++ (void)runJSONParserBenchmark {
+    NSUInteger failures = [self verifyJSONParser];
+    NSLog(@"JSONParser %@: %lu mismatches", ACJSONParser.instructionSet, (unsigned long)failures);
+    for (NSNumber *megabytes in @[@1, @5]) {
+        NSData *data = [self feedDataOfSize:megabytes.unsignedIntegerValue * 1024 * 1024 nullInterval:100];
+        double foundation = [self medianMillisecondsOfBlock:^{
+            [NSJSONSerialization JSONObjectWithData:data options:0 error:NULL];
+        }];
+        double scalar = [self medianMillisecondsOfBlock:^{
+            [ACJSONParser JSONObjectWithData:data options:0 removesKeysWithNullValues:NO vectorized:NO];
+        }];
+        double vectorized = [self medianMillisecondsOfBlock:^{
+            [ACJSONParser JSONObjectWithData:data options:0 removesKeysWithNullValues:NO vectorized:YES];
+        }];
+        double dataMegabytes = data.length / 1024.0 / 1024.0;
+        NSLog(@"JSONParser %@MB: NSJSONSerialization %.2fms (%.0fMB/s), scalar %.2fms (%.0fMB/s), %@ %.2fms (%.0fMB/s)", megabytes, foundation, dataMegabytes / foundation * 1000, scalar, dataMegabytes / scalar * 1000, ACJSONParser.instructionSet, vectorized, dataMegabytes / vectorized * 1000);
+    }
+}
+
+/**
+ 校验ACJSONParser与NSJSONSerialization、ACJSONResponseSerializer与AFJSONResponseSerializer的结果一致,不一致的用例输出到控制台
+
+ @return 不一致的用例数
+ */
++ (NSUInteger)verifyJSONParser {
+    NSMutableArray<NSData *> *corpus = [NSMutableArray array];
+    NSArray<NSString *> *documents = @[
+        @"{}", @"[]", @" [ ] ", @"{\"a\":{}}", @"[[[[[]]]]]", @"[1,2,3]", @"{\"a\":1,\"b\":[true,false,null]}",
+        @"[0,-0,1,-1,9223372036854775807,-9223372036854775808,18446744073709551615,123456789012345678901234567890]",
+        @"[0.5,-1.25,1e10,1E-5,2.5e+3,3.141592653589793,1.7976931348623157e308,5e-324,0.1,100.0]",
+        @"[\"\",\"a\",\"\\\"\",\"\\\\\",\"\\/\\b\\f\\n\\r\\t\",\"\\u0041\\u00e9\\u4e2d\\ud83d\\ude00\",\"中文😀\",\"\\u0000\"]",
+        @"{\"key with \\\"quote\\\"\":\"value\\\\\",\"k\":\"\\\\\\\\\\\\\\\\\"}",
+        @"\"fragment\"", @"42", @"null", @"true",
+        @"[1,]", @"{\"a\":1,}", @"[01]", @"[1.]", @"[.5]", @"[+1]", @"[1e]", @"[tru]", @"[nul]", @"{\"a\" 1}", @"{a:1}", @"[\"unterminated]",
+        @"[\"\\x\"]", @"[\"\\ud800\"]", @"[\"\\udc00\"]", @"[\"tab\tinside\"]", @"[1] [2]", @"[1]x", @"", @" ", @"\ufeff[1]",
+    ];
+    for (NSString *document in documents) {
+        [corpus addObject:[document dataUsingEncoding:NSUTF8StringEncoding]];
+    }
+    /** 转义、引号、反斜杠落在64字节块边界两侧 */
+    for (NSUInteger padding = 50; padding < 80; padding++) {
+        NSString *prefix = [@"" stringByPaddingToLength:padding withString:@"x" startingAtIndex:0];
+        [corpus addObject:[[NSString stringWithFormat:@"{\"%@\":\"\\\"\\\\\",\"%@\\\\\":[\"%@\\\\\\\"\",null]}", prefix, prefix, prefix] dataUsingEncoding:NSUTF8StringEncoding]];
+        [corpus addObject:[[NSString stringWithFormat:@"[%@%@]", [@"" stringByPaddingToLength:padding withString:@" " startingAtIndex:0], @"12345.678e-3"] dataUsingEncoding:NSUTF8StringEncoding]];
+    }
+    const uint8_t invalidUTF8[] = {'[', '"', 0xC3, 0x28, '"', ']'};
+    [corpus addObject:[NSData dataWithBytes:invalidUTF8 length:sizeof(invalidUTF8)]];
+    NSMutableString *deep = [NSMutableString string];
+    for (NSUInteger i = 0; i < 600; i++) [deep appendString:@"["];
+    for (NSUInteger i = 0; i < 600; i++) [deep appendString:@"]"];
+    [corpus addObject:[deep dataUsingEncoding:NSUTF8StringEncoding]];
+    [corpus addObject:[self feedDataOfSize:256 * 1024 nullInterval:3]];
+
+    NSUInteger failures = 0;
+    NSArray<NSNumber *> *optionsList = @[@0, @(NSJSONReadingAllowFragments), @(NSJSONReadingMutableContainers | NSJSONReadingMutableLeaves | NSJSONReadingAllowFragments)];
+    for (NSData *data in corpus) {
+        for (NSNumber *options in optionsList) {
+            NSJSONReadingOptions readingOptions = options.unsignedIntegerValue;
+            id expected = data.length ? [NSJSONSerialization JSONObjectWithData:data options:readingOptions error:NULL] : nil;
+            for (NSNumber *vectorized in @[@NO, @YES]) {
+                id actual = [ACJSONParser JSONObjectWithData:data options:readingOptions removesKeysWithNullValues:NO vectorized:vectorized.boolValue];
+                /** 解析器放弃的输入会回退,只校验实际解析出的结果 */
+                if (actual && ![actual isEqual:expected]) {
+                    failures++;
+                    NSLog(@"JSONParser mismatch (vectorized %@, options %@): %@", vectorized, options, [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding]);
+                }
+                if (actual && readingOptions & NSJSONReadingMutableContainers && [actual isKindOfClass:[NSArray class]] && ![actual isKindOfClass:[NSMutableArray class]]) {
+                    failures++;
+                    NSLog(@"JSONParser immutable container with NSJSONReadingMutableContainers");
+                }
+            }
+        }
+    }
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:[NSURL URLWithString:@"http://127.0.0.1/feed"] statusCode:200 HTTPVersion:@"HTTP/1.1" headerFields:@{@"Content-Type": @"application/json; charset=utf-8"}];
+    for (NSNumber *removesNulls in @[@NO, @YES]) {
+        AFJSONResponseSerializer *expectedSerializer = [AFJSONResponseSerializer serializerWithReadingOptions:NSJSONReadingAllowFragments];
+        ACJSONResponseSerializer *actualSerializer = [ACJSONResponseSerializer serializerWithReadingOptions:NSJSONReadingAllowFragments];
+        expectedSerializer.removesKeysWithNullValues = actualSerializer.removesKeysWithNullValues = removesNulls.boolValue;
+        for (NSData *data in corpus) {
+            NSError *expectedError = nil, *actualError = nil;
+            id expected = [expectedSerializer responseObjectForResponse:response data:data error:&expectedError];
+            id actual = [actualSerializer responseObjectForResponse:response data:data error:&actualError];
+            if ((expected || actual) && ![actual isEqual:expected]) {
+                failures++;
+                NSLog(@"JSONResponseSerializer mismatch (removesKeysWithNullValues %@): %@", removesNulls, [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding]);
+            }
+            if (!expectedError != !actualError) {
+                failures++;
+                NSLog(@"JSONResponseSerializer error mismatch: %@ / %@", expectedError, actualError);
+            }
+        }
+    }
+    return failures;
+}
+
+/**
+ 生成类似信息流接口的JSON数据
+
+ @param size 目标大小(字节)
+ @param nullInterval 每隔多少条记录有一条含null字段,0为不含null
+ @return JSON数据
+ */
++ (NSData *)feedDataOfSize:(NSUInteger)size nullInterval:(NSUInteger)nullInterval {
+    NSMutableArray *items = [NSMutableArray array];
+    NSUInteger estimatedSize = 0;
+    for (NSUInteger i = 0; estimatedSize < size; i++) {
+        NSMutableDictionary *author = [@{@"id": @(i % 997), @"name": [NSString stringWithFormat:@"user_%lu", (unsigned long)i % 997], @"avatar": [NSString stringWithFormat:@"https://img.example.com/avatar/%lu.jpg", (unsigned long)i % 997], @"verified": @(i % 3 == 0)} mutableCopy];
+        NSMutableDictionary *item = [@{@"id": @(i), @"title": [NSString stringWithFormat:@"Feed item %lu", (unsigned long)i], @"summary": [@"" stringByPaddingToLength:120 withString:@"lorem ipsum " startingAtIndex:0], @"author": author, @"tags": @[@"news", @"tech", @(i % 10)], @"stats": @{@"likes": @(i * 7 % 1000), @"comments": @(i * 3 % 200), @"shares": @(i % 50)}} mutableCopy];
+        if (nullInterval && i % nullInterval == 0) {
+            author[@"avatar"] = [NSNull null];
+            item[@"cover"] = [NSNull null];
+        }
+        [items addObject:item];
+        estimatedSize += 420;
+    }
+    return [NSJSONSerialization dataWithJSONObject:@{@"code": @0, @"message": [NSNull null], @"data": @{@"items": items, @"next": [NSNull null]}} options:0 error:NULL];
+}
+
+/**
+ 重复执行block,返回耗时中位数
+
+ @param block 被测代码
+ @return 毫秒
+ */
++ (double)medianMillisecondsOfBlock:(void (^)(void))block {
+    NSMutableArray<NSNumber *> *samples = [NSMutableArray arrayWithCapacity:ACBenchmarkIterations];
+    for (NSUInteger i = 0; i < ACBenchmarkIterations; i++) {
+        @autoreleasepool {
+            uint64_t start = mach_absolute_time();
+            block();
+            [samples addObject:@(ACMillisecondsFromTicks(mach_absolute_time() - start))];
+        }
+    }
+    [samples sortUsingSelector:@selector(compare:)];
+    return samples[samples.count / 2].doubleValue;
+}
+
+@end
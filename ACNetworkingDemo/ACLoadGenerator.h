@@ -0,0 +1,107 @@
+//
+//  ACLoadGenerator.h
+//  ACNetworkingDemo
+//
+//  Created by Allen on 2019/3/4.
+//  Copyright © 2019 Allen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "ACNetworkingManager.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** 压测请求配置,按weight加权随机回放 */
+@interface ACLoadRequest : NSObject
+
+@property (nonatomic, copy) NSString *URLString;
+
+@property (nonatomic, copy, nullable) NSDictionary *parameters;
+
+/** 请求策略,默认ACNetworkingFetchOptionLocalFirst(即getData:) */
+@property (nonatomic, assign) ACNetworkingFetchOption options;
+
+/** 过期时间,默认Expire_Time_Never */
+@property (nonatomic, assign) Expire_Time expire;
+
+/** 权重,默认1 */
+@property (nonatomic, assign) NSUInteger weight;
+
++ (instancetype)requestWithURLString:(NSString *)URLString parameters:(nullable NSDictionary *)parameters options:(ACNetworkingFetchOption)options weight:(NSUInteger)weight;
+
+@end
+
+/** 压测结果 */
+@interface ACLoadReport : NSObject
+
+@property (nonatomic, assign, readonly) NSUInteger totalRequests;
+
+@property (nonatomic, assign, readonly) NSUInteger failedRequests;
+
+/** 首个回调为内存缓存的请求数 */
+@property (nonatomic, assign, readonly) NSUInteger memoryHits;
+
+/** 首个回调为磁盘缓存的请求数 */
+@property (nonatomic, assign, readonly) NSUInteger diskHits;
+
+/** 首个回调为失败结果缓存的请求数 */
+@property (nonatomic, assign, readonly) NSUInteger negativeHits;
+
+/** 总耗时 */
+@property (nonatomic, assign, readonly) NSTimeInterval duration;
+
+/** 每秒完成的请求数 */
+@property (nonatomic, assign, readonly) double throughput;
+
+/** 缓存命中率(含失败结果缓存) */
+@property (nonatomic, assign, readonly) double cacheHitRatio;
+
+/** 请求耗时分位数(秒) */
+@property (nonatomic, assign, readonly) NSTimeInterval p50Latency;
+
+@property (nonatomic, assign, readonly) NSTimeInterval p90Latency;
+
+@property (nonatomic, assign, readonly) NSTimeInterval p99Latency;
+
+@property (nonatomic, assign, readonly) NSTimeInterval maxLatency;
+
+/** 结束时的常驻内存(字节) */
+@property (nonatomic, assign, readonly) uint64_t residentSize;
+
+/** 压测期间采样到的常驻内存峰值(字节) */
+@property (nonatomic, assign, readonly) uint64_t peakResidentSize;
+
+@end
+
+/**
+ 压测工具,通过ACNetworkingManager并发回放requestMix,统计吞吐、耗时分位数、缓存命中率及内存.
+ 一个请求以其最后一个回调为结束(LocalAndNet会先后回调本地和网络结果).
+ */
+@interface ACLoadGenerator : NSObject
+
+@property (nonatomic, strong, readonly) ACNetworkingManager *manager;
+
+/** 回放的请求集合 */
+@property (nonatomic, copy) NSArray<ACLoadRequest *> *requestMix;
+
+/** 总请求数,默认1000 */
+@property (nonatomic, assign) NSUInteger totalRequests;
+
+/** 同时进行的请求数,默认64 */
+@property (nonatomic, assign) NSUInteger concurrency;
+
+/** 单个请求的超时时间,默认30秒.超时仍未结束(如缓存回调后网络请求迟迟不回调)的请求记为失败,其后的回调忽略 */
+@property (nonatomic, assign) NSTimeInterval requestTimeout;
+
+- (instancetype)initWithManager:(ACNetworkingManager *)manager;
+
+/**
+ 开始压测
+
+ @param completion 结束回调(主线程)
+ */
+- (void)runWithCompletion:(void (^)(ACLoadReport *report))completion;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,289 @@
+//
+//  ACLoadGenerator.m
+//  ACNetworkingDemo
+//
+//  Created by Allen on 2019/3/4.
+//  Copyright © 2019 Allen. All rights reserved.
+//
+
+#import "ACLoadGenerator.h"
+#include <mach/mach.h>
+#include <mach/mach_time.h>
+
+/**
+ 当前进程的常驻内存
+
+ @return 字节数
+ */
+static uint64_t ACResidentSize(void) {
+    struct mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) != KERN_SUCCESS) return 0;
+    return info.resident_size;
+}
+
+/**
+ mach_absolute_time转换为秒
+
+ @param ticks mach_absolute_time差值
+ @return 秒
+ */
+static NSTimeInterval ACSecondsFromTicks(uint64_t ticks) {
+    static mach_timebase_info_data_t timebase;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        mach_timebase_info(&timebase);
+    });
+    return (double)ticks * timebase.numer / timebase.denom / NSEC_PER_SEC;
+}
+
+@implementation ACLoadRequest
+
++ (instancetype)requestWithURLString:(NSString *)URLString parameters:(NSDictionary *)parameters options:(ACNetworkingFetchOption)options weight:(NSUInteger)weight {
+    ACLoadRequest *request = [[self alloc] init];
+    request.URLString = URLString;
+    request.parameters = parameters;
+    request.options = options;
+    request.weight = weight;
+    return request;
+}
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _options = ACNetworkingFetchOptionLocalFirst;
+        _expire = Expire_Time_Never;
+        _weight = 1;
+    }
+    return self;
+}
+
+@end
+
+#pragma mark - Report
+
+@interface ACLoadReport ()
+
+@property (nonatomic, assign, readwrite) NSUInteger totalRequests;
+
+@property (nonatomic, assign, readwrite) NSUInteger failedRequests;
+
+@property (nonatomic, assign, readwrite) NSUInteger memoryHits;
+
+@property (nonatomic, assign, readwrite) NSUInteger diskHits;
+
+@property (nonatomic, assign, readwrite) NSUInteger negativeHits;
+
+@property (nonatomic, assign, readwrite) NSTimeInterval duration;
+
+@property (nonatomic, assign, readwrite) NSTimeInterval p50Latency;
+
+@property (nonatomic, assign, readwrite) NSTimeInterval p90Latency;
+
+@property (nonatomic, assign, readwrite) NSTimeInterval p99Latency;
+
+@property (nonatomic, assign, readwrite) NSTimeInterval maxLatency;
+
+@property (nonatomic, assign, readwrite) uint64_t residentSize;
+
+@property (nonatomic, assign, readwrite) uint64_t peakResidentSize;
+
+@end
+
+@implementation ACLoadReport
+
+- (double)throughput {
+    return self.duration > 0 ? self.totalRequests / self.duration : 0;
+}
+
+- (double)cacheHitRatio {
+    return self.totalRequests > 0 ? (double)(self.memoryHits + self.diskHits + self.negativeHits) / self.totalRequests : 0;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"requests:%lu failed:%lu duration:%.3fs throughput:%.1f/s\nlatency p50:%.2fms p90:%.2fms p99:%.2fms max:%.2fms\ncache hit:%.2f%% (memory:%lu disk:%lu negative:%lu)\nrss:%.1fMB peak:%.1fMB",
+            (unsigned long)self.totalRequests, (unsigned long)self.failedRequests, self.duration, self.throughput,
+            self.p50Latency * 1000, self.p90Latency * 1000, self.p99Latency * 1000, self.maxLatency * 1000,
+            self.cacheHitRatio * 100, (unsigned long)self.memoryHits, (unsigned long)self.diskHits, (unsigned long)self.negativeHits,
+            self.residentSize / 1048576.0, self.peakResidentSize / 1048576.0];
+}
+
+@end
+
+#pragma mark - Record
+
+/** 单个请求的统计 */
+@interface ACLoadRecord : NSObject
+
+@property (nonatomic, assign) uint64_t startTicks;
+
+@property (nonatomic, assign) uint64_t endTicks;
+
+/** 首个回调的缓存类型 */
+@property (nonatomic, assign) ACNetCacheType firstType;
+
+@property (nonatomic, assign) NSUInteger callbackCount;
+
+/** 请求方法是否已返回 */
+@property (nonatomic, assign) BOOL returned;
+
+/** 请求方法是否返回了task,即是否还有一个网络回调 */
+@property (nonatomic, assign) BOOL hasTask;
+
+/** 方法返回后收到的回调数 */
+@property (nonatomic, assign) NSUInteger callbackAfterReturn;
+
+@property (nonatomic, assign) BOOL failed;
+
+@property (nonatomic, assign) BOOL finished;
+
+@end
+
+@implementation ACLoadRecord
+
+/** 需在@synchronized(self)中调用.无法预知回调个数(如LocalFirst命中缓存后是否仍会请求网络),超时由调用方兜底 */
+- (BOOL)shouldFinish {
+    if (self.finished || !self.returned) return NO;
+    return self.hasTask ? self.callbackAfterReturn > 0 : self.callbackCount > 0;
+}
+
+@end
+
+#pragma mark - Generator
+
+@interface ACLoadGenerator ()
+
+@property (nonatomic, strong) dispatch_queue_t issueQueue;
+
+@property (nonatomic, strong) NSMutableArray<ACLoadRecord *> *records;
+
+@end
+
+@implementation ACLoadGenerator
+
+- (instancetype)initWithManager:(ACNetworkingManager *)manager {
+    if (self = [super init]) {
+        _manager = manager;
+        _totalRequests = 1000;
+        _concurrency = 64;
+        _requestTimeout = 30;
+        _issueQueue = dispatch_queue_create("com.acnetworking.loadgenerator", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
+- (void)runWithCompletion:(void (^)(ACLoadReport *))completion {
+    NSArray<ACLoadRequest *> *mix = self.requestMix;
+    NSUInteger total = self.totalRequests;
+    if (mix.count == 0 || total == 0) return;
+    NSUInteger totalWeight = 0;
+    for (ACLoadRequest *request in mix) totalWeight += MAX(request.weight, 1);
+
+    NSMutableArray<ACLoadRecord *> *records = [NSMutableArray arrayWithCapacity:total];
+    dispatch_semaphore_t slots = dispatch_semaphore_create(MAX(self.concurrency, 1));
+    dispatch_group_t group = dispatch_group_create();
+    __block uint64_t peakResidentSize = ACResidentSize();
+    dispatch_source_t sampler = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, self.issueQueue);
+    dispatch_source_set_timer(sampler, DISPATCH_TIME_NOW, 50 * NSEC_PER_MSEC, 10 * NSEC_PER_MSEC);
+    dispatch_source_set_event_handler(sampler, ^{
+        peakResidentSize = MAX(peakResidentSize, ACResidentSize());
+    });
+    dispatch_resume(sampler);
+
+    NSTimeInterval timeout = self.requestTimeout;
+    uint64_t startTicks = mach_absolute_time();
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        for (NSUInteger i = 0; i < total; i++) {
+            dispatch_semaphore_wait(slots, DISPATCH_TIME_FOREVER);
+            ACLoadRequest *request = [self pickRequestFromMix:mix totalWeight:totalWeight];
+            ACLoadRecord *record = [ACLoadRecord new];
+            @synchronized (records) {
+                [records addObject:record];
+            }
+            dispatch_group_enter(group);
+            record.startTicks = mach_absolute_time();
+            NSURLSessionDataTask *task = [self.manager get:request.URLString expires:request.expire options:request.options parameters:request.parameters progress:nil completion:^(NSURLSessionDataTask * _Nullable task, ACNetCacheType type, id  _Nullable responseObject, NSError * _Nullable error, NSDate * _Nullable cacheDate) {
+                BOOL finish = NO;
+                @synchronized (record) {
+                    if (record.finished) return;
+                    if (record.callbackCount++ == 0) record.firstType = type;
+                    if (record.returned) record.callbackAfterReturn++;
+                    record.failed = error != nil;
+                    finish = [record shouldFinish];
+                    if (finish) record.finished = YES;
+                }
+                if (finish) [self finishRecord:record semaphore:slots group:group];
+            }];
+            BOOL finish = NO;
+            @synchronized (record) {
+                record.returned = YES;
+                record.hasTask = task != nil;
+                finish = [record shouldFinish];
+                if (finish) record.finished = YES;
+            }
+            if (finish) [self finishRecord:record semaphore:slots group:group];
+            if (timeout <= 0) continue;
+            dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(timeout * NSEC_PER_SEC)), self.issueQueue, ^{
+                BOOL expired = NO;
+                @synchronized (record) {
+                    expired = !record.finished;
+                    if (expired) {
+                        record.finished = YES;
+                        record.failed = YES;
+                    }
+                }
+                if (expired) [self finishRecord:record semaphore:slots group:group];
+            });
+        }
+        dispatch_group_notify(group, dispatch_get_main_queue(), ^{
+            dispatch_source_cancel(sampler);
+            ACLoadReport *report = [self reportWithRecords:records duration:ACSecondsFromTicks(mach_absolute_time() - startTicks)];
+            report.peakResidentSize = MAX(peakResidentSize, report.residentSize);
+            if (completion) completion(report);
+        });
+    });
+}
+
+- (void)finishRecord:(ACLoadRecord *)record semaphore:(dispatch_semaphore_t)semaphore group:(dispatch_group_t)group {
+    record.endTicks = mach_absolute_time();
+    dispatch_semaphore_signal(semaphore);
+    dispatch_group_leave(group);
+}
+
+- (ACLoadRequest *)pickRequestFromMix:(NSArray<ACLoadRequest *> *)mix totalWeight:(NSUInteger)totalWeight {
+    NSUInteger target = arc4random_uniform((uint32_t)totalWeight);
+    for (ACLoadRequest *request in mix) {
+        NSUInteger weight = MAX(request.weight, 1);
+        if (target < weight) return request;
+        target -= weight;
+    }
+    return mix.lastObject;
+}
+
+- (ACLoadReport *)reportWithRecords:(NSArray<ACLoadRecord *> *)records duration:(NSTimeInterval)duration {
+    ACLoadReport *report = [ACLoadReport new];
+    report.totalRequests = records.count;
+    report.duration = duration;
+    report.residentSize = ACResidentSize();
+    NSMutableArray<NSNumber *> *latencies = [NSMutableArray arrayWithCapacity:records.count];
+    for (ACLoadRecord *record in records) {
+        if (record.failed) report.failedRequests++;
+        if (record.firstType == ACNetCacheTypeMemroy) report.memoryHits++;
+        if (record.firstType == ACNetCacheTypeDisk) report.diskHits++;
+        if (record.firstType == ACNetCacheTypeNegative) report.negativeHits++;
+        [latencies addObject:@(ACSecondsFromTicks(record.endTicks - record.startTicks))];
+    }
+    [latencies sortUsingSelector:@selector(compare:)];
+    report.p50Latency = [self percentile:0.50 ofSortedValues:latencies];
+    report.p90Latency = [self percentile:0.90 ofSortedValues:latencies];
+    report.p99Latency = [self percentile:0.99 ofSortedValues:latencies];
+    report.maxLatency = latencies.lastObject.doubleValue;
+    return report;
+}
+
+- (NSTimeInterval)percentile:(double)percentile ofSortedValues:(NSArray<NSNumber *> *)values {
+    if (values.count == 0) return 0;
+    NSUInteger index = MIN((NSUInteger)ceil(percentile * values.count), values.count) - 1;
+    return values[index].doubleValue;
+}
+
+@end
@@ -0,0 +1,61 @@
+//
+//  ACLoopbackServer.h
+//  ACNetworkingDemo
+//
+//  Created by Allen on 2019/3/4.
+//  Copyright © 2019 Allen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ 本地回环HTTP服务,用于压测ACNetworkingManager.
+ 所有请求均返回JSON,以下属性为默认配置,可以通过query参数逐个请求覆盖:
+ size=字节数, latency=毫秒, error_rate=0~1, status=错误状态码, max_age=秒, etag=0/1
+ */
+@interface ACLoopbackServer : NSObject
+
+/** 监听端口,启动后有效 */
+@property (nonatomic, assign, readonly) uint16_t port;
+
+/** 服务地址,如http://127.0.0.1:port,未启动时为nil */
+@property (nonatomic, strong, readonly, nullable) NSURL *baseURL;
+
+/** 返回body的大小(字节),默认1024 */
+@property (nonatomic, assign) NSUInteger payloadSize;
+
+/** 返回延迟,默认0 */
+@property (nonatomic, assign) NSTimeInterval latency;
+
+/** 返回错误的概率(0~1),默认0 */
+@property (nonatomic, assign) double errorRate;
+
+/** 错误返回的状态码,默认500 */
+@property (nonatomic, assign) NSInteger errorStatusCode;
+
+/** Cache-Control的max-age(秒),小于0时不返回Cache-Control,默认-1 */
+@property (nonatomic, assign) NSInteger maxAge;
+
+/** 是否返回ETag并响应If-None-Match,默认YES */
+@property (nonatomic, assign) BOOL etagEnabled;
+
+/** 已处理的请求数 */
+@property (nonatomic, assign, readonly) NSUInteger requestCount;
+
+/**
+ 启动服务
+
+ @param port 端口,传0则由系统分配
+ @param error 错误
+ @return 是否成功
+ */
+- (BOOL)startOnPort:(uint16_t)port error:(NSError **)error;
+
+/** 停止服务并关闭所有连接 */
+- (void)stop;
+
+@end
+
+NS_ASSUME_NONNULL_END
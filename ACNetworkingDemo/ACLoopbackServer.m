@@ -0,0 +1,366 @@
+//
+//  ACLoopbackServer.m
+//  ACNetworkingDemo
+//
+//  Created by Allen on 2019/3/4.
+//  Copyright © 2019 Allen. All rights reserved.
+//
+
+#import "ACLoopbackServer.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+@class ACLoopbackConnection;
+
+@interface ACLoopbackServer ()
+
+@property (nonatomic, assign, readwrite) uint16_t port;
+
+@property (nonatomic, assign, readwrite) NSUInteger requestCount;
+
+@property (nonatomic, strong) dispatch_queue_t acceptQueue;
+
+@property (nonatomic, strong) dispatch_source_t acceptSource;
+
+@property (nonatomic, strong) NSMutableSet<ACLoopbackConnection *> *connections;
+
+/** 按大小缓存的body,避免每次请求重新生成 */
+@property (nonatomic, strong) NSMutableDictionary<NSNumber *, NSData *> *payloads;
+
+- (NSData *)responseForRequestHead:(NSString *)head delay:(NSTimeInterval *)delay keepAlive:(BOOL *)keepAlive;
+
+- (void)removeConnection:(ACLoopbackConnection *)connection;
+
+@end
+
+#pragma mark - Connection
+
+@interface ACLoopbackConnection : NSObject
+
+@property (nonatomic, assign) int fd;
+
+@property (nonatomic, strong) dispatch_queue_t queue;
+
+@property (nonatomic, strong) dispatch_source_t readSource;
+
+@property (nonatomic, strong) NSMutableData *buffer;
+
+@property (nonatomic, weak) ACLoopbackServer *server;
+
+/** 是否有正在等待返回的请求,一个连接同时只处理一个请求,保证返回顺序 */
+@property (nonatomic, assign) BOOL busy;
+
+@property (nonatomic, assign) BOOL closed;
+
+@end
+
+@implementation ACLoopbackConnection
+
+- (instancetype)initWithFd:(int)fd server:(ACLoopbackServer *)server {
+    if (self = [super init]) {
+        _fd = fd;
+        _server = server;
+        _buffer = [NSMutableData data];
+        _queue = dispatch_queue_create("com.acnetworking.loopback.connection", DISPATCH_QUEUE_SERIAL);
+        _readSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, fd, 0, _queue);
+        __weak typeof(self) weakSelf = self;
+        dispatch_source_set_event_handler(_readSource, ^{
+            [weakSelf readAvailableData];
+        });
+        dispatch_source_set_cancel_handler(_readSource, ^{
+            close(fd);
+        });
+    }
+    return self;
+}
+
+- (void)start {
+    dispatch_resume(self.readSource);
+}
+
+- (void)readAvailableData {
+    if (self.closed) return;
+    char chunk[16 * 1024];
+    ssize_t length = recv(self.fd, chunk, sizeof(chunk), 0);
+    if (length <= 0) return [self close];
+    [self.buffer appendBytes:chunk length:length];
+    [self processBuffer];
+}
+
+/**
+ 从缓冲区中解析出完整的请求并返回,需确保在self.queue中调用
+ */
+- (void)processBuffer {
+    if (self.busy || self.closed) return;
+    NSData *separator = [@"\r\n\r\n" dataUsingEncoding:NSASCIIStringEncoding];
+    NSRange range = [self.buffer rangeOfData:separator options:0 range:NSMakeRange(0, self.buffer.length)];
+    if (range.location == NSNotFound) return;
+    NSUInteger headLength = NSMaxRange(range);
+    NSString *head = [[NSString alloc] initWithBytes:self.buffer.bytes length:range.location encoding:NSUTF8StringEncoding];
+    NSUInteger bodyLength = 0;
+    for (NSString *line in [head componentsSeparatedByString:@"\r\n"]) {
+        if ([line.lowercaseString hasPrefix:@"content-length:"]) bodyLength = (NSUInteger)[[line substringFromIndex:15] integerValue];
+    }
+    /** 请求body未接收完整,等待后续数据 */
+    if (self.buffer.length < headLength + bodyLength) return;
+    [self.buffer replaceBytesInRange:NSMakeRange(0, headLength + bodyLength) withBytes:NULL length:0];
+    NSTimeInterval delay = 0;
+    BOOL keepAlive = YES;
+    NSData *response = [self.server responseForRequestHead:head ?: @"" delay:&delay keepAlive:&keepAlive];
+    self.busy = YES;
+    dispatch_source_suspend(self.readSource);
+    __weak typeof(self) weakSelf = self;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), self.queue, ^{
+        __strong typeof(weakSelf) strongSelf = weakSelf;
+        if (!strongSelf || strongSelf.closed) return;
+        dispatch_resume(strongSelf.readSource);
+        strongSelf.busy = NO;
+        if (![strongSelf writeData:response] || !keepAlive) return [strongSelf close];
+        [strongSelf processBuffer];
+    });
+}
+
+- (BOOL)writeData:(NSData *)data {
+    const char *bytes = data.bytes;
+    NSUInteger offset = 0;
+    while (offset < data.length) {
+        ssize_t written = send(self.fd, bytes + offset, data.length - offset, 0);
+        if (written <= 0) return NO;
+        offset += written;
+    }
+    return YES;
+}
+
+- (void)close {
+    if (self.closed) return;
+    self.closed = YES;
+    /** 被挂起的source无法执行cancel handler,需先恢复 */
+    if (self.busy) dispatch_resume(self.readSource);
+    dispatch_source_cancel(self.readSource);
+    [self.server removeConnection:self];
+}
+
+@end
+
+#pragma mark - Server
+
+@implementation ACLoopbackServer
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _payloadSize = 1024;
+        _errorStatusCode = 500;
+        _maxAge = -1;
+        _etagEnabled = YES;
+        _acceptQueue = dispatch_queue_create("com.acnetworking.loopback.accept", DISPATCH_QUEUE_SERIAL);
+        _connections = [NSMutableSet set];
+        _payloads = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [self stop];
+}
+
+- (BOOL)startOnPort:(uint16_t)port error:(NSError **)error {
+    if (self.acceptSource) return YES;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return [self failWithError:error];
+    int yes = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_len = sizeof(addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return [self failWithError:error];
+    }
+    socklen_t length = sizeof(addr);
+    getsockname(fd, (struct sockaddr *)&addr, &length);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    self.port = ntohs(addr.sin_port);
+    dispatch_source_t source = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, fd, 0, self.acceptQueue);
+    __weak typeof(self) weakSelf = self;
+    dispatch_source_set_event_handler(source, ^{
+        [weakSelf acceptConnectionsOnSocket:fd];
+    });
+    dispatch_source_set_cancel_handler(source, ^{
+        close(fd);
+    });
+    self.acceptSource = source;
+    dispatch_resume(source);
+    return YES;
+}
+
+- (void)stop {
+    if (!self.acceptSource) return;
+    dispatch_source_cancel(self.acceptSource);
+    self.acceptSource = nil;
+    NSArray<ACLoopbackConnection *> *connections;
+    @synchronized (self) {
+        connections = self.connections.allObjects;
+    }
+    for (ACLoopbackConnection *connection in connections) {
+        dispatch_async(connection.queue, ^{
+            [connection close];
+        });
+    }
+}
+
+- (NSURL *)baseURL {
+    if (!self.acceptSource) return nil;
+    return [NSURL URLWithString:[NSString stringWithFormat:@"http://127.0.0.1:%u", self.port]];
+}
+
+- (NSUInteger)requestCount {
+    @synchronized (self) {
+        return _requestCount;
+    }
+}
+
+#pragma mark - Connection
+
+- (void)acceptConnectionsOnSocket:(int)listenFd {
+    while (YES) {
+        int fd = accept(listenFd, NULL, NULL);
+        if (fd < 0) return;
+        int yes = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &yes, sizeof(yes));
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+        /** BSD下accept得到的socket会继承监听socket的O_NONBLOCK */
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+        ACLoopbackConnection *connection = [[ACLoopbackConnection alloc] initWithFd:fd server:self];
+        @synchronized (self) {
+            [self.connections addObject:connection];
+        }
+        [connection start];
+    }
+}
+
+- (void)removeConnection:(ACLoopbackConnection *)connection {
+    @synchronized (self) {
+        [self.connections removeObject:connection];
+    }
+}
+
+#pragma mark - Response
+
+/**
+ 根据请求头生成完整的HTTP返回
+
+ @param head 请求头(不含结尾空行)
+ @param delay 返回延迟
+ @param keepAlive 返回后是否保持连接
+ @return HTTP返回
+ */
+- (NSData *)responseForRequestHead:(NSString *)head delay:(NSTimeInterval *)delay keepAlive:(BOOL *)keepAlive {
+    NSArray<NSString *> *lines = [head componentsSeparatedByString:@"\r\n"];
+    NSArray<NSString *> *requestLine = [lines.firstObject componentsSeparatedByString:@" "];
+    NSString *target = requestLine.count > 1 ? requestLine[1] : @"/";
+    NSMutableDictionary<NSString *, NSString *> *headers = [NSMutableDictionary dictionary];
+    for (NSString *line in lines) {
+        NSRange colon = [line rangeOfString:@":"];
+        if (colon.location == NSNotFound) continue;
+        NSString *name = [line substringToIndex:colon.location].lowercaseString;
+        headers[name] = [[line substringFromIndex:colon.location + 1] stringByTrimmingCharactersInSet:NSCharacterSet.whitespaceCharacterSet];
+    }
+    NSMutableDictionary<NSString *, NSString *> *query = [NSMutableDictionary dictionary];
+    for (NSURLQueryItem *item in [NSURLComponents componentsWithString:[@"http://127.0.0.1" stringByAppendingString:target]].queryItems) {
+        if (item.value) query[item.name] = item.value;
+    }
+    @synchronized (self) {
+        _requestCount++;
+    }
+
+    NSUInteger size = query[@"size"] ? (NSUInteger)query[@"size"].integerValue : self.payloadSize;
+    NSTimeInterval latency = query[@"latency"] ? query[@"latency"].doubleValue / 1000.0 : self.latency;
+    double errorRate = query[@"error_rate"] ? query[@"error_rate"].doubleValue : self.errorRate;
+    NSInteger maxAge = query[@"max_age"] ? query[@"max_age"].integerValue : self.maxAge;
+    BOOL etagEnabled = query[@"etag"] ? query[@"etag"].boolValue : self.etagEnabled;
+
+    NSInteger status = 200;
+    if (query[@"status"]) {
+        status = query[@"status"].integerValue;
+    } else if (errorRate > 0 && arc4random_uniform(1000000) < errorRate * 1000000) {
+        status = self.errorStatusCode;
+    }
+    NSData *body = status == 200 ? [self payloadWithSize:size] : [[NSString stringWithFormat:@"{\"error\":%ld}", (long)status] dataUsingEncoding:NSUTF8StringEncoding];
+    NSString *etag = [NSString stringWithFormat:@"\"s%lu\"", (unsigned long)size];
+    if (status == 200 && etagEnabled && [headers[@"if-none-match"] isEqualToString:etag]) {
+        status = 304;
+        body = [NSData data];
+    }
+
+    NSMutableString *responseHead = [NSMutableString stringWithFormat:@"HTTP/1.1 %ld %@\r\n", (long)status, [self reasonPhraseForStatus:status]];
+    [responseHead appendString:@"Content-Type: application/json\r\n"];
+    [responseHead appendFormat:@"Content-Length: %lu\r\n", (unsigned long)body.length];
+    if (status == 200 || status == 304) {
+        if (etagEnabled) [responseHead appendFormat:@"ETag: %@\r\n", etag];
+        if (maxAge >= 0) [responseHead appendFormat:@"Cache-Control: max-age=%ld\r\n", (long)maxAge];
+    }
+    *keepAlive = ![headers[@"connection"].lowercaseString isEqualToString:@"close"];
+    [responseHead appendString:*keepAlive ? @"Connection: keep-alive\r\n\r\n" : @"Connection: close\r\n\r\n"];
+    *delay = latency;
+
+    NSMutableData *response = [[responseHead dataUsingEncoding:NSUTF8StringEncoding] mutableCopy];
+    [response appendData:body];
+    return response;
+}
+
+/**
+ 生成指定大小的JSON body,size为0时返回空对象
+
+ @param size 字节数
+ @return body
+ */
+- (NSData *)payloadWithSize:(NSUInteger)size {
+    @synchronized (self) {
+        NSData *payload = self.payloads[@(size)];
+        if (payload) return payload;
+        static NSString * const prefix = @"{\"data\":\"";
+        static NSString * const suffix = @"\"}";
+        if (size <= prefix.length + suffix.length) {
+            payload = [@"{}" dataUsingEncoding:NSUTF8StringEncoding];
+        } else {
+            NSMutableData *data = [[prefix dataUsingEncoding:NSUTF8StringEncoding] mutableCopy];
+            NSUInteger fill = size - prefix.length - suffix.length;
+            data.length += fill;
+            memset((char *)data.mutableBytes + prefix.length, 'a', fill);
+            [data appendData:[suffix dataUsingEncoding:NSUTF8StringEncoding]];
+            payload = [data copy];
+        }
+        self.payloads[@(size)] = payload;
+        return payload;
+    }
+}
+
+- (NSString *)reasonPhraseForStatus:(NSInteger)status {
+    switch (status) {
+        case 200: return @"OK";
+        case 204: return @"No Content";
+        case 304: return @"Not Modified";
+        case 404: return @"Not Found";
+        case 410: return @"Gone";
+        case 429: return @"Too Many Requests";
+        case 500: return @"Internal Server Error";
+        case 503: return @"Service Unavailable";
+        default: return @"Unknown";
+    }
+}
+
+#pragma mark - Helper
+
+- (BOOL)failWithError:(NSError **)error {
+    if (error) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+    return NO;
+}
+
+@end
@@ -7,9 +7,16 @@
 //
 
 #import "AppDelegate.h"
+#import "ACLoopbackServer.h"
+#import "ACLoadGenerator.h"
+#import "ACBenchmark.h"
 
 @interface AppDelegate ()
 
+@property (nonatomic, strong) ACLoopbackServer *loadTestServer;
+
+@property (nonatomic, strong) ACLoadGenerator *loadGenerator;
+
 @end
 
 @implementation AppDelegate
@@ -17,9 +24,46 @@
 
 - (BOOL)application:(UIApplication *)application didFinishLaunchingWithOptions:(NSDictionary *)launchOptions {
     // Override point for customization after application launch.
+    /** 启动参数带-ACLoadTest时,对本地回环服务进行压测 */
+    if ([NSProcessInfo.processInfo.arguments containsObject:@"-ACLoadTest"]) [self runLoadTest];
+    /** 启动参数带-ACBenchmark时,在后台运行基准测试 */
+    if ([NSProcessInfo.processInfo.arguments containsObject:@"-ACBenchmark"]) {
+        dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+            [ACBenchmark runNullStrippingBenchmark];
+            [ACBenchmark runJSONParserBenchmark];
+        });
+    }
     return YES;
 }
 
+- (void)runLoadTest {
+    self.loadTestServer = [ACLoopbackServer new];
+    self.loadTestServer.latency = 0.02;
+    self.loadTestServer.maxAge = 60;
+    NSError *error = nil;
+    if (![self.loadTestServer startOnPort:0 error:&error]) {
+        NSLog(@"LoadTest server failed:%@", error);
+        return;
+    }
+    NSString *baseURL = self.loadTestServer.baseURL.absoluteString;
+    NSMutableArray<ACLoadRequest *> *mix = [NSMutableArray array];
+    for (NSInteger i = 0; i < 200; i++) {
+        NSString *url = [NSString stringWithFormat:@"%@/feed/%ld", baseURL, (long)i];
+        [mix addObject:[ACLoadRequest requestWithURLString:url parameters:@{@"size": @(i % 10 == 0 ? 65536 : 2048)} options:ACNetworkingFetchOptionLocalFirst weight:7]];
+        if (i < 50) [mix addObject:[ACLoadRequest requestWithURLString:url parameters:@{@"size": @(2048)} options:ACNetworkingFetchOptionLocalAndNet weight:2]];
+    }
+    [mix addObject:[ACLoadRequest requestWithURLString:[baseURL stringByAppendingString:@"/missing"] parameters:@{@"status": @(404)} options:ACNetworkingFetchOptionLocalFirst weight:10]];
+    ACNetCache *cache = [ACNetCache cacheWithNamespace:@"ac_loadtest" directiory:nil keyGenerator:nil];
+    cache.negativeCacheEnabled = YES;
+    self.loadGenerator = [[ACLoadGenerator alloc] initWithManager:[ACNetworkingManager managerWithSessionManager:[AFHTTPSessionManager manager] responseCache:cache]];
+    self.loadGenerator.requestMix = mix;
+    self.loadGenerator.totalRequests = 5000;
+    self.loadGenerator.concurrency = 256;
+    [self.loadGenerator runWithCompletion:^(ACLoadReport * _Nonnull report) {
+        NSLog(@"LoadTest finished, server handled %lu requests\n%@", (unsigned long)self.loadTestServer.requestCount, report);
+    }];
+}
+
 
 - (void)applicationWillResignActive:(UIApplication *)application {
     // Sent when the application is about to move from active to inactive state. This can occur for certain types of temporary interruptions (such as an incoming phone call or SMS message) or when the user quits the application and it begins the transition to the background state.
@@ -100,7 +100,7 @@
 
 - (void)processNetCache:(ACNetCacheType)cacheType Response:(id)response error:(NSError *)error cacheDate:(NSDate *)cacheDate {
     NSLog(@"Response:%@",response);
-    if (cacheType == ACNetCacheTypeNone) {
+    if (cacheType == ACNetCacheTypeNone || cacheType == ACNetCacheTypeNegative) {
         self.textView.text = [NSString stringWithFormat:@"%@:\n%@", [self typeNameForCacheType:cacheType cacheDate:cacheDate], error.localizedDescription];
     } else {
         NSData *jsonData = [NSJSONSerialization dataWithJSONObject:response options:0 error:nil];
@@ -119,6 +119,8 @@
             return [NSString stringWithFormat:@"磁盘缓存结果(结果缓存于:%@)", [cacheDate descriptionWithLocale:NSLocale.currentLocale]];
         case ACNetCacheTypeNone:
             return @"无结果";
+        case ACNetCacheTypeNegative:
+            return @"失败结果缓存";
         default:
             return nil;
     }
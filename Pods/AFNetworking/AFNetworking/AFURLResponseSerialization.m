@@ -60,23 +60,50 @@ static BOOL AFErrorOrUnderlyingErrorHasCodeInDomain(NSError *error, NSInteger co
     return NO;
 }
 
+// Returns JSONObject itself when its subtree contains no NSNull values, so clean subtrees are never copied.
+// A new container is only built for the path leading to a removed key.
 static id AFJSONObjectByRemovingKeysWithNullValues(id JSONObject, NSJSONReadingOptions readingOptions) {
     if ([JSONObject isKindOfClass:[NSArray class]]) {
-        NSMutableArray *mutableArray = [NSMutableArray arrayWithCapacity:[(NSArray *)JSONObject count]];
-        for (id value in (NSArray *)JSONObject) {
-            [mutableArray addObject:AFJSONObjectByRemovingKeysWithNullValues(value, readingOptions)];
+        NSArray *array = (NSArray *)JSONObject;
+        NSMutableArray *mutableArray = nil;
+        NSUInteger index = 0;
+        for (id value in array) {
+            id strippedValue = AFJSONObjectByRemovingKeysWithNullValues(value, readingOptions);
+            if (!mutableArray && strippedValue != value) {
+                mutableArray = [NSMutableArray arrayWithCapacity:[array count]];
+                [mutableArray addObjectsFromArray:[array subarrayWithRange:NSMakeRange(0, index)]];
+            }
+            [mutableArray addObject:strippedValue];
+            index++;
+        }
+
+        if (!mutableArray) {
+            return JSONObject;
         }
 
         return (readingOptions & NSJSONReadingMutableContainers) ? mutableArray : [NSArray arrayWithArray:mutableArray];
     } else if ([JSONObject isKindOfClass:[NSDictionary class]]) {
-        NSMutableDictionary *mutableDictionary = [NSMutableDictionary dictionaryWithDictionary:JSONObject];
-        for (id <NSCopying> key in [(NSDictionary *)JSONObject allKeys]) {
-            id value = (NSDictionary *)JSONObject[key];
-            if (!value || [value isEqual:[NSNull null]]) {
+        NSDictionary *dictionary = (NSDictionary *)JSONObject;
+        __block NSMutableDictionary *mutableDictionary = nil;
+        [dictionary enumerateKeysAndObjectsUsingBlock:^(id key, id value, __unused BOOL *stop) {
+            id strippedValue = (value == [NSNull null]) ? nil : AFJSONObjectByRemovingKeysWithNullValues(value, readingOptions);
+            if (strippedValue == value) {
+                return;
+            }
+
+            if (!mutableDictionary) {
+                mutableDictionary = [NSMutableDictionary dictionaryWithDictionary:dictionary];
+            }
+
+            if (strippedValue) {
+                mutableDictionary[key] = strippedValue;
+            } else {
                 [mutableDictionary removeObjectForKey:key];
-            } else if ([value isKindOfClass:[NSArray class]] || [value isKindOfClass:[NSDictionary class]]) {
-                mutableDictionary[key] = AFJSONObjectByRemovingKeysWithNullValues(value, readingOptions);
             }
+        }];
+
+        if (!mutableDictionary) {
+            return JSONObject;
         }
 
         return (readingOptions & NSJSONReadingMutableContainers) ? mutableDictionary : [NSDictionary dictionaryWithDictionary:mutableDictionary];
@@ -110,6 +110,9 @@ typedef void (^AFURLSessionTaskProgressBlock)(NSProgress *);
 
 typedef void (^AFURLSessionTaskCompletionHandler)(NSURLResponse *response, id responseObject, NSError *error);
 
+// Upper bound for reserving the response buffer up front, so a bogus Content-Length can't force a huge allocation.
+static long long const AFMaximumPreallocatedResponseLength = 64 * 1024 * 1024;
+
 
 #pragma mark -
 
@@ -263,7 +266,8 @@ didCompleteWithError:(NSError *)error
     //Performance Improvement from #2672
     NSData *data = nil;
     if (self.mutableData) {
-        data = [self.mutableData copy];
+        //The buffer is never appended to once the task completes, so hand it over as is instead of copying the whole body.
+        data = self.mutableData;
         //We no longer need the reference, so nil it out to gain back some memory.
         self.mutableData = nil;
     }
@@ -320,9 +324,16 @@ didCompleteWithError:(NSError *)error
 #pragma mark - NSURLSessionDataTaskDelegate
 
 - (void)URLSession:(__unused NSURLSession *)session
-          dataTask:(__unused NSURLSessionDataTask *)dataTask
+          dataTask:(NSURLSessionDataTask *)dataTask
     didReceiveData:(NSData *)data
 {
+    if (self.mutableData.length == 0) {
+        long long expectedContentLength = dataTask.response.expectedContentLength;
+        if (expectedContentLength > (long long)data.length && expectedContentLength <= AFMaximumPreallocatedResponseLength) {
+            //Reserve the whole body once instead of growing (and copying) the buffer chunk by chunk.
+            self.mutableData = [NSMutableData dataWithCapacity:(NSUInteger)expectedContentLength];
+        }
+    }
     [self.mutableData appendData:data];
 }
 